@@ -0,0 +1,226 @@
+#include "gateway.h"
+#include "../lib/CommoTalkie/PublisherBuilder.h"
+#include "../lib/CommoTalkie/Pull.h"
+#include "../lib/CommoTalkie/SubscriberBuilder.h"
+#include "../src/handshake.h"
+#include <string.h>
+
+static void deliver(Gateway *gateway, const unsigned char *frame);
+static void enqueue(GatewayNode *node, const unsigned char *body,
+                    GatewayStats *stats);
+static int find_node(const Gateway *gateway, unsigned char port,
+                     unsigned char id);
+static unsigned long capture_sent(const unsigned char *address,
+                                  const unsigned char *content,
+                                  unsigned long size);
+static int listen_pending(const unsigned char *address, unsigned char *content,
+                          unsigned long size);
+static unsigned long pull_clock();
+static void receiver_idle();
+
+// The CommoTalkie subscriber polls its listen callback until the timeout, on
+// its own clock. Here the listen callback hands over one frame already read,
+// and the clock only moves when there is nothing left, so that every pull
+// returns right after looking at it.
+static const unsigned char *pending;
+static unsigned long clock_ms;
+static const unsigned long pull_timeout = 1;
+static unsigned char pull_id;
+static unsigned char *capture;
+
+int Gateway_Init(Gateway *gateway, const char *salt) {
+  memset(gateway, 0, sizeof(*gateway));
+  FrameReader_Init(&gateway->reader);
+  PublisherBuilder_Create();
+  PublisherBuilder_SetSalt(salt);
+  PublisherBuilder_SetSendCallback(capture_sent);
+  const int published = PublisherBuilder_Build();
+  PublisherBuilder_Destroy();
+  SubscriberBuilder_Create();
+  SubscriberBuilder_SetSalt(salt);
+  SubscriberBuilder_SetListenCallback(listen_pending);
+  SubscriberBuilder_SetTimeService(pull_clock);
+  SubscriberBuilder_SetTimeout(&pull_timeout);
+  SubscriberBuilder_SetReceiverStateCallback(receiver_idle, receiver_idle);
+  SubscriberBuilder_SetId(&pull_id);
+  const int subscribed = SubscriberBuilder_Build();
+  SubscriberBuilder_Destroy();
+  return published && subscribed;
+}
+
+// Returns the index of the node, or -1 when the table is full or the port and
+// id are taken.
+int Gateway_AddNode(Gateway *gateway, const unsigned char port,
+                    const unsigned char id, const unsigned char reply_id,
+                    const unsigned char *address) {
+  unsigned char i;
+  if (GATEWAY_NODES == gateway->node_count ||
+      0 <= find_node(gateway, port, id))
+    return -1;
+  GatewayNode *node = &gateway->nodes[gateway->node_count];
+  memset(node, 0, sizeof(*node));
+  node->port = port;
+  node->id = id;
+  node->reply_id = reply_id;
+  memcpy(node->address, address, LORA_HEADER_LENGTH);
+  for (i = 0; i < gateway->id_count && id != gateway->ids[i]; i++)
+    ;
+  if (i == gateway->id_count)
+    gateway->ids[gateway->id_count++] = id;
+  return gateway->node_count++;
+}
+
+// Returns the number of frames completed.
+int Gateway_Push(Gateway *gateway, const unsigned char *bytes,
+                 const unsigned long size, const unsigned long now_us) {
+  unsigned long i;
+  int frames = 0;
+  gateway->stats.bytes_in += size;
+  for (i = 0; i < size; i++) {
+    if (!FrameReader_Push(&gateway->reader, bytes[i], MESSAGE_LENGTH, now_us))
+      continue;
+    deliver(gateway, gateway->reader.buffer);
+    frames++;
+  }
+  return frames;
+}
+
+void Gateway_Expire(Gateway *gateway, const unsigned long now_us) {
+  FrameReader_Expire(&gateway->reader, now_us);
+}
+
+void deliver(Gateway *gateway, const unsigned char *frame) {
+  const unsigned char no_address[LORA_HEADER_LENGTH] = {0, 0, 0};
+  unsigned char body[MESSAGE_BODY_LENGTH];
+  unsigned char port;
+  unsigned char id;
+  unsigned char i;
+  gateway->stats.frames++;
+  if (Handshake_IsReady(frame, MESSAGE_LENGTH, &id)) {
+    gateway->stats.ready_tokens++;
+    return;
+  }
+  for (i = 0; i < gateway->id_count; i++) {
+    pending = frame;
+    pull_id = gateway->ids[i];
+    if (Success != Pull_Invoke(no_address, &port, &id, body))
+      continue;
+    const int node = find_node(gateway, port, id);
+    if (0 > node)
+      break;
+    enqueue(&gateway->nodes[node], body, &gateway->stats);
+    return;
+  }
+  pending = 0;
+  gateway->stats.unknown++;
+}
+
+void enqueue(GatewayNode *node, const unsigned char *body,
+             GatewayStats *stats) {
+  if (GATEWAY_QUEUE == node->count) {
+    node->head = (node->head + 1) % GATEWAY_QUEUE;
+    node->count--;
+    node->overflows++;
+    stats->overflows++;
+  }
+  memcpy(node->queue[(node->head + node->count) % GATEWAY_QUEUE], body,
+         MESSAGE_BODY_LENGTH);
+  node->count++;
+  node->received++;
+}
+
+int find_node(const Gateway *gateway, const unsigned char port,
+              const unsigned char id) {
+  unsigned char i;
+  for (i = 0; i < gateway->node_count; i++) {
+    if (port == gateway->nodes[i].port && id == gateway->nodes[i].id)
+      return i;
+  }
+  return -1;
+}
+
+// The oldest frame of the node into body, 0 when there is none.
+int Gateway_Pop(Gateway *gateway, const int node, unsigned char *body) {
+  GatewayNode *entry = &gateway->nodes[node];
+  if (!entry->count)
+    return 0;
+  memcpy(body, entry->queue[entry->head], MESSAGE_BODY_LENGTH);
+  entry->head = (entry->head + 1) % GATEWAY_QUEUE;
+  entry->count--;
+  return 1;
+}
+
+// Returns 0 when the transmit queue is full.
+int Gateway_Reply(Gateway *gateway, const int node, const unsigned char *body) {
+  GatewayNode *entry = &gateway->nodes[node];
+  if (GATEWAY_TX_FRAMES == gateway->tx_count) {
+    gateway->stats.tx_full++;
+    return 0;
+  }
+  capture = gateway->tx[(gateway->tx_head + gateway->tx_count) %
+                        GATEWAY_TX_FRAMES];
+  if (Success != Publish_Invoke(entry->address, entry->port, entry->reply_id,
+                                body))
+    return 0;
+  gateway->tx_count++;
+  gateway->stats.replies++;
+  entry->replies++;
+  return 1;
+}
+
+// Copies up to frames queued frames into out, back to back, and returns how
+// many.
+unsigned long Gateway_TakeTx(Gateway *gateway, unsigned char *out,
+                             const unsigned long frames) {
+  unsigned long taken = 0;
+  while (taken < frames && gateway->tx_count) {
+    memcpy(out + taken * LORA_FRAME_LENGTH, gateway->tx[gateway->tx_head],
+           LORA_FRAME_LENGTH);
+    gateway->tx_head = (gateway->tx_head + 1) % GATEWAY_TX_FRAMES;
+    gateway->tx_count--;
+    taken++;
+  }
+  if (taken)
+    gateway->stats.tx_writes++;
+  gateway->stats.tx_frames += taken;
+  return taken;
+}
+
+// A message as a node would send it, for the module stand-in and the tests.
+int Gateway_Encode(const unsigned char port, const unsigned char id,
+                   const unsigned char *body, unsigned char *message) {
+  const unsigned char no_address[LORA_HEADER_LENGTH] = {0, 0, 0};
+  unsigned char frame[LORA_FRAME_LENGTH];
+  capture = frame;
+  if (Success != Publish_Invoke(no_address, port, id, body))
+    return 0;
+  memcpy(message, frame + LORA_HEADER_LENGTH, MESSAGE_LENGTH);
+  return 1;
+}
+
+unsigned long capture_sent(const unsigned char *address,
+                           const unsigned char *content,
+                           const unsigned long size) {
+  if (MESSAGE_LENGTH < size)
+    return 0;
+  memcpy(capture, address, LORA_HEADER_LENGTH);
+  memcpy(capture + LORA_HEADER_LENGTH, content, size);
+  return size;
+}
+
+int listen_pending(const unsigned char *address, unsigned char *content,
+                   const unsigned long size) {
+  (void)address;
+  if (!pending) {
+    clock_ms++;
+    return 0;
+  }
+  memcpy(content, pending, size);
+  pending = 0;
+  return (int)size;
+}
+
+unsigned long pull_clock() { return clock_ms; }
+
+// The module on the gateway never leaves NORMAL mode.
+void receiver_idle() {}
@@ -0,0 +1,74 @@
+#ifndef COMMOTALKINO_GATEWAY_GATEWAY_H_
+#define COMMOTALKINO_GATEWAY_GATEWAY_H_
+
+#include "../src/framereader.h"
+
+// Host end of the field nodes, behind one E32 in fixed mode. The module outputs
+// every frame it receives as MESSAGE_LENGTH bytes, the address stripped, and
+// transmits every LORA_FRAME_LENGTH bytes written to it to the address in the
+// first three.
+//
+// Frames go through the CommoTalkie subscriber as on a node, once per id the
+// gateway knows, and land in the queue of the node registered for their port
+// and id. A full queue drops its oldest frame. Readiness tokens of nodes
+// running the handshake are counted and dropped. Replies are encoded by the
+// CommoTalkie publisher into the transmit queue, whole fixed mode frames with
+// the address of the node, and leave in batches: every frame that is due at
+// once goes out in one write.
+
+#define GATEWAY_NODES 32
+#define GATEWAY_QUEUE 16
+#define GATEWAY_TX_FRAMES 64
+#define GATEWAY_SALT "1111111111"
+
+typedef struct GatewayNode {
+  unsigned char port;
+  unsigned char id;
+  unsigned char reply_id;
+  unsigned char address[LORA_HEADER_LENGTH];
+  unsigned char queue[GATEWAY_QUEUE][MESSAGE_BODY_LENGTH];
+  unsigned char head;
+  unsigned char count;
+  unsigned long received;
+  unsigned long overflows;
+  unsigned long replies;
+} GatewayNode;
+
+typedef struct GatewayStats {
+  unsigned long bytes_in;
+  unsigned long frames;
+  unsigned long ready_tokens;
+  unsigned long unknown;
+  unsigned long overflows;
+  unsigned long replies;
+  unsigned long tx_full;
+  unsigned long tx_frames;
+  unsigned long tx_writes;
+} GatewayStats;
+
+typedef struct Gateway {
+  FrameReader reader;
+  GatewayNode nodes[GATEWAY_NODES];
+  unsigned char node_count;
+  unsigned char ids[GATEWAY_NODES];
+  unsigned char id_count;
+  unsigned char tx[GATEWAY_TX_FRAMES][LORA_FRAME_LENGTH];
+  unsigned char tx_head;
+  unsigned char tx_count;
+  GatewayStats stats;
+} Gateway;
+
+int Gateway_Init(Gateway *gateway, const char *salt);
+int Gateway_AddNode(Gateway *gateway, unsigned char port, unsigned char id,
+                    unsigned char reply_id, const unsigned char *address);
+int Gateway_Push(Gateway *gateway, const unsigned char *bytes,
+                 unsigned long size, unsigned long now_us);
+void Gateway_Expire(Gateway *gateway, unsigned long now_us);
+int Gateway_Pop(Gateway *gateway, int node, unsigned char *body);
+int Gateway_Reply(Gateway *gateway, int node, const unsigned char *body);
+unsigned long Gateway_TakeTx(Gateway *gateway, unsigned char *out,
+                             unsigned long frames);
+int Gateway_Encode(unsigned char port, unsigned char id,
+                   const unsigned char *body, unsigned char *message);
+
+#endif // COMMOTALKINO_GATEWAY_GATEWAY_H_
@@ -0,0 +1,344 @@
+// Gateway daemon: one E32 on a serial port, many field nodes.
+//
+//   gateway --port /dev/ttyUSB0 --node PORT:ID:REPLY_ID:HIGH:LOW:CHANNEL ...
+//
+// Every frame of a node is written to stdout as a line, the node index and
+// the body in hex, and a line of the same form on stdin is a reply to that
+// node. With --echo the gateway replies every frame with its own body, as
+// Pong does. SIGUSR1 or a "stats" line on stdin print the counters on stderr,
+// and so does the end, on SIGINT or SIGTERM.
+//
+// The module sends what it gets at once, the bytes written back to back
+// included, so by default replies leave one frame per --tx-gap-us, the UART
+// and air time of a frame at 9600 baud and 2400 bps. With --tx-gap-us 0, for
+// the module stand-in, every queued reply goes out in a single write.
+
+#include "gateway.h"
+#include "serialport.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#define GATEWAY_BAUD 9600
+#define GATEWAY_TX_GAP_US 80000
+#define GATEWAY_READ_SIZE (GATEWAY_QUEUE * MESSAGE_LENGTH)
+#define GATEWAY_INPUT_SIZE 4096
+#define GATEWAY_LINE_LENGTH 128
+#define GATEWAY_EVENTS 4
+
+typedef struct Daemon {
+  Gateway gateway;
+  int serial;
+  int signals;
+  int input_open;
+  int echo;
+  unsigned long tx_gap_us;
+  unsigned long last_tx_us;
+  unsigned char out[GATEWAY_TX_FRAMES * LORA_FRAME_LENGTH];
+  unsigned long out_length;
+  unsigned long out_sent;
+  char line[GATEWAY_LINE_LENGTH];
+  unsigned long line_length;
+  unsigned long started_us;
+} Daemon;
+
+static int parse_node(Gateway *gateway, const char *spec);
+static int parse_hex(const char *text, unsigned char *bytes,
+                     unsigned long size);
+static unsigned long now_us();
+static void read_serial(Daemon *daemon);
+static void read_input(Daemon *daemon);
+static void handle_line(Daemon *daemon, const char *line);
+static void drain_queues(Daemon *daemon);
+static void write_serial(Daemon *daemon);
+static int next_timeout_ms(const Daemon *daemon);
+static void print_stats(const Daemon *daemon);
+static void usage(const char *program);
+
+int main(int argc, char **argv) {
+  static Daemon daemon;
+  struct epoll_event event;
+  struct epoll_event events[GATEWAY_EVENTS];
+  struct signalfd_siginfo info;
+  sigset_t mask;
+  const char *path = 0;
+  const char *salt = GATEWAY_SALT;
+  const char *nodes[GATEWAY_NODES];
+  int node_count = 0;
+  unsigned long baud = GATEWAY_BAUD;
+  unsigned long tx_gap_us = GATEWAY_TX_GAP_US;
+  int echo = 0;
+  int running = 1;
+  int i;
+  for (i = 1; i < argc; i++) {
+    if (0 == strcmp("--port", argv[i]) && i + 1 < argc)
+      path = argv[++i];
+    else if (0 == strcmp("--baud", argv[i]) && i + 1 < argc)
+      baud = strtoul(argv[++i], NULL, 10);
+    else if (0 == strcmp("--salt", argv[i]) && i + 1 < argc)
+      salt = argv[++i];
+    else if (0 == strcmp("--tx-gap-us", argv[i]) && i + 1 < argc)
+      tx_gap_us = strtoul(argv[++i], NULL, 10);
+    else if (0 == strcmp("--echo", argv[i]))
+      echo = 1;
+    else if (0 == strcmp("--node", argv[i]) && i + 1 < argc &&
+             node_count < GATEWAY_NODES)
+      nodes[node_count++] = argv[++i];
+    else
+      break;
+  }
+  if (i < argc || !path || !node_count) {
+    usage(argv[0]);
+    return 2;
+  }
+  memset(&daemon, 0, sizeof(daemon));
+  if (!Gateway_Init(&daemon.gateway, salt)) {
+    fprintf(stderr, "Error: CommoTalkie builders\n");
+    return 1;
+  }
+  for (i = 0; i < node_count; i++) {
+    if (!parse_node(&daemon.gateway, nodes[i])) {
+      fprintf(stderr, "Error: bad or repeated node %s\n", nodes[i]);
+      return 2;
+    }
+  }
+  daemon.tx_gap_us = tx_gap_us;
+  daemon.echo = echo;
+  daemon.input_open = 1;
+  daemon.serial = SerialPort_Open(path, baud);
+  if (0 > daemon.serial) {
+    fprintf(stderr, "Error: opening %s: %s\n", path, strerror(errno));
+    return 1;
+  }
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  sigaddset(&mask, SIGUSR1);
+  sigprocmask(SIG_BLOCK, &mask, NULL);
+  daemon.signals = signalfd(-1, &mask, SFD_NONBLOCK);
+  const int poller = epoll_create1(0);
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.fd = daemon.serial;
+  epoll_ctl(poller, EPOLL_CTL_ADD, daemon.serial, &event);
+  event.data.fd = daemon.signals;
+  epoll_ctl(poller, EPOLL_CTL_ADD, daemon.signals, &event);
+  event.data.fd = STDIN_FILENO;
+  if (0 != epoll_ctl(poller, EPOLL_CTL_ADD, STDIN_FILENO, &event))
+    daemon.input_open = 0;
+  daemon.started_us = now_us();
+  while (running) {
+    const int ready =
+        epoll_wait(poller, events, GATEWAY_EVENTS, next_timeout_ms(&daemon));
+    if (0 > ready && EINTR != errno)
+      break;
+    for (i = 0; i < ready; i++) {
+      const int fd = events[i].data.fd;
+      if (fd == daemon.serial) {
+        read_serial(&daemon);
+      } else if (fd == daemon.signals) {
+        while (sizeof(info) == read(daemon.signals, &info, sizeof(info))) {
+          if (SIGUSR1 == info.ssi_signo)
+            print_stats(&daemon);
+          else
+            running = 0;
+        }
+      } else if (fd == STDIN_FILENO) {
+        read_input(&daemon);
+        if (!daemon.input_open)
+          epoll_ctl(poller, EPOLL_CTL_DEL, STDIN_FILENO, NULL);
+      }
+    }
+    Gateway_Expire(&daemon.gateway, now_us());
+    drain_queues(&daemon);
+    write_serial(&daemon);
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | (daemon.out_sent < daemon.out_length ? EPOLLOUT : 0);
+    event.data.fd = daemon.serial;
+    epoll_ctl(poller, EPOLL_CTL_MOD, daemon.serial, &event);
+  }
+  print_stats(&daemon);
+  close(poller);
+  close(daemon.signals);
+  close(daemon.serial);
+  return 0;
+}
+
+// PORT:ID:REPLY_ID:HIGH:LOW:CHANNEL, decimal or 0x hex.
+int parse_node(Gateway *gateway, const char *spec) {
+  int field[6];
+  unsigned char address[LORA_HEADER_LENGTH];
+  int i;
+  if (6 != sscanf(spec, "%i:%i:%i:%i:%i:%i", &field[0], &field[1], &field[2],
+                  &field[3], &field[4], &field[5]))
+    return 0;
+  for (i = 0; i < 6; i++) {
+    if (0 > field[i] || 0xFF < field[i])
+      return 0;
+  }
+  address[0] = field[3];
+  address[1] = field[4];
+  address[2] = field[5];
+  return 0 <= Gateway_AddNode(gateway, field[0], field[1], field[2], address);
+}
+
+int parse_hex(const char *text, unsigned char *bytes, const unsigned long size) {
+  unsigned long i;
+  unsigned int value;
+  for (i = 0; i < size; i++) {
+    if (1 != sscanf(text + 2 * i, "%2x", &value))
+      return 0;
+    bytes[i] = value;
+  }
+  return 1;
+}
+
+unsigned long now_us() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000UL + now.tv_nsec / 1000;
+}
+
+// No more than a queue of frames at a time, handed over before the next read,
+// so that a burst does not overflow the queue of a node.
+void read_serial(Daemon *daemon) {
+  unsigned char bytes[GATEWAY_READ_SIZE];
+  ssize_t size;
+  while (0 < (size = read(daemon->serial, bytes, sizeof(bytes)))) {
+    Gateway_Push(&daemon->gateway, bytes, size, now_us());
+    drain_queues(daemon);
+    write_serial(daemon);
+  }
+}
+
+void read_input(Daemon *daemon) {
+  char buffer[GATEWAY_INPUT_SIZE];
+  ssize_t size = read(STDIN_FILENO, buffer, sizeof(buffer));
+  ssize_t i;
+  if (0 >= size) {
+    daemon->input_open = 0;
+    return;
+  }
+  for (i = 0; i < size; i++) {
+    if ('\n' != buffer[i]) {
+      if (daemon->line_length < sizeof(daemon->line) - 1)
+        daemon->line[daemon->line_length++] = buffer[i];
+      continue;
+    }
+    daemon->line[daemon->line_length] = 0;
+    handle_line(daemon, daemon->line);
+    daemon->line_length = 0;
+  }
+}
+
+void handle_line(Daemon *daemon, const char *line) {
+  unsigned char body[MESSAGE_BODY_LENGTH];
+  int node;
+  int offset;
+  if (0 == strcmp("stats", line)) {
+    print_stats(daemon);
+    return;
+  }
+  if (1 != sscanf(line, "%d %n", &node, &offset) || 0 > node ||
+      daemon->gateway.node_count <= node ||
+      strlen(line + offset) != 2 * MESSAGE_BODY_LENGTH ||
+      !parse_hex(line + offset, body, sizeof(body))) {
+    fprintf(stderr, "Error: expected NODE and %d hex bytes: %s\n",
+            MESSAGE_BODY_LENGTH, line);
+    return;
+  }
+  Gateway_Reply(&daemon->gateway, node, body);
+}
+
+// Every frame of every node to stdout, one flush for all of them.
+void drain_queues(Daemon *daemon) {
+  unsigned char body[MESSAGE_BODY_LENGTH];
+  int node;
+  int printed = 0;
+  unsigned long i;
+  for (node = 0; node < daemon->gateway.node_count; node++) {
+    while (Gateway_Pop(&daemon->gateway, node, body)) {
+      printf("%d ", node);
+      for (i = 0; i < sizeof(body); i++)
+        printf("%02x", body[i]);
+      putchar('\n');
+      printed = 1;
+      if (daemon->echo)
+        Gateway_Reply(&daemon->gateway, node, body);
+    }
+  }
+  if (printed)
+    fflush(stdout);
+}
+
+void write_serial(Daemon *daemon) {
+  const unsigned long now = now_us();
+  if (daemon->out_sent == daemon->out_length) {
+    if (now - daemon->last_tx_us < daemon->tx_gap_us)
+      return;
+    const unsigned long frames = Gateway_TakeTx(
+        &daemon->gateway, daemon->out, daemon->tx_gap_us ? 1 : GATEWAY_TX_FRAMES);
+    if (!frames)
+      return;
+    daemon->out_length = frames * LORA_FRAME_LENGTH;
+    daemon->out_sent = 0;
+    daemon->last_tx_us = now;
+  }
+  const ssize_t sent = write(daemon->serial, daemon->out + daemon->out_sent,
+                             daemon->out_length - daemon->out_sent);
+  if (0 < sent)
+    daemon->out_sent += sent;
+}
+
+// Until the partial frame expires or the next reply is due, else forever.
+int next_timeout_ms(const Daemon *daemon) {
+  const unsigned long now = now_us();
+  long wait_us = -1;
+  if (daemon->gateway.reader.length)
+    wait_us = FRAME_GAP_US + 1 - (long)(now - daemon->gateway.reader.last_byte_us);
+  if (daemon->gateway.tx_count && daemon->out_sent == daemon->out_length) {
+    const long due_us = (long)daemon->tx_gap_us - (long)(now - daemon->last_tx_us);
+    if (0 > wait_us || due_us < wait_us)
+      wait_us = due_us;
+  }
+  if (0 > wait_us)
+    return daemon->gateway.reader.length || daemon->gateway.tx_count ? 0 : -1;
+  return (int)((wait_us + 999) / 1000);
+}
+
+void print_stats(const Daemon *daemon) {
+  const GatewayStats *stats = &daemon->gateway.stats;
+  const GatewayNode *node;
+  const double seconds = (now_us() - daemon->started_us) / 1e6;
+  int i;
+  fprintf(stderr, "Seconds: %.1f Bytes in: %lu Frames: %lu Frames/s: %.1f\n",
+          seconds, stats->bytes_in, stats->frames,
+          seconds ? stats->frames / seconds : 0.0);
+  fprintf(stderr,
+          "Ready tokens: %lu Unknown: %lu Dropped bytes: %lu "
+          "Queue overflows: %lu\n",
+          stats->ready_tokens, stats->unknown, daemon->gateway.reader.dropped,
+          stats->overflows);
+  fprintf(stderr, "Replies: %lu Tx frames: %lu Tx writes: %lu Tx full: %lu\n",
+          stats->replies, stats->tx_frames, stats->tx_writes, stats->tx_full);
+  for (i = 0; i < daemon->gateway.node_count; i++) {
+    node = &daemon->gateway.nodes[i];
+    fprintf(stderr,
+            "Node %d port %u id %u: received %lu replies %lu overflows %lu\n",
+            i, node->port, node->id, node->received, node->replies,
+            node->overflows);
+  }
+}
+
+void usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s --port DEVICE --node PORT:ID:REPLY_ID:HIGH:LOW:CHANNEL "
+          "[--node ...] [--baud N] [--salt S] [--echo] [--tx-gap-us N]\n",
+          program);
+}
@@ -0,0 +1,252 @@
+// Runs the gateway daemon against a pseudo-terminal standing in for the
+// module, no radio needed:
+//
+//   ptycheck ./gateway [FRAMES]
+//
+// The stand-in outputs FRAMES frames of PTY_NODES nodes as the module would,
+// back to back, plus a readiness token and a frame for an id nobody has, and
+// checks that the daemon, with --echo, answers every node frame once, in
+// order, to the address of the node. Then it times the parser alone, for the
+// headroom over the air. Exits 0 when every answer came back right.
+
+#include "gateway.h"
+#include "../src/handshake.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PTY_NODES 4
+#define PTY_PORT 0xC6
+#define PTY_FRAMES 20000
+#define PTY_IN_FLIGHT 32
+#define PTY_START_MS 300
+#define PTY_TIMEOUT_MS 10000
+#define PTY_PARSE_FRAMES 200000UL
+
+typedef struct PtyNode {
+  unsigned char id;
+  unsigned char reply_id;
+  unsigned char address[LORA_HEADER_LENGTH];
+  char spec[32];
+  unsigned long sent;
+  unsigned long answered;
+} PtyNode;
+
+static int open_module(int *slave, char *path, unsigned long size);
+static pid_t start_gateway(const char *program, const char *path,
+                           PtyNode *nodes);
+static void body_of(const PtyNode *node, unsigned long sequence,
+                    unsigned char *body);
+static void frame_of(const PtyNode *node, unsigned long sequence,
+                     unsigned char *message);
+static int check_answer(PtyNode *nodes, const unsigned char *frame);
+static double seconds_since(const struct timespec *start);
+static double parse_headroom(PtyNode *nodes);
+
+int main(int argc, char **argv) {
+  static Gateway encoder;
+  PtyNode nodes[PTY_NODES];
+  char path[64];
+  unsigned char message[MESSAGE_LENGTH];
+  unsigned char answer[LORA_FRAME_LENGTH];
+  unsigned char input[256];
+  unsigned long answer_length = 0;
+  unsigned long frames = PTY_FRAMES;
+  unsigned long sent = 0;
+  unsigned long answered = 0;
+  unsigned long wrong = 0;
+  struct timespec start;
+  struct timespec last;
+  int slave;
+  int status;
+  int i;
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s GATEWAY [FRAMES]\n", argv[0]);
+    return 2;
+  }
+  if (2 < argc)
+    frames = strtoul(argv[2], NULL, 10);
+  if (!Gateway_Init(&encoder, GATEWAY_SALT))
+    return 1;
+  for (i = 0; i < PTY_NODES; i++) {
+    memset(&nodes[i], 0, sizeof(nodes[i]));
+    nodes[i].id = 0xBB + i;
+    nodes[i].reply_id = 0xAA + i;
+    nodes[i].address[0] = 0x70;
+    nodes[i].address[1] = 0xA1 + i;
+    nodes[i].address[2] = 0x10;
+    snprintf(nodes[i].spec, sizeof(nodes[i].spec), "%u:%u:%u:%u:%u:%u",
+             PTY_PORT, nodes[i].id, nodes[i].reply_id, nodes[i].address[0],
+             nodes[i].address[1], nodes[i].address[2]);
+  }
+  const int master = open_module(&slave, path, sizeof(path));
+  if (0 > master) {
+    perror("Error: pseudo-terminal");
+    return 1;
+  }
+  const pid_t gateway = start_gateway(argv[1], path, nodes);
+  if (0 > gateway)
+    return 1;
+  usleep(PTY_START_MS * 1000);
+  Handshake_BuildReady(message, sizeof(message), 0xBB);
+  write(master, message, sizeof(message));
+  Gateway_Encode(PTY_PORT, 0x42, message, message);
+  write(master, message, sizeof(message));
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  last = start;
+  while (answered < frames) {
+    struct pollfd poller = {master, POLLIN, 0};
+    if (sent < frames && sent - answered < PTY_IN_FLIGHT)
+      poller.events |= POLLOUT;
+    if (0 >= poll(&poller, 1, 100) &&
+        PTY_TIMEOUT_MS < seconds_since(&last) * 1000)
+      break;
+    if (poller.revents & POLLOUT) {
+      PtyNode *node = &nodes[sent % PTY_NODES];
+      frame_of(node, node->sent, message);
+      if (sizeof(message) != write(master, message, sizeof(message)))
+        continue;
+      node->sent++;
+      sent++;
+    }
+    if (!(poller.revents & POLLIN))
+      continue;
+    const ssize_t size = read(master, input, sizeof(input));
+    for (i = 0; i < size; i++) {
+      answer[answer_length++] = input[i];
+      if (sizeof(answer) != answer_length)
+        continue;
+      answer_length = 0;
+      if (check_answer(nodes, answer))
+        answered++;
+      else
+        wrong++;
+      clock_gettime(CLOCK_MONOTONIC, &last);
+    }
+  }
+  const double seconds = seconds_since(&start);
+  kill(gateway, SIGTERM);
+  waitpid(gateway, &status, 0);
+  printf("Frames sent: %lu answered: %lu wrong: %lu in %.2f s, %.0f frames/s "
+         "through the daemon\n",
+         sent, answered, wrong, seconds, answered / seconds);
+  printf("Parser alone: %.0f frames/s\n", parse_headroom(nodes));
+  close(slave);
+  close(master);
+  return frames == answered && !wrong ? 0 : 1;
+}
+
+// The slave end stays open here too, so that the pseudo-terminal does not
+// hang up, and raw before the daemon opens it.
+int open_module(int *slave, char *path, const unsigned long size) {
+  struct termios options;
+  const int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (0 > master || 0 != grantpt(master) || 0 != unlockpt(master))
+    return -1;
+  snprintf(path, size, "%s", ptsname(master));
+  *slave = open(path, O_RDWR | O_NOCTTY);
+  if (0 > *slave || 0 != tcgetattr(*slave, &options))
+    return -1;
+  cfmakeraw(&options);
+  tcsetattr(*slave, TCSANOW, &options);
+  fcntl(master, F_SETFL, O_NONBLOCK);
+  return master;
+}
+
+pid_t start_gateway(const char *program, const char *path, PtyNode *nodes) {
+  const char *args[8 + 2 * PTY_NODES];
+  int count = 0;
+  int i;
+  args[count++] = program;
+  args[count++] = "--port";
+  args[count++] = path;
+  args[count++] = "--echo";
+  args[count++] = "--tx-gap-us";
+  args[count++] = "0";
+  for (i = 0; i < PTY_NODES; i++) {
+    args[count++] = "--node";
+    args[count++] = nodes[i].spec;
+  }
+  args[count] = 0;
+  const pid_t child = fork();
+  if (0 != child)
+    return child;
+  const int null = open("/dev/null", O_RDWR);
+  dup2(null, STDIN_FILENO);
+  dup2(null, STDOUT_FILENO);
+  execv(program, (char *const *)args);
+  perror("Error: starting the gateway");
+  _exit(1);
+}
+
+// The body carries the node and its sequence number.
+void body_of(const PtyNode *node, const unsigned long sequence,
+             unsigned char *body) {
+  unsigned char i;
+  memset(body, 0, MESSAGE_BODY_LENGTH);
+  body[0] = node->id;
+  for (i = 0; i < 4; i++)
+    body[1 + i] = (unsigned char)(sequence >> (8 * i));
+}
+
+void frame_of(const PtyNode *node, const unsigned long sequence,
+              unsigned char *message) {
+  unsigned char body[MESSAGE_BODY_LENGTH];
+  body_of(node, sequence, body);
+  Gateway_Encode(PTY_PORT, node->id, body, message);
+}
+
+// The answer of the daemon is the next frame of the node sent back to it.
+int check_answer(PtyNode *nodes, const unsigned char *frame) {
+  unsigned char message[MESSAGE_LENGTH];
+  unsigned char body[MESSAGE_BODY_LENGTH];
+  unsigned char i;
+  for (i = 0; i < PTY_NODES; i++) {
+    PtyNode *node = &nodes[i];
+    if (0 != memcmp(frame, node->address, LORA_HEADER_LENGTH))
+      continue;
+    body_of(node, node->answered, body);
+    Gateway_Encode(PTY_PORT, node->reply_id, body, message);
+    if (0 != memcmp(frame + LORA_HEADER_LENGTH, message, MESSAGE_LENGTH))
+      return 0;
+    node->answered++;
+    return 1;
+  }
+  return 0;
+}
+
+double seconds_since(const struct timespec *start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec - start->tv_sec + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Frames per second through Gateway_Push and Gateway_Pop, no I/O.
+double parse_headroom(PtyNode *nodes) {
+  static Gateway gateway;
+  unsigned char stream[PTY_NODES * MESSAGE_LENGTH];
+  unsigned char body[MESSAGE_BODY_LENGTH];
+  struct timespec start;
+  unsigned long round;
+  int i;
+  Gateway_Init(&gateway, GATEWAY_SALT);
+  for (i = 0; i < PTY_NODES; i++) {
+    Gateway_AddNode(&gateway, PTY_PORT, nodes[i].id, nodes[i].reply_id,
+                    nodes[i].address);
+    frame_of(&nodes[i], i, stream + i * MESSAGE_LENGTH);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (round = 0; round < PTY_PARSE_FRAMES / PTY_NODES; round++) {
+    Gateway_Push(&gateway, stream, sizeof(stream), 0);
+    for (i = 0; i < PTY_NODES; i++)
+      Gateway_Pop(&gateway, i, body);
+  }
+  return gateway.stats.frames / seconds_since(&start);
+}
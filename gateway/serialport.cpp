@@ -0,0 +1,54 @@
+#include "serialport.h"
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+static speed_t speed_of(unsigned long baud);
+
+speed_t speed_of(const unsigned long baud) {
+  switch (baud) {
+  case 1200:
+    return B1200;
+  case 2400:
+    return B2400;
+  case 4800:
+    return B4800;
+  case 9600:
+    return B9600;
+  case 19200:
+    return B19200;
+  case 38400:
+    return B38400;
+  case 57600:
+    return B57600;
+  case 115200:
+    return B115200;
+  }
+  return B0;
+}
+
+// Returns the descriptor, or -1.
+int SerialPort_Open(const char *path, const unsigned long baud) {
+  struct termios options;
+  const speed_t speed = speed_of(baud);
+  if (B0 == speed)
+    return -1;
+  const int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (0 > fd)
+    return -1;
+  if (0 != tcgetattr(fd, &options)) {
+    close(fd);
+    return -1;
+  }
+  cfmakeraw(&options);
+  options.c_cflag |= CLOCAL | CREAD;
+  options.c_cflag &= ~(CSTOPB | CRTSCTS);
+  cfsetispeed(&options, speed);
+  cfsetospeed(&options, speed);
+  if (0 != tcsetattr(fd, TCSANOW, &options)) {
+    close(fd);
+    return -1;
+  }
+  tcflush(fd, TCIOFLUSH);
+  return fd;
+}
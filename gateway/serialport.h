@@ -0,0 +1,11 @@
+#ifndef COMMOTALKINO_GATEWAY_SERIALPORT_H_
+#define COMMOTALKINO_GATEWAY_SERIALPORT_H_
+
+// The UART of the module, through a USB-serial adapter or a pseudo-terminal:
+// raw 8N1, non-blocking. M0 and M1 are tied to ground, NORMAL mode, and AUX
+// is not wired, so the module is configured beforehand, in fixed mode, at the
+// air data rate of the nodes.
+
+int SerialPort_Open(const char *path, unsigned long baud);
+
+#endif // COMMOTALKINO_GATEWAY_SERIALPORT_H_
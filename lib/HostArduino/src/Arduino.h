@@ -0,0 +1,66 @@
+#ifndef HOSTARDUINO_ARDUINO_H_
+#define HOSTARDUINO_ARDUINO_H_
+
+// Host replacement for the Arduino core. Time is virtual and owned by HostSim,
+// the E32 pins are routed to the simulated module, every other pin is a plain
+// latch that can be strapped per node from the command line.
+
+#include "Stream.h"
+#include "avr/pgmspace.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define LED_BUILTIN 13
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint16_t word;
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+int analogRead(uint8_t pin);
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+void interrupts();
+void noInterrupts();
+
+void setup();
+void loop();
+
+class HardwareSerial : public Stream {
+public:
+  HardwareSerial() : bit_us_(1042) {}
+  void begin(unsigned long baud);
+  void end() {}
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  int availableForWrite();
+  void flush();
+  size_t write(uint8_t value) override;
+  using Print::write;
+  operator bool() { return true; }
+
+private:
+  unsigned long bit_us_;
+};
+
+extern HardwareSerial Serial;
+
+#endif // HOSTARDUINO_ARDUINO_H_
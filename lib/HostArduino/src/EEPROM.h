@@ -0,0 +1,36 @@
+#ifndef HOSTARDUINO_EEPROM_H_
+#define HOSTARDUINO_EEPROM_H_
+
+#include "Arduino.h"
+#include "HostConfig.h"
+
+// Host EEPROM of the node, kept in the shared world so the simulator can save
+// it with --state and load it on the next run, as if the board was reset.
+// Every byte actually written costs HOST_EEPROM_WRITE_US, update() skips the
+// bytes that hold the value already.
+
+class EEPROMClass {
+public:
+  uint8_t read(int address);
+  void write(int address, uint8_t value);
+  void update(int address, uint8_t value);
+  uint16_t length() { return HOST_EEPROM_SIZE; }
+
+  template <typename T> T &get(int address, T &value) {
+    uint8_t *bytes = (uint8_t *)&value;
+    for (size_t i = 0; i < sizeof(T); i++)
+      bytes[i] = read(address + (int)i);
+    return value;
+  }
+
+  template <typename T> const T &put(int address, const T &value) {
+    const uint8_t *bytes = (const uint8_t *)&value;
+    for (size_t i = 0; i < sizeof(T); i++)
+      update(address + (int)i, bytes[i]);
+    return value;
+  }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // HOSTARDUINO_EEPROM_H_
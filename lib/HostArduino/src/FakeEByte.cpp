@@ -0,0 +1,385 @@
+#include "FakeEByte.h"
+#include <string.h>
+
+#define BROADCAST_HIGH 0xFF
+#define BROADCAST_LOW 0xFF
+
+static const unsigned long air_rates[] = {300,   1200,  2400,  4800,
+                                          9600,  19200, 19200, 19200};
+
+static const E32Params factory_params = {0xC0, 0x00, 0x00, 0x1A, 0x17, 0x44};
+
+// -----------------------------------------------------------------------------
+// Additional Headers
+
+static uint8_t mode_of(const E32Module *module);
+static int is_fixed(const E32Params *params);
+static uint64_t wake_up_us(const E32Params *params);
+static void sync(E32Air *air, uint64_t now_us);
+static void commit(E32Air *air, int source, uint64_t start_us);
+static void listen(E32Air *air, int receiver, uint64_t now_us);
+static int is_addressed_to(const E32Module *module, const E32Packet *packet);
+static int in_reach(const E32Air *air, int first, int second, int reach);
+static int can_hear(const E32Air *air, int receiver, const E32Packet *packet);
+static unsigned int draw_permille(E32Air *air);
+static int is_lost(E32Air *air);
+static int fade(E32Air *air);
+static void push_rx(E32Module *module, uint8_t value, uint64_t at_us);
+static void drop_unread(E32Module *module, uint64_t now_us);
+static void reply(E32Module *module, const uint8_t *bytes, unsigned long size,
+                  uint64_t at_us);
+static void configure(E32Module *module, uint8_t value, uint64_t at_us);
+
+// -----------------------------------------------------------------------------
+// Module API
+
+void FakeEByte_Init(E32Air *air, const int module_count) {
+  int i;
+  memset(air, 0, sizeof(*air));
+  air->module_count = module_count;
+  for (i = 0; i < module_count; i++) {
+    air->modules[i].params = factory_params;
+    air->modules[i].saved = factory_params;
+    air->modules[i].ready_us = E32_RESET_US;
+  }
+}
+
+unsigned long FakeEByte_AirRate(const E32Params *params) {
+  return air_rates[params->speed & 0x07];
+}
+
+void FakeEByte_SetPins(E32Air *air, const int module, const uint8_t m0,
+                       const uint8_t m1, const uint64_t now_us) {
+  E32Module *self = &air->modules[module];
+  const uint8_t previous = mode_of(self);
+  sync(air, now_us);
+  listen(air, module, now_us);
+  self->m0 = m0 ? 1 : 0;
+  self->m1 = m1 ? 1 : 0;
+  if (mode_of(self) == previous)
+    return;
+  if (self->pending_length)
+    commit(air, module, now_us);
+  self->command_length = 0;
+  self->ready_us = now_us + E32_MODE_SWITCH_US;
+}
+
+int FakeEByte_Aux(E32Air *air, const int module, const uint64_t now_us) {
+  const E32Module *self = &air->modules[module];
+  sync(air, now_us);
+  listen(air, module, now_us);
+  return !(now_us < self->ready_us || now_us < self->tx_until_us ||
+           self->pending_length || now_us < self->rx_busy_until_us);
+}
+
+void FakeEByte_Write(E32Air *air, const int module, const uint8_t *data,
+                     const unsigned long size, const uint64_t now_us) {
+  E32Module *self = &air->modules[module];
+  unsigned long i;
+  sync(air, now_us);
+  listen(air, module, now_us);
+  for (i = 0; i < size; i++) {
+    const uint64_t at_us = now_us + (i + 1) * E32_UART_BYTE_US;
+    switch (mode_of(self)) {
+    case E32_MODE_SLEEP:
+      configure(self, data[i], at_us);
+      break;
+    case E32_MODE_POWER_SAVING:
+      break;
+    default:
+      self->pending[self->pending_length++] = data[i];
+      self->pending_last_us = at_us;
+      self->pending_wake_up = E32_MODE_WAKE_UP == mode_of(self);
+      if (sizeof(self->pending) == self->pending_length)
+        commit(air, module, at_us);
+    }
+  }
+}
+
+int FakeEByte_Available(E32Air *air, const int module, const uint64_t now_us) {
+  const E32Module *self = &air->modules[module];
+  int count = 0;
+  uint16_t at = self->rx_head;
+  sync(air, now_us);
+  listen(air, module, now_us);
+  drop_unread(&air->modules[module], now_us);
+  while (at != self->rx_tail && self->rx_at[at] <= now_us) {
+    count++;
+    at = (at + 1) % E32_RX_QUEUE;
+  }
+  return count;
+}
+
+int FakeEByte_Read(E32Air *air, const int module, const uint64_t now_us) {
+  E32Module *self = &air->modules[module];
+  uint8_t value;
+  sync(air, now_us);
+  listen(air, module, now_us);
+  drop_unread(self, now_us);
+  if (self->rx_head == self->rx_tail || now_us < self->rx_at[self->rx_head])
+    return -1;
+  value = self->rx[self->rx_head];
+  self->rx_head = (self->rx_head + 1) % E32_RX_QUEUE;
+  return value;
+}
+
+// -----------------------------------------------------------------------------
+// Air
+
+uint8_t mode_of(const E32Module *module) {
+  return (uint8_t)(module->m0 | (module->m1 << 1));
+}
+
+int is_fixed(const E32Params *params) { return params->option & 0x80; }
+
+uint64_t wake_up_us(const E32Params *params) {
+  return 250000ULL * (((params->option >> 3) & 0x07) + 1);
+}
+
+void sync(E32Air *air, const uint64_t now_us) {
+  int i;
+  for (i = 0; i < air->module_count; i++) {
+    const E32Module *module = &air->modules[i];
+    const uint64_t due_us =
+        module->pending_last_us + E32_TX_IDLE_BYTES * E32_UART_BYTE_US;
+    if (module->pending_length && due_us <= now_us)
+      commit(air, i, due_us);
+  }
+}
+
+void commit(E32Air *air, const int source, uint64_t start_us) {
+  E32Module *sender = &air->modules[source];
+  E32Packet *packet = &air->log[air->next_seq % E32_AIR_LOG];
+  const unsigned long rate = FakeEByte_AirRate(&sender->params);
+  int i;
+  if (start_us < sender->tx_until_us)
+    start_us = sender->tx_until_us;
+  memset(packet, 0, sizeof(*packet));
+  packet->seq = air->next_seq++;
+  packet->source = source;
+  packet->fixed = is_fixed(&sender->params) &&
+                  E32_HEADER_LENGTH <= sender->pending_length;
+  if (packet->fixed) {
+    packet->address_high = sender->pending[0];
+    packet->address_low = sender->pending[1];
+    packet->channel = sender->pending[2];
+  } else {
+    packet->address_high = sender->params.address_high;
+    packet->address_low = sender->params.address_low;
+    packet->channel = sender->params.channel;
+  }
+  packet->speed = sender->params.speed & 0x07;
+  packet->wake_up = sender->pending_wake_up;
+  packet->length = sender->pending_length;
+  memcpy(packet->data, sender->pending, sender->pending_length);
+  packet->start_us = start_us;
+  if (air->byte_us)
+    packet->end_us = start_us + (uint64_t)(packet->length +
+                                           E32_AIR_OVERHEAD_BYTES) *
+                                    air->byte_us;
+  else
+    packet->end_us = start_us + (uint64_t)(packet->length +
+                                           E32_AIR_OVERHEAD_BYTES) *
+                                    8000000ULL / rate;
+  packet->faded = fade(air);
+  if (packet->wake_up)
+    packet->end_us += wake_up_us(&sender->params);
+  packet->heard_by = 1ULL << source;
+  sender->pending_length = 0;
+  sender->tx_until_us = packet->end_us;
+  sender->stats.tx_packets++;
+  sender->stats.tx_bytes += packet->length;
+  sender->stats.air_us += packet->end_us - packet->start_us;
+  for (i = 0; i < E32_AIR_LOG; i++) {
+    E32Packet *other = &air->log[i];
+    if (other == packet || other->end_us <= packet->start_us ||
+        packet->end_us <= other->start_us ||
+        other->channel != packet->channel || other->source == source ||
+        other->seq >= packet->seq || 0 == other->length ||
+        !in_reach(air, other->source, source, 2 * air->reach))
+      continue;
+    if (!other->collided)
+      air->modules[other->source].stats.collisions++;
+    if (!packet->collided)
+      sender->stats.collisions++;
+    other->collided = 1;
+    packet->collided = 1;
+  }
+}
+
+void listen(E32Air *air, const int receiver, const uint64_t now_us) {
+  E32Module *self = &air->modules[receiver];
+  const uint64_t mask = 1ULL << receiver;
+  int i;
+  for (i = 0; i < E32_AIR_LOG; i++) {
+    E32Packet *packet = &air->log[i];
+    uint64_t at_us;
+    uint8_t offset;
+    if (0 == packet->length || (packet->heard_by & mask) ||
+        now_us < packet->end_us)
+      continue;
+    packet->heard_by |= mask;
+    if (!can_hear(air, receiver, packet)) {
+      if (is_addressed_to(self, packet))
+        self->stats.missed++;
+      continue;
+    }
+    if (packet->faded || is_lost(air)) {
+      self->stats.lost++;
+      continue;
+    }
+    offset = packet->fixed ? E32_HEADER_LENGTH : 0;
+    at_us = packet->end_us + E32_RX_LEAD_US;
+    if (at_us < self->rx_busy_until_us)
+      at_us = self->rx_busy_until_us;
+    reply(self, packet->data + offset, packet->length - offset, at_us);
+    self->stats.rx_packets++;
+    self->stats.rx_bytes += packet->length - offset;
+  }
+}
+
+int is_addressed_to(const E32Module *module, const E32Packet *packet) {
+  if (packet->channel != module->params.channel)
+    return 0;
+  return (BROADCAST_HIGH == packet->address_high &&
+          BROADCAST_LOW == packet->address_low) ||
+         (packet->address_high == module->params.address_high &&
+          packet->address_low == module->params.address_low);
+}
+
+int in_reach(const E32Air *air, const int first, const int second,
+             const int reach) {
+  const int distance = first < second ? second - first : first - second;
+  return 0 == air->reach || distance <= reach;
+}
+
+int can_hear(const E32Air *air, const int receiver, const E32Packet *packet) {
+  const E32Module *self = &air->modules[receiver];
+  const uint8_t mode = mode_of(self);
+  int i;
+  if (!in_reach(air, receiver, packet->source, air->reach))
+    return 0;
+  if (!is_addressed_to(self, packet) || packet->collided)
+    return 0;
+  // LoRa settings follow the air data rate, a receiver tuned to another one
+  // does not even see the preamble.
+  if ((self->params.speed & 0x07) != packet->speed)
+    return 0;
+  if (E32_MODE_SLEEP == mode ||
+      (E32_MODE_POWER_SAVING == mode && !packet->wake_up))
+    return 0;
+  if (packet->start_us < self->ready_us)
+    return 0;
+  for (i = 0; i < E32_AIR_LOG; i++) {
+    const E32Packet *own = &air->log[i];
+    if (own->length && own->source == receiver &&
+        own->start_us < packet->end_us &&
+        packet->start_us < own->end_us + air->turnaround_us)
+      return 0;
+  }
+  return 1;
+}
+
+// xorshift32 in the shared air, so that a run is the same for the same seed.
+unsigned int draw_permille(E32Air *air) {
+  uint32_t x = air->loss_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  air->loss_state = x;
+  return x % 1000;
+}
+
+int is_lost(E32Air *air) {
+  return air->loss_permille && draw_permille(air) < air->loss_permille;
+}
+
+// Moves the Gilbert model one packet on.
+int fade(E32Air *air) {
+  if (0 == air->burst_permille)
+    return 0;
+  if (air->fading)
+    air->fading = air->burst_length * draw_permille(air) >= 1000;
+  else
+    air->fading = draw_permille(air) < air->burst_permille;
+  return air->fading;
+}
+
+// -----------------------------------------------------------------------------
+// UART towards the MCU
+
+void push_rx(E32Module *module, const uint8_t value, const uint64_t at_us) {
+  const uint16_t next = (module->rx_tail + 1) % E32_RX_QUEUE;
+  if (next == module->rx_head) {
+    module->stats.overruns++;
+    return;
+  }
+  module->rx[module->rx_tail] = value;
+  module->rx_at[module->rx_tail] = at_us;
+  module->rx_tail = next;
+}
+
+// Bytes that arrived while the MCU receive buffer was already full are lost,
+// the same way SoftwareSerial drops them when nobody reads in time.
+void drop_unread(E32Module *module, const uint64_t now_us) {
+  uint16_t arrived = 0;
+  uint16_t at = module->rx_head;
+  uint16_t keep;
+  while (at != module->rx_tail && module->rx_at[at] <= now_us) {
+    arrived++;
+    at = (at + 1) % E32_RX_QUEUE;
+  }
+  if (arrived <= HOST_UART_RX_BUFFER)
+    return;
+  module->stats.overruns += arrived - HOST_UART_RX_BUFFER;
+  keep = (module->rx_head + HOST_UART_RX_BUFFER) % E32_RX_QUEUE;
+  while (at != module->rx_tail) {
+    module->rx[keep] = module->rx[at];
+    module->rx_at[keep] = module->rx_at[at];
+    keep = (keep + 1) % E32_RX_QUEUE;
+    at = (at + 1) % E32_RX_QUEUE;
+  }
+  module->rx_tail = keep;
+}
+
+void reply(E32Module *module, const uint8_t *bytes, const unsigned long size,
+           const uint64_t at_us) {
+  unsigned long i;
+  for (i = 0; i < size; i++)
+    push_rx(module, bytes[i], at_us + (i + 1) * E32_UART_BYTE_US);
+  module->rx_busy_until_us = at_us + size * E32_UART_BYTE_US;
+}
+
+void configure(E32Module *module, const uint8_t value, const uint64_t at_us) {
+  static const uint8_t version[] = {0xC3, 0x32, 0x27, 0x14};
+  uint8_t *command = module->command;
+  if (0 == module->command_length && (value < 0xC0 || 0xC4 < value))
+    return;
+  command[module->command_length++] = value;
+  if (0xC0 == command[0] || 0xC2 == command[0]) {
+    if (sizeof(module->command) > module->command_length)
+      return;
+    memcpy(&module->params, command, sizeof(module->params));
+    module->params.head = 0xC0;
+    // C0 survives a power cycle, C2 only lasts until the next one.
+    if (0xC0 == command[0])
+      module->saved = module->params;
+    reply(module, (const uint8_t *)&module->params, sizeof(module->params),
+          at_us);
+  } else {
+    if (command[module->command_length - 1] != command[0]) {
+      module->command_length = 0;
+      return;
+    }
+    if (3 > module->command_length)
+      return;
+    if (0xC1 == command[0])
+      reply(module, (const uint8_t *)&module->params, sizeof(module->params),
+            at_us);
+    else if (0xC3 == command[0])
+      reply(module, version, sizeof(version), at_us);
+    else
+      module->ready_us = at_us + E32_RESET_US;
+  }
+  module->command_length = 0;
+}
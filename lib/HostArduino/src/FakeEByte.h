@@ -0,0 +1,124 @@
+#ifndef HOSTARDUINO_FAKEEBYTE_H_
+#define HOSTARDUINO_FAKEEBYTE_H_
+
+#include "HostConfig.h"
+#include <stdint.h>
+
+// In-process model of an EByte E32 LoRa module and the air between several of
+// them. Every call carries the virtual time of the calling node in
+// microseconds. Air traffic is resolved lazily: a packet is delivered to a
+// module the first time that module is touched after the packet ended.
+
+#define E32_PACKET_MAX 58
+#define E32_HEADER_LENGTH 3
+#define E32_UART_BYTE_US 1042
+#define E32_MODE_SWITCH_US 2000
+#define E32_RESET_US 50000
+#define E32_RX_LEAD_US 2500
+#define E32_TX_IDLE_BYTES 3
+#define E32_AIR_OVERHEAD_BYTES 10
+#define E32_AIR_LOG 64
+#define E32_RX_QUEUE 256
+
+#define E32_MODE_NORMAL 0
+#define E32_MODE_WAKE_UP 1
+#define E32_MODE_POWER_SAVING 2
+#define E32_MODE_SLEEP 3
+
+typedef struct E32Params {
+  uint8_t head;
+  uint8_t address_high;
+  uint8_t address_low;
+  uint8_t speed;
+  uint8_t channel;
+  uint8_t option;
+} E32Params;
+
+typedef struct E32Packet {
+  uint32_t seq;
+  int source;
+  uint8_t channel;
+  uint8_t address_high;
+  uint8_t address_low;
+  uint8_t speed;
+  uint8_t fixed;
+  uint8_t wake_up;
+  uint8_t collided;
+  uint8_t faded;
+  uint8_t length;
+  uint8_t data[E32_PACKET_MAX + E32_HEADER_LENGTH];
+  uint64_t start_us;
+  uint64_t end_us;
+  uint64_t heard_by;
+} E32Packet;
+
+typedef struct E32Stats {
+  unsigned long tx_packets;
+  unsigned long tx_bytes;
+  unsigned long rx_packets;
+  unsigned long rx_bytes;
+  unsigned long collisions;
+  unsigned long missed;
+  unsigned long lost;
+  unsigned long overruns;
+  uint64_t air_us;
+} E32Stats;
+
+typedef struct E32Module {
+  E32Params params;
+  E32Params saved;
+  uint8_t m0;
+  uint8_t m1;
+  uint64_t ready_us;
+  uint8_t pending[E32_PACKET_MAX + E32_HEADER_LENGTH];
+  uint8_t pending_length;
+  uint8_t pending_wake_up;
+  uint64_t pending_last_us;
+  uint64_t tx_until_us;
+  uint8_t rx[E32_RX_QUEUE];
+  uint64_t rx_at[E32_RX_QUEUE];
+  uint16_t rx_head;
+  uint16_t rx_tail;
+  uint64_t rx_busy_until_us;
+  uint8_t command[6];
+  uint8_t command_length;
+  E32Stats stats;
+} E32Module;
+
+// Modules stand on a line in index order. With reach set, a module hears only
+// the ones up to reach places away, and two packets only collide when some
+// module can hear both. 0 puts every module in range of every other. Every
+// packet a module would hear is lost with loss_permille on top, each module
+// drawing on its own.
+//
+// Burst loss follows a Gilbert model: a packet starts a fade with
+// burst_permille, the fade lasts burst_length packets on average and nobody
+// hears the packets in it. byte_us, when set, replaces the air time per byte
+// of the air data rate, and a module hears nothing until turnaround_us after
+// the end of its own packet.
+typedef struct E32Air {
+  int module_count;
+  int reach;
+  unsigned int loss_permille;
+  uint32_t loss_state;
+  unsigned int burst_permille;
+  unsigned int burst_length;
+  uint8_t fading;
+  unsigned long byte_us;
+  unsigned long turnaround_us;
+  E32Module modules[HOST_MAX_NODES];
+  E32Packet log[E32_AIR_LOG];
+  uint32_t next_seq;
+} E32Air;
+
+void FakeEByte_Init(E32Air *air, int module_count);
+void FakeEByte_SetPins(E32Air *air, int module, uint8_t m0, uint8_t m1,
+                       uint64_t now_us);
+int FakeEByte_Aux(E32Air *air, int module, uint64_t now_us);
+void FakeEByte_Write(E32Air *air, int module, const uint8_t *data,
+                     unsigned long size, uint64_t now_us);
+int FakeEByte_Available(E32Air *air, int module, uint64_t now_us);
+int FakeEByte_Read(E32Air *air, int module, uint64_t now_us);
+unsigned long FakeEByte_AirRate(const E32Params *params);
+
+#endif // HOSTARDUINO_FAKEEBYTE_H_
@@ -0,0 +1,167 @@
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "HostSim.h"
+#include "SoftwareSerial.h"
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+
+static char console_line[256];
+static unsigned long console_length;
+static unsigned long random_state = 1;
+
+// -----------------------------------------------------------------------------
+// Pins
+
+void pinMode(const uint8_t pin, const uint8_t mode) {
+  if (INPUT_PULLUP == mode && pin < HOST_MAX_PINS)
+    HostSim_Self()->pins[pin] = HIGH;
+}
+
+int digitalRead(const uint8_t pin) {
+  const HostNode *self = HostSim_Self();
+  HostSim_Advance(HOST_POLL_US);
+  if (HOST_E32_AUX == pin)
+    return FakeEByte_Aux(&HostSim_World()->air, HostSim_Node(),
+                         HostSim_Now());
+  if (HOST_MAX_PINS <= pin)
+    return LOW;
+  if (0 <= self->straps[pin])
+    return self->straps[pin];
+  return self->pins[pin];
+}
+
+void digitalWrite(const uint8_t pin, const uint8_t value) {
+  HostNode *self = HostSim_Self();
+  HostSim_Advance(HOST_POLL_US);
+  if (HOST_MAX_PINS <= pin)
+    return;
+  self->pins[pin] = value ? HIGH : LOW;
+  if (HOST_E32_M0 == pin || HOST_E32_M1 == pin)
+    FakeEByte_SetPins(&HostSim_World()->air, HostSim_Node(),
+                      self->pins[HOST_E32_M0], self->pins[HOST_E32_M1],
+                      HostSim_Now());
+}
+
+// A pin reads full scale or zero, after its strap or latch.
+int analogRead(const uint8_t pin) {
+  return HIGH == digitalRead(pin) ? 1023 : 0;
+}
+
+// -----------------------------------------------------------------------------
+// Time
+
+unsigned long millis() {
+  HostSim_Advance(HOST_POLL_US);
+  return (unsigned long)(HostSim_Now() / 1000);
+}
+
+unsigned long micros() {
+  HostSim_Advance(HOST_POLL_US);
+  return (unsigned long)HostSim_Now();
+}
+
+void delay(const unsigned long ms) { HostSim_Advance(ms * 1000ULL); }
+
+void delayMicroseconds(const unsigned int us) { HostSim_Advance(us); }
+
+void interrupts() { HostSim_Interrupts(1); }
+
+void noInterrupts() { HostSim_Interrupts(0); }
+
+// -----------------------------------------------------------------------------
+// Random
+
+void randomSeed(const unsigned long seed) { random_state = seed ? seed : 1; }
+
+long random(const long max) {
+  random_state = random_state * 1103515245UL + 12345UL;
+  return max ? (long)((random_state >> 16) % (unsigned long)max) : 0;
+}
+
+long random(const long min, const long max) {
+  return max <= min ? min : min + random(max - min);
+}
+
+// -----------------------------------------------------------------------------
+// Console, a 64 byte transmit buffer drained at the configured baud rate
+
+void HardwareSerial::begin(const unsigned long baud) {
+  bit_us_ = baud ? 1000000UL / baud : 1;
+}
+
+int HardwareSerial::availableForWrite() {
+  const uint64_t now = HostSim_Now();
+  const uint64_t free_us = HostSim_Self()->console_free_us;
+  const uint64_t char_us = 10ULL * bit_us_;
+  if (free_us <= now)
+    return HOST_CONSOLE_BUFFER;
+  return HOST_CONSOLE_BUFFER - (int)((free_us - now + char_us - 1) / char_us);
+}
+
+void HardwareSerial::flush() {
+  const uint64_t free_us = HostSim_Self()->console_free_us;
+  if (HostSim_Now() < free_us)
+    HostSim_Advance(free_us - HostSim_Now());
+}
+
+size_t HardwareSerial::write(const uint8_t value) {
+  HostNode *self = HostSim_Self();
+  const uint64_t char_us = 10ULL * bit_us_;
+  const uint64_t full_us = char_us * HOST_CONSOLE_BUFFER;
+  if (self->console_free_us < HostSim_Now())
+    self->console_free_us = HostSim_Now();
+  if (HostSim_Now() + full_us <= self->console_free_us)
+    HostSim_Advance(self->console_free_us + char_us - full_us - HostSim_Now());
+  self->console_free_us += char_us;
+  if ('\n' == value) {
+    if (console_length && '\r' == console_line[console_length - 1])
+      console_length--;
+    HostSim_Console(console_line, console_length);
+    console_length = 0;
+  } else if (console_length < sizeof(console_line)) {
+    console_line[console_length++] = (char)value;
+  }
+  return 1;
+}
+
+// -----------------------------------------------------------------------------
+// E32 UART
+
+int SoftwareSerial::available() {
+  HostSim_Advance(HOST_POLL_US);
+  return FakeEByte_Available(&HostSim_World()->air, HostSim_Node(),
+                             HostSim_Now());
+}
+
+int SoftwareSerial::read() {
+  return FakeEByte_Read(&HostSim_World()->air, HostSim_Node(), HostSim_Now());
+}
+
+size_t SoftwareSerial::write(const uint8_t *buffer, const size_t size) {
+  FakeEByte_Write(&HostSim_World()->air, HostSim_Node(), buffer, size,
+                  HostSim_Now());
+  HostSim_Advance((uint64_t)size * E32_UART_BYTE_US);
+  return size;
+}
+
+// -----------------------------------------------------------------------------
+// EEPROM
+
+uint8_t EEPROMClass::read(const int address) {
+  if (address < 0 || HOST_EEPROM_SIZE <= address)
+    return 0xFF;
+  return HostSim_Self()->eeprom[address];
+}
+
+void EEPROMClass::write(const int address, const uint8_t value) {
+  if (address < 0 || HOST_EEPROM_SIZE <= address)
+    return;
+  HostSim_Self()->eeprom[address] = value;
+  HostSim_Advance(HOST_EEPROM_WRITE_US);
+}
+
+void EEPROMClass::update(const int address, const uint8_t value) {
+  if (read(address) != value)
+    write(address, value);
+}
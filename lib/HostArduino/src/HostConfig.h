@@ -0,0 +1,63 @@
+#ifndef HOSTARDUINO_HOSTCONFIG_H_
+#define HOSTARDUINO_HOSTCONFIG_H_
+
+// Wiring of the simulated E32 module. Defaults follow src/main.h, override
+// them with build flags when the sketch uses other pins.
+
+#ifndef HOST_E32_M0
+#define HOST_E32_M0 7
+#endif
+
+#ifndef HOST_E32_M1
+#define HOST_E32_M1 6
+#endif
+
+#ifndef HOST_E32_AUX
+#define HOST_E32_AUX 5
+#endif
+
+// Pins read by every node unless overridden with --strap, as a comma
+// separated list of NODE:PIN=LEVEL entries.
+
+#ifndef HOST_DEFAULT_STRAPS
+#define HOST_DEFAULT_STRAPS ""
+#endif
+
+#ifndef HOST_MAX_NODES
+#define HOST_MAX_NODES 32
+#endif
+
+#define HOST_MAX_PINS 32
+
+// EEPROM of the ATmega328, erased to 0xFF unless loaded with --state.
+
+#define HOST_EEPROM_SIZE 1024
+#define HOST_EEPROM_WRITE_US 3300
+
+// Virtual CPU time charged to a node for every polling call (millis, pin
+// reads, serial availability), so that busy loops make time progress.
+
+#ifndef HOST_POLL_US
+#define HOST_POLL_US 10
+#endif
+
+// How far a node may run past the earliest other node before handing over.
+// Anything sent on air takes milliseconds to arrive, so a small lookahead
+// keeps causality while cutting the number of context switches.
+
+#ifndef HOST_LOOKAHEAD_US
+#define HOST_LOOKAHEAD_US 500
+#endif
+
+#define HOST_CONSOLE_BUFFER 64
+
+// Receive buffer of the AVR SoftwareSerial (_SS_MAX_RX_BUFF)
+
+#ifndef HOST_UART_RX_BUFFER
+#define HOST_UART_RX_BUFFER 64
+#endif
+
+#define HOST_DEFAULT_NODES 2
+#define HOST_DEFAULT_SECONDS 600
+
+#endif // HOSTARDUINO_HOSTCONFIG_H_
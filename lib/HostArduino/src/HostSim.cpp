@@ -0,0 +1,380 @@
+#include "HostSim.h"
+#include "Arduino.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static HostWorld *world;
+static int me = -1;
+static uint64_t now_us;
+static uint64_t horizon_us;
+
+static void (*timer_isr)();
+static uint64_t timer_period_us;
+static uint64_t timer_next_us;
+static int in_isr;
+static int irq_enabled = 1;
+
+// -----------------------------------------------------------------------------
+// Additional Headers
+
+static void usage(const char *program);
+static int parse_straps(const char *list);
+static int strap_ids(const char *spec);
+static int load_state(const char *directory);
+static int save_state(const char *directory);
+static void run_node(int index);
+static void take_baton();
+static void pass_baton(int next);
+static void update_horizon();
+static void yield();
+static void finish();
+static void print_summary();
+
+// -----------------------------------------------------------------------------
+// Scheduler
+
+// Time spent inside the timer interrupt is stolen from the interrupted code,
+// so the target moves forward by the duration of every handler run.
+void HostSim_Advance(const uint64_t us) {
+  uint64_t target_us = now_us + us;
+  while (timer_isr && irq_enabled && !in_isr && timer_next_us <= target_us) {
+    const uint64_t fired_us =
+        timer_next_us < now_us ? now_us : timer_next_us;
+    now_us = fired_us;
+    if (now_us >= horizon_us + HOST_LOOKAHEAD_US && !world->finishing)
+      yield();
+    timer_next_us = fired_us + timer_period_us;
+    in_isr = 1;
+    timer_isr();
+    in_isr = 0;
+    target_us += now_us - fired_us;
+  }
+  now_us = target_us;
+  if (now_us >= horizon_us + HOST_LOOKAHEAD_US && !world->finishing)
+    yield();
+}
+
+void HostSim_AttachTimer(const unsigned long period_us, void (*isr)()) {
+  timer_period_us = period_us ? period_us : 1;
+  timer_next_us = now_us + timer_period_us;
+  timer_isr = isr;
+}
+
+void HostSim_Interrupts(const int enabled) { irq_enabled = enabled; }
+
+uint64_t HostSim_Now() { return now_us; }
+
+int HostSim_Node() { return me; }
+
+HostWorld *HostSim_World() { return world; }
+
+HostNode *HostSim_Self() { return &world->nodes[me]; }
+
+void HostSim_Console(const char *line, const unsigned long size) {
+  char prefix[16];
+  if (!world->verbose && !world->finishing)
+    return;
+  snprintf(prefix, sizeof(prefix), "[node%d] ", me);
+  fwrite(prefix, 1, strlen(prefix), stdout);
+  fwrite(line, 1, size, stdout);
+  fputc('\n', stdout);
+  fflush(stdout);
+}
+
+void take_baton() {
+  while (0 != sem_wait(&world->nodes[me].baton) && EINTR == errno)
+    ;
+  if (world->finishing)
+    finish();
+  now_us = world->nodes[me].wake_us;
+  update_horizon();
+}
+
+void pass_baton(const int next) { sem_post(&world->nodes[next].baton); }
+
+void update_horizon() {
+  int i;
+  horizon_us = world->end_us;
+  for (i = 0; i < world->node_count; i++) {
+    if (i != me && !world->nodes[i].exited &&
+        world->nodes[i].wake_us < horizon_us)
+      horizon_us = world->nodes[i].wake_us;
+  }
+}
+
+void yield() {
+  int i;
+  int next = me;
+  world->nodes[me].wake_us = now_us;
+  for (i = 0; i < world->node_count; i++) {
+    if (!world->nodes[i].exited &&
+        world->nodes[i].wake_us < world->nodes[next].wake_us)
+      next = i;
+  }
+  if (world->end_us <= world->nodes[next].wake_us) {
+    world->finishing = 1;
+    if (0 == me)
+      finish();
+    pass_baton(0);
+    take_baton();
+    return;
+  }
+  if (next == me) {
+    update_horizon();
+    return;
+  }
+  pass_baton(next);
+  take_baton();
+}
+
+void finish() {
+  if (PrintReport)
+    PrintReport();
+  fflush(stdout);
+  world->nodes[me].exited = 1;
+  if (me + 1 < world->node_count)
+    pass_baton(me + 1);
+  _exit(0);
+}
+
+// -----------------------------------------------------------------------------
+// Processes
+
+void run_node(const int index) {
+  me = index;
+  randomSeed(world->seed + index);
+  take_baton();
+  setup();
+  for (;;)
+    loop();
+}
+
+int main(int argc, char **argv) {
+  int i;
+  int failed = 0;
+  int node_count = HOST_DEFAULT_NODES;
+  unsigned long seconds = HOST_DEFAULT_SECONDS;
+  unsigned long seed = 1;
+  int verbose = 0;
+  const char *state = NULL;
+  const char *id_straps = NULL;
+  int reach = 0;
+  double loss = 0;
+  double burst = 0;
+  int burst_length = 0;
+  unsigned long byte_us = 0;
+  unsigned long turnaround_ms = 0;
+  const char *straps[HOST_MAX_NODES * 4];
+  int strap_count = 0;
+  for (i = 1; i < argc; i++) {
+    if (0 == strcmp("--nodes", argv[i]) && i + 1 < argc)
+      node_count = atoi(argv[++i]);
+    else if (0 == strcmp("--seconds", argv[i]) && i + 1 < argc)
+      seconds = strtoul(argv[++i], NULL, 10);
+    else if (0 == strcmp("--seed", argv[i]) && i + 1 < argc)
+      seed = strtoul(argv[++i], NULL, 10);
+    else if (0 == strcmp("--strap", argv[i]) && i + 1 < argc &&
+             strap_count < (int)(sizeof(straps) / sizeof(*straps)))
+      straps[strap_count++] = argv[++i];
+    else if (0 == strcmp("--reach", argv[i]) && i + 1 < argc)
+      reach = atoi(argv[++i]);
+    else if (0 == strcmp("--loss", argv[i]) && i + 1 < argc)
+      loss = atof(argv[++i]);
+    else if (0 == strcmp("--burst", argv[i]) && i + 1 < argc &&
+             2 == sscanf(argv[i + 1], "%lf:%d", &burst, &burst_length))
+      i++;
+    else if (0 == strcmp("--air-byte-us", argv[i]) && i + 1 < argc)
+      byte_us = strtoul(argv[++i], NULL, 10);
+    else if (0 == strcmp("--turnaround", argv[i]) && i + 1 < argc)
+      turnaround_ms = strtoul(argv[++i], NULL, 10);
+    else if (0 == strcmp("--id-straps", argv[i]) && i + 1 < argc)
+      id_straps = argv[++i];
+    else if (0 == strcmp("--verbose", argv[i]))
+      verbose = 1;
+    else if (0 == strcmp("--state", argv[i]) && i + 1 < argc)
+      state = argv[++i];
+    else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (node_count < 1 || HOST_MAX_NODES < node_count) {
+    fprintf(stderr, "Nodes must be between 1 and %d\n", HOST_MAX_NODES);
+    return 2;
+  }
+  world = (HostWorld *)mmap(NULL, sizeof(HostWorld), PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (MAP_FAILED == world) {
+    perror("mmap");
+    return 1;
+  }
+  memset(world, 0, sizeof(*world));
+  world->node_count = node_count;
+  world->verbose = verbose;
+  world->seed = seed;
+  world->end_us = (uint64_t)seconds * 1000000ULL;
+  FakeEByte_Init(&world->air, node_count);
+  world->air.reach = reach < 0 ? 0 : reach;
+  world->air.loss_permille =
+      loss <= 0 ? 0 : 100 <= loss ? 1000 : (unsigned int)(loss * 10 + 0.5);
+  world->air.loss_state = 2463534242UL ^ seed;
+  world->air.burst_permille =
+      burst <= 0 ? 0 : 100 <= burst ? 1000 : (unsigned int)(burst * 10 + 0.5);
+  world->air.burst_length = burst_length < 1 ? 1 : burst_length;
+  world->air.byte_us = byte_us;
+  world->air.turnaround_us = turnaround_ms * 1000;
+  for (i = 0; i < node_count; i++) {
+    sem_init(&world->nodes[i].baton, 1, 0);
+    memset(world->nodes[i].straps, -1, sizeof(world->nodes[i].straps));
+    memset(world->nodes[i].eeprom, 0xFF, sizeof(world->nodes[i].eeprom));
+  }
+  if (state && !load_state(state))
+    return 2;
+  if (id_straps && !strap_ids(id_straps))
+    return 2;
+  if (!parse_straps(HOST_DEFAULT_STRAPS))
+    return 2;
+  for (i = 0; i < strap_count; i++) {
+    if (!parse_straps(straps[i]))
+      return 2;
+  }
+  fflush(stdout);
+  pid_t pids[HOST_MAX_NODES];
+  for (i = 0; i < node_count; i++) {
+    pids[i] = fork();
+    if (0 == pids[i])
+      run_node(i);
+  }
+  pass_baton(0);
+  for (i = 0; i < node_count; i++) {
+    int status;
+    const pid_t pid = wait(&status);
+    if (!WIFEXITED(status) || 0 != WEXITSTATUS(status)) {
+      int j;
+      fprintf(stderr, "Node process %d died, stopping the simulation\n", pid);
+      for (j = 0; j < node_count; j++)
+        kill(pids[j], SIGKILL);
+      failed = 1;
+      break;
+    }
+  }
+  while (0 < wait(NULL))
+    ;
+  print_summary();
+  if (state && !failed && !save_state(state))
+    return 1;
+  return failed;
+}
+
+void usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s [--nodes N] [--seconds S] [--seed N] "
+          "[--strap NODE:PIN=LEVEL[,...]] [--id-straps PIN:BITS] [--reach N] "
+          "[--loss PERCENT] [--burst PERCENT:LENGTH] [--air-byte-us N] "
+          "[--turnaround MS] [--verbose] [--state DIR]\n",
+          program);
+}
+
+int parse_straps(const char *list) {
+  while (*list) {
+    int node;
+    int pin;
+    int level;
+    int consumed;
+    if (3 != sscanf(list, "%d:%d=%d%n", &node, &pin, &level, &consumed) ||
+        node < 0 || HOST_MAX_NODES <= node || pin < 0 ||
+        HOST_MAX_PINS <= pin) {
+      fprintf(stderr, "Invalid strap: %s\n", list);
+      return 0;
+    }
+    world->nodes[node].straps[pin] = (int8_t)(level ? HIGH : LOW);
+    list += consumed;
+    if (',' == *list)
+      list++;
+  }
+  return 1;
+}
+
+// Every node reads its own index on BITS pins from PIN, least significant
+// first, LOW for 1 like a DIP switch closed to ground.
+int strap_ids(const char *spec) {
+  int first;
+  int bits;
+  int node;
+  int bit;
+  if (2 != sscanf(spec, "%d:%d", &first, &bits) || first < 0 || bits < 1 ||
+      HOST_MAX_PINS < first + bits) {
+    fprintf(stderr, "Invalid id straps: %s\n", spec);
+    return 0;
+  }
+  for (node = 0; node < world->node_count; node++) {
+    for (bit = 0; bit < bits; bit++)
+      world->nodes[node].straps[first + bit] =
+          (int8_t)((node >> bit) & 1 ? LOW : HIGH);
+  }
+  return 1;
+}
+
+// What a node keeps across a reset: its EEPROM and the parameters its E32
+// saved with C0. A missing file is a node fresh from the factory.
+int load_state(const char *directory) {
+  int i;
+  for (i = 0; i < world->node_count; i++) {
+    char path[512];
+    E32Module *module = &world->air.modules[i];
+    snprintf(path, sizeof(path), "%s/node%d.state", directory, i);
+    FILE *file = fopen(path, "rb");
+    if (!file)
+      continue;
+    const int complete =
+        1 == fread(world->nodes[i].eeprom, sizeof(world->nodes[i].eeprom), 1,
+                   file) &&
+        1 == fread(&module->saved, sizeof(module->saved), 1, file);
+    fclose(file);
+    if (!complete) {
+      fprintf(stderr, "Invalid state file: %s\n", path);
+      return 0;
+    }
+    module->params = module->saved;
+  }
+  return 1;
+}
+
+int save_state(const char *directory) {
+  int i;
+  for (i = 0; i < world->node_count; i++) {
+    char path[512];
+    const E32Module *module = &world->air.modules[i];
+    snprintf(path, sizeof(path), "%s/node%d.state", directory, i);
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+      perror(path);
+      return 0;
+    }
+    fwrite(world->nodes[i].eeprom, sizeof(world->nodes[i].eeprom), 1, file);
+    fwrite(&module->saved, sizeof(module->saved), 1, file);
+    fclose(file);
+  }
+  return 1;
+}
+
+void print_summary() {
+  int i;
+  const double seconds = world->end_us / 1e6;
+  printf("\n| %4s | %8s | %8s | %10s | %6s | %6s | %8s | %8s |\n", "Node",
+         "Tx", "Rx", "Collisions", "Missed", "Lost", "Overruns", "Air %");
+  for (i = 0; i < world->node_count; i++) {
+    const E32Stats *stats = &world->air.modules[i].stats;
+    printf("| %4d | %8lu | %8lu | %10lu | %6lu | %6lu | %8lu | %8.2f |\n", i,
+           stats->tx_packets, stats->rx_packets, stats->collisions,
+           stats->missed, stats->lost, stats->overruns,
+           100.0 * stats->air_us / world->end_us);
+  }
+  printf("Simulated %.0f s\n", seconds);
+}
@@ -0,0 +1,50 @@
+#ifndef HOSTARDUINO_HOSTSIM_H_
+#define HOSTARDUINO_HOSTSIM_H_
+
+#include "FakeEByte.h"
+#include "HostConfig.h"
+#include <semaphore.h>
+#include <stdint.h>
+
+// Conservative discrete-event scheduler for several sketch instances. Every
+// node is a forked process with its own copy of the firmware globals, the
+// world below lives in shared memory and a baton semaphore makes sure only
+// the node with the earliest virtual time runs.
+
+typedef struct HostNode {
+  sem_t baton;
+  uint64_t wake_us;
+  int exited;
+  int8_t straps[HOST_MAX_PINS];
+  uint8_t pins[HOST_MAX_PINS];
+  uint8_t eeprom[HOST_EEPROM_SIZE];
+  uint64_t console_free_us;
+} HostNode;
+
+typedef struct HostWorld {
+  int node_count;
+  int verbose;
+  int finishing;
+  uint64_t end_us;
+  unsigned long seed;
+  HostNode nodes[HOST_MAX_NODES];
+  E32Air air;
+} HostWorld;
+
+void HostSim_Advance(uint64_t us);
+
+// Periodic timer interrupt of the calling node, it runs at virtual time
+// boundaries while interrupts are enabled and never nests.
+void HostSim_AttachTimer(unsigned long period_us, void (*isr)());
+void HostSim_Interrupts(int enabled);
+
+uint64_t HostSim_Now();
+int HostSim_Node();
+HostWorld *HostSim_World();
+HostNode *HostSim_Self();
+void HostSim_Console(const char *line, unsigned long size);
+
+// Called once per node when the run is over, if the sketch defines it.
+void PrintReport() __attribute__((weak));
+
+#endif // HOSTARDUINO_HOSTSIM_H_
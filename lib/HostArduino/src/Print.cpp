@@ -0,0 +1,101 @@
+#include "Print.h"
+#include <stdio.h>
+#include <string.h>
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t written = 0;
+  while (size--)
+    written += write(*buffer++);
+  return written;
+}
+
+size_t Print::write(const char *text) {
+  return write((const uint8_t *)text, strlen(text));
+}
+
+size_t Print::print(const __FlashStringHelper *text) {
+  const char *at = reinterpret_cast<const char *>(text);
+  size_t written = 0;
+  unsigned char value;
+  while ((value = pgm_read_byte(at++)))
+    written += write(value);
+  return written;
+}
+
+size_t Print::print(const char *text) { return write(text); }
+
+size_t Print::print(const char value) { return write((uint8_t)value); }
+
+size_t Print::print(const unsigned char value, const int base) {
+  return print_number(value, base);
+}
+
+size_t Print::print(const int value, const int base) {
+  return print((long)value, base);
+}
+
+size_t Print::print(const unsigned int value, const int base) {
+  return print_number(value, base);
+}
+
+size_t Print::print(const long value, const int base) {
+  if (DEC == base && value < 0)
+    return print('-') + print_number((unsigned long)-value, base);
+  return print_number((unsigned long)value, base);
+}
+
+size_t Print::print(const unsigned long value, const int base) {
+  return print_number(value, base);
+}
+
+size_t Print::print(const double value, const int digits) {
+  char text[48];
+  snprintf(text, sizeof(text), "%.*f", digits, value);
+  return write(text);
+}
+
+size_t Print::println() { return write("\r\n"); }
+
+size_t Print::println(const __FlashStringHelper *text) {
+  return print(text) + println();
+}
+
+size_t Print::println(const char *text) { return print(text) + println(); }
+
+size_t Print::println(const char value) { return print(value) + println(); }
+
+size_t Print::println(const unsigned char value, const int base) {
+  return print(value, base) + println();
+}
+
+size_t Print::println(const int value, const int base) {
+  return print(value, base) + println();
+}
+
+size_t Print::println(const unsigned int value, const int base) {
+  return print(value, base) + println();
+}
+
+size_t Print::println(const long value, const int base) {
+  return print(value, base) + println();
+}
+
+size_t Print::println(const unsigned long value, const int base) {
+  return print(value, base) + println();
+}
+
+size_t Print::println(const double value, const int digits) {
+  return print(value, digits) + println();
+}
+
+size_t Print::print_number(unsigned long value, const int base) {
+  char text[8 * sizeof(unsigned long) + 1];
+  char *at = &text[sizeof(text) - 1];
+  *at = '\0';
+  do {
+    const unsigned long digit = value % base;
+    *--at = (char)(digit < 10 ? '0' + digit : 'A' + digit - 10);
+    value /= base;
+  } while (value);
+  return write(at);
+}
@@ -0,0 +1,55 @@
+#ifndef HOSTARDUINO_PRINT_H_
+#define HOSTARDUINO_PRINT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "avr/pgmspace.h"
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+// A string kept in flash, as F() makes it. Print reads it a byte at a time.
+class __FlashStringHelper;
+#define F(text) (reinterpret_cast<const __FlashStringHelper *>(PSTR(text)))
+
+// Subset of the Arduino Print class, enough for the sketches in this repo.
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t value) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *buffer, size_t size) {
+    return write((const uint8_t *)buffer, size);
+  }
+  size_t write(const char *text);
+
+  size_t print(const __FlashStringHelper *text);
+  size_t print(const char *text);
+  size_t print(char value);
+  size_t print(unsigned char value, int base = DEC);
+  size_t print(int value, int base = DEC);
+  size_t print(unsigned int value, int base = DEC);
+  size_t print(long value, int base = DEC);
+  size_t print(unsigned long value, int base = DEC);
+  size_t print(double value, int digits = 2);
+
+  size_t println();
+  size_t println(const __FlashStringHelper *text);
+  size_t println(const char *text);
+  size_t println(char value);
+  size_t println(unsigned char value, int base = DEC);
+  size_t println(int value, int base = DEC);
+  size_t println(unsigned int value, int base = DEC);
+  size_t println(long value, int base = DEC);
+  size_t println(unsigned long value, int base = DEC);
+  size_t println(double value, int digits = 2);
+
+private:
+  size_t print_number(unsigned long value, int base);
+};
+
+#endif // HOSTARDUINO_PRINT_H_
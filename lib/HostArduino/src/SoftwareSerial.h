@@ -0,0 +1,30 @@
+#ifndef HOSTARDUINO_SOFTWARESERIAL_H_
+#define HOSTARDUINO_SOFTWARESERIAL_H_
+
+#include "Arduino.h"
+
+// Host SoftwareSerial wired to the node's simulated E32 UART. Writes block the
+// node for the bit time of every byte, as the AVR bit-banged transmitter does,
+// and bytes arriving while HOST_UART_RX_BUFFER are left unread get dropped.
+
+class SoftwareSerial : public Stream {
+public:
+  SoftwareSerial(uint8_t rx, uint8_t tx) : rx_(rx), tx_(tx) {}
+  void begin(unsigned long baud) { (void)baud; }
+  void end() {}
+  bool listen() { return true; }
+  int available() override;
+  int read() override;
+  int peek() override { return -1; }
+  void flush() {}
+  size_t write(uint8_t value) override { return write(&value, 1); }
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+  operator bool() { return true; }
+
+private:
+  uint8_t rx_;
+  uint8_t tx_;
+};
+
+#endif // HOSTARDUINO_SOFTWARESERIAL_H_
@@ -0,0 +1,13 @@
+#ifndef HOSTARDUINO_STREAM_H_
+#define HOSTARDUINO_STREAM_H_
+
+#include "Print.h"
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+#endif // HOSTARDUINO_STREAM_H_
@@ -0,0 +1,19 @@
+#ifndef HOSTARDUINO_AVR_PGMSPACE_H_
+#define HOSTARDUINO_AVR_PGMSPACE_H_
+
+// The host has one address space: data in "flash" is plain const data and the
+// _P functions are the ones of the C library.
+
+#include <stdio.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(text) (text)
+
+#define pgm_read_byte(address) (*(const unsigned char *)(address))
+
+#define strlen_P strlen
+#define sprintf_P sprintf
+#define snprintf_P snprintf
+
+#endif // HOSTARDUINO_AVR_PGMSPACE_H_
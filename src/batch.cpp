@@ -0,0 +1,70 @@
+#include "batch.h"
+#include <string.h>
+
+void Batch_Init(Batch *batch, const unsigned char capacity,
+                const unsigned long deadline_ms, BatchFlush flush) {
+  memset(batch, 0, sizeof(*batch));
+  batch->capacity =
+      sizeof(batch->body) < capacity ? sizeof(batch->body) : capacity;
+  batch->deadline_ms = deadline_ms;
+  batch->flush = flush;
+}
+
+// Returns 0 when the record can never fit in a body.
+int Batch_Add(Batch *batch, const unsigned char type, const void *value,
+              const unsigned char length, const unsigned long now_ms) {
+  if (BATCH_END == type || 0x0F < type || BATCH_MAX_VALUE < length ||
+      batch->capacity < length + 1)
+    return 0;
+  if (batch->capacity - batch->length < length + 1)
+    Batch_Flush(batch);
+  if (0 == batch->length)
+    batch->opened_ms = now_ms;
+  batch->body[batch->length++] = (unsigned char)(type << 4 | length);
+  memcpy(batch->body + batch->length, value, length);
+  batch->length += length;
+  batch->records++;
+  if (batch->capacity == batch->length)
+    Batch_Flush(batch);
+  return 1;
+}
+
+void Batch_Poll(Batch *batch, const unsigned long now_ms) {
+  if (batch->length && batch->deadline_ms <= now_ms - batch->opened_ms)
+    Batch_Flush(batch);
+}
+
+void Batch_Flush(Batch *batch) {
+  if (0 == batch->length)
+    return;
+  memset(batch->body + batch->length, 0, batch->capacity - batch->length);
+  batch->flush(batch->body);
+  batch->length = 0;
+  batch->frames++;
+}
+
+// -----------------------------------------------------------------------------
+// Iterator
+
+void BatchIterator_Init(BatchIterator *iterator, const unsigned char *body,
+                        const unsigned char size) {
+  iterator->body = body;
+  iterator->size = size;
+  iterator->position = 0;
+}
+
+// Stops at the end marker and at a record running past the body.
+int BatchIterator_Next(BatchIterator *iterator, BatchRecord *record) {
+  if (iterator->size <= iterator->position)
+    return 0;
+  const unsigned char header = iterator->body[iterator->position];
+  const unsigned char length = header & 0x0F;
+  if (BATCH_END == header >> 4 ||
+      iterator->size - iterator->position < length + 1)
+    return 0;
+  record->type = header >> 4;
+  record->length = length;
+  record->value = iterator->body + iterator->position + 1;
+  iterator->position += length + 1;
+  return 1;
+}
@@ -0,0 +1,60 @@
+#ifndef COMMOTALKINO_SRC_BATCH_H_
+#define COMMOTALKINO_SRC_BATCH_H_
+
+#include "../lib/CommoTalkie/messageconfig.h"
+
+// Packs small application records into one message body. Every record is a
+// one byte header, the type in the high nibble and the value length in the low
+// one, followed by the value. A zero header, or the end of the body, ends the
+// batch. The batch is handed to the flush callback when the next record does
+// not fit, when the oldest record waited deadline_ms, or on Batch_Flush.
+
+#define BATCH_MAX_VALUE 15
+
+// A BATCH_PACKED value is a record of a codec.h schema.
+enum BatchType {
+  BATCH_END = 0,
+  BATCH_COUNTER,
+  BATCH_SAMPLE,
+  BATCH_STATUS,
+  BATCH_PACKED
+};
+
+typedef void (*BatchFlush)(const unsigned char *body);
+
+typedef struct Batch {
+  unsigned char body[MESSAGE_BODY_LENGTH];
+  unsigned char capacity;
+  unsigned char length;
+  unsigned long opened_ms;
+  unsigned long deadline_ms;
+  BatchFlush flush;
+  unsigned long records;
+  unsigned long frames;
+} Batch;
+
+// Points into the pulled body, the value is never copied.
+typedef struct BatchRecord {
+  unsigned char type;
+  unsigned char length;
+  const unsigned char *value;
+} BatchRecord;
+
+typedef struct BatchIterator {
+  const unsigned char *body;
+  unsigned char size;
+  unsigned char position;
+} BatchIterator;
+
+void Batch_Init(Batch *batch, unsigned char capacity, unsigned long deadline_ms,
+                BatchFlush flush);
+int Batch_Add(Batch *batch, unsigned char type, const void *value,
+              unsigned char length, unsigned long now_ms);
+void Batch_Poll(Batch *batch, unsigned long now_ms);
+void Batch_Flush(Batch *batch);
+
+void BatchIterator_Init(BatchIterator *iterator, const unsigned char *body,
+                        unsigned char size);
+int BatchIterator_Next(BatchIterator *iterator, BatchRecord *record);
+
+#endif // COMMOTALKINO_SRC_BATCH_H_
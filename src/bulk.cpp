@@ -0,0 +1,330 @@
+#include "bulk.h"
+#include <string.h>
+
+#define SENDER_IDLE 0
+#define SENDER_START_DUE 1
+#define SENDER_AWAIT_START 2
+#define SENDER_SENDING 3
+#define SENDER_AWAIT_STATUS 4
+
+static unsigned char chunk_length(unsigned long length, unsigned int index);
+static unsigned char window_mask(unsigned int base, unsigned int chunks);
+static void put_index(BulkFrame *frame, unsigned int index);
+static unsigned int get_index(const BulkFrame *frame);
+static unsigned long start_length(const BulkFrame *frame);
+static unsigned int start_crc(const BulkFrame *frame);
+static int is_new_transfer(const BulkReceiver *receiver,
+                           const BulkFrame *frame);
+static void start_transfer(BulkReceiver *receiver, const BulkFrame *frame);
+static void store_chunk(BulkReceiver *receiver, const BulkFrame *frame);
+static void deliver_in_order(BulkReceiver *receiver);
+
+// CRC-16/CCITT, bit by bit: no table to keep in flash.
+unsigned int Bulk_Crc(unsigned int crc, const unsigned char *data,
+                      const unsigned char length) {
+  unsigned char i;
+  unsigned char bit;
+  for (i = 0; i < length; i++) {
+    crc ^= (unsigned int)data[i] << 8;
+    for (bit = 0; bit < 8; bit++)
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    crc &= 0xFFFF;
+  }
+  return crc;
+}
+
+unsigned char chunk_length(const unsigned long length,
+                           const unsigned int index) {
+  const unsigned long offset = (unsigned long)index * BULK_CHUNK_LENGTH;
+  if (length <= offset)
+    return 0;
+  return BULK_CHUNK_LENGTH < length - offset ? BULK_CHUNK_LENGTH
+                                             : (unsigned char)(length - offset);
+}
+
+// The chunks from base the window covers, bit 0 for base.
+unsigned char window_mask(const unsigned int base, const unsigned int chunks) {
+  const unsigned int count =
+      BULK_WINDOW < chunks - base ? BULK_WINDOW : chunks - base;
+  return (unsigned char)((1U << count) - 1);
+}
+
+void put_index(BulkFrame *frame, const unsigned int index) {
+  frame->index[0] = (unsigned char)index;
+  frame->index[1] = (unsigned char)(index >> 8);
+}
+
+unsigned int get_index(const BulkFrame *frame) {
+  return frame->index[0] | (unsigned int)frame->index[1] << 8;
+}
+
+// -----------------------------------------------------------------------------
+// Sender
+
+void BulkSender_Init(BulkSender *sender) {
+  memset(sender, 0, sizeof(*sender));
+}
+
+int BulkSender_Busy(const BulkSender *sender) {
+  return SENDER_IDLE != sender->state;
+}
+
+// Reads the whole source once for the CRC, a chunk at a time. Returns 0 when
+// a transfer is still going on or the length does not fit in the index.
+int BulkSender_Start(BulkSender *sender, const unsigned long length,
+                     BulkRead read) {
+  unsigned char chunk[BULK_CHUNK_LENGTH];
+  unsigned int index;
+  if (BulkSender_Busy(sender) || BULK_MAX_LENGTH < length)
+    return 0;
+  sender->transfer = (sender->transfer + 1) & 0x0F;
+  sender->length = length;
+  sender->chunks =
+      (unsigned int)((length + BULK_CHUNK_LENGTH - 1) / BULK_CHUNK_LENGTH);
+  sender->read = read;
+  sender->crc = 0xFFFF;
+  for (index = 0; index < sender->chunks; index++) {
+    const unsigned char size = chunk_length(length, index);
+    read((unsigned long)index * BULK_CHUNK_LENGTH, chunk, size);
+    sender->crc = Bulk_Crc(sender->crc, chunk, size);
+  }
+  sender->base = 0;
+  sender->next = 0;
+  sender->held = 0;
+  sender->due = 0;
+  sender->result = BULK_OPEN;
+  sender->state = SENDER_START_DUE;
+  return 1;
+}
+
+// Fills the frame with the next one of the burst and returns 0 once the burst
+// is over and a STATUS is due.
+int BulkSender_Next(BulkSender *sender, BulkFrame *frame) {
+  unsigned char i;
+  if (SENDER_START_DUE == sender->state) {
+    memset(frame, 0, sizeof(*frame));
+    frame->kind = BULK_START | sender->transfer;
+    for (i = 0; i < 4; i++)
+      frame->data[i] = (unsigned char)(sender->length >> (8 * i));
+    frame->data[4] = (unsigned char)sender->crc;
+    frame->data[5] = (unsigned char)(sender->crc >> 8);
+    sender->state = SENDER_AWAIT_START;
+    sender->frames++;
+    return 1;
+  }
+  if (SENDER_SENDING != sender->state)
+    return 0;
+  if (!sender->due) {
+    sender->state = SENDER_AWAIT_STATUS;
+    return 0;
+  }
+  for (i = 0; !(sender->due & (1 << i)); i++)
+    ;
+  sender->due &= ~(1 << i);
+  const unsigned int index = sender->base + i;
+  memset(frame, 0, sizeof(*frame));
+  if (index < sender->next)
+    sender->retransmissions++;
+  else
+    sender->next = index + 1;
+  put_index(frame, index);
+  sender->read((unsigned long)index * BULK_CHUNK_LENGTH, frame->data,
+               chunk_length(sender->length, index));
+  frame->kind = (sender->due ? BULK_DATA : BULK_DATA_LAST) | sender->transfer;
+  if (!sender->due)
+    sender->state = SENDER_AWAIT_STATUS;
+  sender->frames++;
+  return 1;
+}
+
+// Returns how many bytes the STATUS confirms in order for the first time. The
+// next burst has every chunk of the window the bitmap does not hold.
+unsigned long BulkSender_OnStatus(BulkSender *sender, const BulkFrame *status) {
+  if (SENDER_AWAIT_START != sender->state &&
+      SENDER_AWAIT_STATUS != sender->state)
+    return 0;
+  if (BULK_STATUS != (status->kind & 0xF0) ||
+      sender->transfer != (status->kind & 0x0F))
+    return 0;
+  const unsigned int base = get_index(status);
+  if (base < sender->base || sender->chunks < base)
+    return 0;
+  const unsigned long before = (unsigned long)sender->base * BULK_CHUNK_LENGTH;
+  unsigned long after = (unsigned long)base * BULK_CHUNK_LENGTH;
+  if (sender->length < after)
+    after = sender->length;
+  sender->base = base;
+  if (sender->next < base)
+    sender->next = base;
+  const unsigned char mask = window_mask(base, sender->chunks);
+  sender->held = (unsigned char)(status->data[0] << 1) & mask;
+  sender->result = status->data[1];
+  if (BULK_OPEN != sender->result) {
+    if (BULK_COMPLETE == sender->result)
+      sender->completed++;
+    sender->state = SENDER_IDLE;
+  } else {
+    sender->due = mask & ~sender->held;
+    sender->state = SENDER_SENDING;
+  }
+  return after - before;
+}
+
+// START again, or the last chunk sent that is not held yet, so that the
+// STATUS it asks for reports every hole at once.
+void BulkSender_Timeout(BulkSender *sender) {
+  unsigned char i;
+  if (SENDER_AWAIT_START == sender->state) {
+    sender->state = SENDER_START_DUE;
+  } else if (SENDER_AWAIT_STATUS == sender->state) {
+    const unsigned char missing =
+        window_mask(sender->base, sender->chunks) & ~sender->held;
+    sender->due = 0;
+    for (i = 0; i < BULK_WINDOW; i++) {
+      if ((missing & (1 << i)) && sender->base + i < sender->next)
+        sender->due = (unsigned char)(1 << i);
+    }
+    if (!sender->due)
+      sender->due = missing;
+    sender->state = SENDER_SENDING;
+  } else {
+    return;
+  }
+  sender->timeouts++;
+}
+
+// -----------------------------------------------------------------------------
+// Receiver
+
+// With a buffer the chunks go straight into it and write, when given, follows
+// the transfer in order. Without one write takes every chunk.
+void BulkReceiver_Init(BulkReceiver *receiver, unsigned char *buffer,
+                       const unsigned long capacity, BulkWrite write) {
+  memset(receiver, 0, sizeof(*receiver));
+  receiver->buffer = buffer;
+  receiver->capacity = capacity;
+  receiver->write = write;
+}
+
+// Returns 1 when the sender waits for a STATUS.
+int BulkReceiver_Push(BulkReceiver *receiver, const BulkFrame *frame) {
+  const unsigned char kind = frame->kind & 0xF0;
+  const unsigned char transfer = frame->kind & 0x0F;
+  receiver->frames++;
+  if (BULK_START == kind) {
+    if (is_new_transfer(receiver, frame))
+      start_transfer(receiver, frame);
+    receiver->status_due = 1;
+    return 1;
+  }
+  if ((BULK_DATA != kind && BULK_DATA_LAST != kind) || !receiver->started ||
+      transfer != receiver->transfer)
+    return 0;
+  if (BULK_OPEN == receiver->result)
+    store_chunk(receiver, frame);
+  else
+    receiver->duplicates++;
+  if (BULK_DATA_LAST == kind)
+    receiver->status_due = 1;
+  return receiver->status_due;
+}
+
+unsigned long start_length(const BulkFrame *frame) {
+  unsigned long length = 0;
+  unsigned char i;
+  for (i = 0; i < 4; i++)
+    length |= (unsigned long)frame->data[i] << (8 * i);
+  return length;
+}
+
+unsigned int start_crc(const BulkFrame *frame) {
+  return frame->data[4] | (unsigned int)frame->data[5] << 8;
+}
+
+// A repeated START of the current transfer only asks for its STATUS again.
+// The transfer number alone does not tell: a sender that rebooted numbers
+// from 1 again, so a START that announces another length or CRC is a new
+// transfer whatever its number.
+int is_new_transfer(const BulkReceiver *receiver, const BulkFrame *frame) {
+  return !receiver->started || (frame->kind & 0x0F) != receiver->transfer ||
+         start_length(frame) != receiver->length ||
+         start_crc(frame) != receiver->expected_crc;
+}
+
+void start_transfer(BulkReceiver *receiver, const BulkFrame *frame) {
+  receiver->transfer = frame->kind & 0x0F;
+  receiver->started = 1;
+  receiver->length = start_length(frame);
+  receiver->expected_crc = start_crc(frame);
+  receiver->crc = 0xFFFF;
+  receiver->base = 0;
+  receiver->held = 0;
+  receiver->result = BULK_OPEN;
+  if (BULK_MAX_LENGTH < receiver->length ||
+      (receiver->buffer && receiver->capacity < receiver->length)) {
+    receiver->chunks = 0;
+    receiver->result = BULK_REFUSED;
+    return;
+  }
+  receiver->chunks = (unsigned int)((receiver->length + BULK_CHUNK_LENGTH - 1) /
+                                    BULK_CHUNK_LENGTH);
+  deliver_in_order(receiver);
+}
+
+void store_chunk(BulkReceiver *receiver, const BulkFrame *frame) {
+  const unsigned int index = get_index(frame);
+  if (receiver->chunks <= index || index < receiver->base) {
+    receiver->duplicates += index < receiver->base;
+    return;
+  }
+  const unsigned int offset = index - receiver->base;
+  if (BULK_WINDOW <= offset)
+    return;
+  if (receiver->held & (1 << offset)) {
+    receiver->duplicates++;
+    return;
+  }
+  const unsigned char length = chunk_length(receiver->length, index);
+  if (receiver->buffer)
+    memcpy(receiver->buffer + (unsigned long)index * BULK_CHUNK_LENGTH,
+           frame->data, length);
+  else
+    memcpy(receiver->slots[index % BULK_WINDOW], frame->data, length);
+  receiver->held |= (unsigned char)(1 << offset);
+  deliver_in_order(receiver);
+}
+
+// Moves the base over every chunk held from it on, and closes the transfer
+// once the base passes the last one.
+void deliver_in_order(BulkReceiver *receiver) {
+  while (receiver->held & 1) {
+    const unsigned long offset =
+        (unsigned long)receiver->base * BULK_CHUNK_LENGTH;
+    const unsigned char length = chunk_length(receiver->length, receiver->base);
+    const unsigned char *data = receiver->buffer
+                                    ? receiver->buffer + offset
+                                    : receiver->slots[receiver->base %
+                                                      BULK_WINDOW];
+    receiver->crc = Bulk_Crc(receiver->crc, data, length);
+    if (receiver->write)
+      receiver->write(offset, data, length);
+    receiver->delivered += length;
+    receiver->base++;
+    receiver->held >>= 1;
+  }
+  if (receiver->base != receiver->chunks)
+    return;
+  receiver->result =
+      receiver->crc == receiver->expected_crc ? BULK_COMPLETE : BULK_CORRUPT;
+  if (BULK_COMPLETE == receiver->result)
+    receiver->completed++;
+}
+
+void BulkReceiver_BuildStatus(BulkReceiver *receiver, BulkFrame *status) {
+  memset(status, 0, sizeof(*status));
+  status->kind = BULK_STATUS | receiver->transfer;
+  put_index(status, receiver->base);
+  status->data[0] = receiver->held >> 1;
+  status->data[1] = receiver->result;
+  receiver->status_due = 0;
+}
@@ -0,0 +1,110 @@
+#ifndef COMMOTALKINO_SRC_BULK_H_
+#define COMMOTALKINO_SRC_BULK_H_
+
+#include "../lib/CommoTalkie/messageconfig.h"
+
+// Bulk transfer of a buffer or a byte stream longer than a message body, in
+// numbered chunks of BULK_CHUNK_LENGTH bytes. The sender announces the length
+// and a CRC16 of the whole transfer in a START frame and waits for the first
+// STATUS, then sends up to BULK_WINDOW chunks from the first one not confirmed
+// and flags the last of the burst. The receiver answers it with a STATUS: the
+// next chunk it needs in order plus a bitmap of the ones it already holds
+// beyond it. Every chunk missing from the bitmap is a NACK and goes again in
+// the next burst, nothing else does. After a timeout the sender only probes
+// with the last chunk in flight. A START that announces another length or
+// CRC than the transfer the receiver holds opens a new one even under the same
+// number, the numbers start over when the sender reboots.
+//
+// Neither end keeps a copy of the transfer: the sender reads every chunk from
+// its source when it goes on air, and the receiver either writes chunks
+// straight into the buffer of the caller, in any order, or streams them to a
+// callback in order, holding at most BULK_WINDOW - 1 chunks meanwhile.
+
+#define BULK_WINDOW 8
+#define BULK_HEADER_LENGTH 3
+#define BULK_CHUNK_LENGTH (MESSAGE_BODY_LENGTH - BULK_HEADER_LENGTH)
+#define BULK_MAX_CHUNKS 0xFFFFUL
+#define BULK_MAX_LENGTH (BULK_MAX_CHUNKS * BULK_CHUNK_LENGTH)
+
+// The kind in the high nibble of the first byte, the transfer number in the
+// low one.
+enum BulkKind {
+  BULK_START = 0x10,
+  BULK_DATA = 0x20,
+  BULK_DATA_LAST = 0x30,
+  BULK_STATUS = 0x40
+};
+
+enum BulkResult { BULK_OPEN = 0, BULK_COMPLETE, BULK_CORRUPT, BULK_REFUSED };
+
+// START: data holds the length, 4 bytes, and the CRC16, 2 bytes, little
+// endian. DATA: index is the chunk. STATUS: index is the next chunk expected,
+// data[0] the bitmap of the chunks after it and data[1] the BulkResult.
+typedef struct BulkFrame {
+  unsigned char kind;
+  unsigned char index[2];
+  unsigned char data[BULK_CHUNK_LENGTH];
+} BulkFrame;
+
+// Fills data with length bytes of the transfer from offset.
+typedef void (*BulkRead)(unsigned long offset, unsigned char *data,
+                         unsigned char length);
+// Takes length bytes of the transfer from offset, always in order.
+typedef void (*BulkWrite)(unsigned long offset, const unsigned char *data,
+                          unsigned char length);
+
+typedef struct BulkSender {
+  unsigned char transfer;
+  unsigned char state;
+  unsigned char result;
+  unsigned long length;
+  unsigned int chunks;
+  unsigned int crc;
+  BulkRead read;
+  unsigned int base;
+  unsigned int next;
+  unsigned char held;
+  unsigned char due;
+  unsigned long frames;
+  unsigned long retransmissions;
+  unsigned long timeouts;
+  unsigned long completed;
+} BulkSender;
+
+typedef struct BulkReceiver {
+  unsigned char transfer;
+  unsigned char started;
+  unsigned char result;
+  unsigned char status_due;
+  unsigned long length;
+  unsigned int chunks;
+  unsigned int crc;
+  unsigned int expected_crc;
+  unsigned char *buffer;
+  unsigned long capacity;
+  BulkWrite write;
+  unsigned int base;
+  unsigned char held;
+  unsigned char slots[BULK_WINDOW][BULK_CHUNK_LENGTH];
+  unsigned long frames;
+  unsigned long duplicates;
+  unsigned long delivered;
+  unsigned long completed;
+} BulkReceiver;
+
+unsigned int Bulk_Crc(unsigned int crc, const unsigned char *data,
+                      unsigned char length);
+
+void BulkSender_Init(BulkSender *sender);
+int BulkSender_Start(BulkSender *sender, unsigned long length, BulkRead read);
+int BulkSender_Next(BulkSender *sender, BulkFrame *frame);
+unsigned long BulkSender_OnStatus(BulkSender *sender, const BulkFrame *status);
+void BulkSender_Timeout(BulkSender *sender);
+int BulkSender_Busy(const BulkSender *sender);
+
+void BulkReceiver_Init(BulkReceiver *receiver, unsigned char *buffer,
+                       unsigned long capacity, BulkWrite write);
+int BulkReceiver_Push(BulkReceiver *receiver, const BulkFrame *frame);
+void BulkReceiver_BuildStatus(BulkReceiver *receiver, BulkFrame *status);
+
+#endif // COMMOTALKINO_SRC_BULK_H_
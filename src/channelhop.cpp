@@ -0,0 +1,121 @@
+#include "channelhop.h"
+#include <string.h>
+
+static unsigned char coprime(unsigned char stride, unsigned char count);
+static unsigned char misses(unsigned int history);
+
+unsigned char coprime(unsigned char stride, const unsigned char count) {
+  unsigned char a;
+  unsigned char b;
+  for (;; stride = stride % (count - 1) + 1) {
+    a = stride;
+    b = count;
+    while (b) {
+      const unsigned char rest = a % b;
+      a = b;
+      b = rest;
+    }
+    if (1 == a)
+      return stride;
+  }
+}
+
+unsigned char misses(unsigned int history) {
+  unsigned char count = 0;
+  for (; history; history &= history - 1)
+    count++;
+  return count;
+}
+
+void ChannelHop_Init(ChannelHop *hop, const short proposer,
+                     const unsigned char address_high,
+                     const unsigned char address_low,
+                     const unsigned char base, const unsigned char count,
+                     const unsigned char hop_after,
+                     const unsigned char lost_after) {
+  memset(hop, 0, sizeof(*hop));
+  hop->proposer = proposer;
+  hop->base = base;
+  hop->count = count ? count : 1;
+  hop->home = (unsigned char)((address_high * 7 + address_low) % hop->count);
+  if (1 < hop->count)
+    hop->stride = coprime(
+        (unsigned char)((address_high + address_low / hop->count) %
+                            (hop->count - 1) +
+                        1),
+        hop->count);
+  hop->proposed = CHANNEL_HOP_KEEP;
+  hop->confirm = CHANNEL_HOP_KEEP;
+  hop->due = CHANNEL_HOP_KEEP;
+  hop->hop_after = hop_after;
+  hop->lost_after = lost_after;
+}
+
+unsigned char ChannelHop_Channel(const ChannelHop *hop,
+                                 const unsigned char index) {
+  return hop->base + (hop->home + index * hop->stride) % hop->count;
+}
+
+// Command for the frame about to be sent. Sending a confirm makes the switch
+// due.
+unsigned char ChannelHop_Command(ChannelHop *hop) {
+  if (CHANNEL_HOP_KEEP != hop->confirm) {
+    hop->due = hop->confirm;
+    hop->confirm = CHANNEL_HOP_KEEP;
+    return CHANNEL_HOP_CONFIRM | hop->due;
+  }
+  if (hop->proposer && CHANNEL_HOP_KEEP != hop->proposed)
+    return CHANNEL_HOP_PROPOSE | hop->proposed;
+  return 0;
+}
+
+// Command of a frame just received. Any other answer to a proposal drops it,
+// the proposer asks again while the channel stays bad.
+void ChannelHop_Handle(ChannelHop *hop, const unsigned char command) {
+  const unsigned char index = command & CHANNEL_HOP_MASK;
+  if (hop->proposer) {
+    if (CHANNEL_HOP_KEEP == hop->proposed)
+      return;
+    if ((CHANNEL_HOP_CONFIRM | hop->proposed) == command)
+      hop->due = hop->proposed;
+    hop->proposed = CHANNEL_HOP_KEEP;
+    return;
+  }
+  if ((command & CHANNEL_HOP_PROPOSE) && index < hop->count)
+    hop->confirm = index;
+}
+
+void ChannelHop_Success(ChannelHop *hop) {
+  hop->history = (hop->history << 1) & 0xFFFF;
+  hop->lost = 0;
+}
+
+void ChannelHop_Timeout(ChannelHop *hop) {
+  hop->history = (hop->history << 1 | 1) & 0xFFFF;
+  hop->lost++;
+  if (!hop->proposer || 1 == hop->count)
+    return;
+  if (hop->lost_after <= hop->lost) {
+    hop->due = CHANNEL_HOP_KEEP != hop->proposed
+                   ? hop->proposed
+                   : (hop->index + 1) % hop->count;
+    hop->proposed = CHANNEL_HOP_KEEP;
+    hop->searches++;
+  } else if (CHANNEL_HOP_KEEP == hop->proposed &&
+             hop->hop_after <= misses(hop->history)) {
+    hop->proposed = (hop->index + 1) % hop->count;
+  }
+}
+
+// The channel to switch to now, or CHANNEL_HOP_KEEP. The history of the old
+// channel does not count against the new one.
+unsigned char ChannelHop_Take(ChannelHop *hop) {
+  if (CHANNEL_HOP_KEEP == hop->due)
+    return CHANNEL_HOP_KEEP;
+  hop->index = hop->due;
+  hop->due = CHANNEL_HOP_KEEP;
+  hop->history = 0;
+  hop->lost = 0;
+  hop->hops++;
+  return ChannelHop_Channel(hop, hop->index);
+}
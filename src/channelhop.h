@@ -0,0 +1,57 @@
+#ifndef COMMOTALKINO_SRC_CHANNELHOP_H_
+#define COMMOTALKINO_SRC_CHANNELHOP_H_
+
+// Channel of a pair out of count channels from base. The address of the pair
+// gives both peers the same hop sequence, a home channel at index 0 and a
+// stride prime to count, so the sequence goes through every channel before
+// coming back home. Pairs with consecutive addresses start on consecutive
+// channels, and two pairs sharing a channel hop apart unless their strides
+// match.
+//
+// The proposer watches the last 16 exchanges, and with hop_after timeouts
+// among them it proposes the next index. As with the air data rate, the
+// responder confirms in its next frame and switches right after sending it,
+// and the proposer switches on receiving the confirm. The responder only
+// moves on a proposal, so the proposer does the searching: after lost_after
+// timeouts in a row it moves to the index it proposed, the confirm may have
+// been lost, or else to the next one, and keeps going around the sequence
+// until it hears the responder again. The command takes one byte of the body:
+//
+//   0 | CHANNEL_HOP_PROPOSE + index | CHANNEL_HOP_CONFIRM + index
+
+#define CHANNEL_HOP_MAX 32
+#define CHANNEL_HOP_PROPOSE 0x80
+#define CHANNEL_HOP_CONFIRM 0x40
+#define CHANNEL_HOP_MASK 0x1F
+#define CHANNEL_HOP_KEEP 0xFF
+
+typedef struct ChannelHop {
+  short proposer;
+  unsigned char base;
+  unsigned char count;
+  unsigned char home;
+  unsigned char stride;
+  unsigned char index;
+  unsigned char proposed;
+  unsigned char confirm;
+  unsigned char due;
+  unsigned char hop_after;
+  unsigned char lost_after;
+  unsigned char lost;
+  unsigned int history;
+  unsigned long hops;
+  unsigned long searches;
+} ChannelHop;
+
+void ChannelHop_Init(ChannelHop *hop, short proposer,
+                     unsigned char address_high, unsigned char address_low,
+                     unsigned char base, unsigned char count,
+                     unsigned char hop_after, unsigned char lost_after);
+unsigned char ChannelHop_Channel(const ChannelHop *hop, unsigned char index);
+unsigned char ChannelHop_Command(ChannelHop *hop);
+void ChannelHop_Handle(ChannelHop *hop, unsigned char command);
+void ChannelHop_Success(ChannelHop *hop);
+void ChannelHop_Timeout(ChannelHop *hop);
+unsigned char ChannelHop_Take(ChannelHop *hop);
+
+#endif // COMMOTALKINO_SRC_CHANNELHOP_H_
@@ -0,0 +1,39 @@
+#include "codec.h"
+
+// 0, -1, 1, -2, 2... to 0, 1, 2, 3, 4..., small either side of zero.
+uint32_t Codec_ZigZag(const int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value < 0 ? -1 : 0);
+}
+
+int32_t Codec_UnZigZag(const uint32_t value) {
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+unsigned char Codec_PutVarint(unsigned char *out, const unsigned char room,
+                              uint32_t value) {
+  unsigned char length = 0;
+  do {
+    if (room <= length)
+      return 0;
+    out[length] = (unsigned char)(value & 0x7F);
+    value >>= 7;
+    if (value)
+      out[length] |= 0x80;
+    length++;
+  } while (value);
+  return length;
+}
+
+unsigned char Codec_GetVarint(const unsigned char *in, const unsigned char size,
+                              uint32_t *value) {
+  unsigned char length = 0;
+  *value = 0;
+  while (length < size && length < CODEC_MAX_VARINT) {
+    const unsigned char byte = in[length];
+    *value |= (uint32_t)(byte & 0x7F) << (7 * length);
+    length++;
+    if (!(byte & 0x80))
+      return length;
+  }
+  return 0;
+}
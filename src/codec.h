@@ -0,0 +1,135 @@
+#ifndef COMMOTALKINO_SRC_CODEC_H_
+#define COMMOTALKINO_SRC_CODEC_H_
+
+#include <stdint.h>
+#include <string.h>
+
+// Compact encoding of application records. A schema lists the fields of a
+// record once, and CODEC_DEFINE turns it into the record, its encoder and its
+// decoder at compile time:
+//
+//   #define SENSOR(FIELD) FIELD(DELTA, count) FIELD(SIGNED, celsius) ...
+//   CODEC_DEFINE(Sensor, SENSOR)
+//
+// gives SensorRecord, Sensor_Encode and Sensor_Decode. The kinds of field:
+//
+//   UNSIGNED  varint, 7 bits a byte from the low ones, 1 byte up to 127
+//   SIGNED    zig-zag, then varint: 1 byte from -64 to 63
+//   DELTA     the difference to the field of a reference record, as SIGNED
+//   FLAG      one bit, the flags of a record go first, 8 to a byte
+//
+// The reference is the last record the other end is known to hold, one per
+// peer, and the caller moves it: on every record over a transport that loses
+// nothing and keeps the order, like the window, otherwise only on its ACK.
+// Both ends start from a record of zeros.
+//
+// Encode returns the length, 0 when the room is too short. Decode returns
+// the bytes it took, 0 for a truncated record, which leaves the record half
+// written: decode into another record than the reference.
+
+#define CODEC_MAX_VARINT 5
+
+uint32_t Codec_ZigZag(int32_t value);
+int32_t Codec_UnZigZag(uint32_t value);
+unsigned char Codec_PutVarint(unsigned char *out, unsigned char room,
+                              uint32_t value);
+unsigned char Codec_GetVarint(const unsigned char *in, unsigned char size,
+                              uint32_t *value);
+
+#define CODEC_TYPE_UNSIGNED uint32_t
+#define CODEC_TYPE_SIGNED int32_t
+#define CODEC_TYPE_DELTA uint32_t
+#define CODEC_TYPE_FLAG unsigned char
+
+#define CODEC_IS_FLAG_UNSIGNED 0
+#define CODEC_IS_FLAG_SIGNED 0
+#define CODEC_IS_FLAG_DELTA 0
+#define CODEC_IS_FLAG_FLAG 1
+
+#define CODEC_MEMBER(kind, name) CODEC_TYPE_##kind name;
+#define CODEC_COUNT_FLAG(kind, name) +CODEC_IS_FLAG_##kind
+#define CODEC_FLAG_BYTES(SCHEMA) ((0 SCHEMA(CODEC_COUNT_FLAG) + 7) / 8)
+
+// Encoder, flags then values.
+#define CODEC_BIT(kind, name)                                                  \
+  if (CODEC_IS_FLAG_##kind) {                                                  \
+    if (record->name)                                                          \
+      out[bit >> 3] |= (unsigned char)(1 << (bit & 7));                        \
+    bit++;                                                                     \
+  }
+#define CODEC_PUT(kind, name) CODEC_PUT_##kind(name)
+#define CODEC_PUT_UNSIGNED(name) CODEC_PUT_VALUE(record->name)
+#define CODEC_PUT_SIGNED(name) CODEC_PUT_VALUE(Codec_ZigZag(record->name))
+#define CODEC_PUT_DELTA(name)                                                  \
+  CODEC_PUT_VALUE(Codec_ZigZag((int32_t)(record->name - reference->name)))
+#define CODEC_PUT_FLAG(name)
+#define CODEC_PUT_VALUE(value)                                                 \
+  {                                                                            \
+    const unsigned char put =                                                  \
+        Codec_PutVarint(out + length, room - length, (value));                 \
+    if (!put)                                                                  \
+      return 0;                                                                \
+    length += put;                                                             \
+  }
+
+// Decoder, the same way.
+#define CODEC_UNBIT(kind, name)                                                \
+  if (CODEC_IS_FLAG_##kind) {                                                  \
+    record->name = (in[bit >> 3] >> (bit & 7)) & 1;                            \
+    bit++;                                                                     \
+  }
+#define CODEC_GET(kind, name) CODEC_GET_##kind(name)
+#define CODEC_GET_UNSIGNED(name) CODEC_GET_VALUE(record->name = value)
+#define CODEC_GET_SIGNED(name)                                                 \
+  CODEC_GET_VALUE(record->name = Codec_UnZigZag(value))
+#define CODEC_GET_DELTA(name)                                                  \
+  CODEC_GET_VALUE(record->name =                                               \
+                      reference->name + (uint32_t)Codec_UnZigZag(value))
+#define CODEC_GET_FLAG(name)
+#define CODEC_GET_VALUE(store)                                                 \
+  {                                                                            \
+    const unsigned char got =                                                  \
+        Codec_GetVarint(in + length, size - length, &value);                   \
+    if (!got)                                                                  \
+      return 0;                                                                \
+    length += got;                                                             \
+    store;                                                                     \
+  }
+
+#define CODEC_DEFINE(Name, SCHEMA)                                             \
+  typedef struct Name##Record {                                                \
+    SCHEMA(CODEC_MEMBER)                                                       \
+  } Name##Record;                                                              \
+                                                                               \
+  static inline unsigned char Name##_Encode(                                   \
+      const Name##Record *record, const Name##Record *reference,               \
+      unsigned char *out, const unsigned char room) {                          \
+    unsigned char length = CODEC_FLAG_BYTES(SCHEMA);                           \
+    unsigned char bit = 0;                                                     \
+    if (room < length)                                                         \
+      return 0;                                                                \
+    memset(out, 0, length);                                                    \
+    SCHEMA(CODEC_BIT)                                                          \
+    SCHEMA(CODEC_PUT)                                                          \
+    (void)reference;                                                           \
+    (void)bit;                                                                 \
+    return length;                                                             \
+  }                                                                            \
+                                                                               \
+  static inline unsigned char Name##_Decode(                                   \
+      const unsigned char *in, const unsigned char size,                       \
+      const Name##Record *reference, Name##Record *record) {                   \
+    unsigned char length = CODEC_FLAG_BYTES(SCHEMA);                           \
+    unsigned char bit = 0;                                                     \
+    uint32_t value = 0;                                                        \
+    if (size < length)                                                         \
+      return 0;                                                                \
+    SCHEMA(CODEC_UNBIT)                                                        \
+    SCHEMA(CODEC_GET)                                                          \
+    (void)reference;                                                           \
+    (void)bit;                                                                 \
+    (void)value;                                                               \
+    return length;                                                             \
+  }
+
+#endif // COMMOTALKINO_SRC_CODEC_H_
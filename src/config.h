@@ -0,0 +1,289 @@
+#ifndef COMMOTALKINO_SRC_CONFIG_H_
+#define COMMOTALKINO_SRC_CONFIG_H_
+
+// The build flags of the node and the constants of its modes, shared by
+// main.cpp and the mode_*.cpp files. Every flag can be set from the build
+// flags, -D STAR=1 and the like.
+
+#define BROADCAST_ADDRESS_HIGH 0xFF
+#define BROADCAST_ADDRESS_LOW 0xFF
+
+#define PING_ADDRESS_HIGH 0x70
+#define PING_ADDRESS_LOW 0xA1
+#define PING_ID 0xAA
+#define PONG_ADDRESS_HIGH 0x90
+#define PONG_ADDRESS_LOW 0xB1
+#define PONG_ID 0xBB
+
+#ifndef PING_PONG_INTERVAL
+#define PING_PONG_INTERVAL 2000
+#endif
+#define HIT_START 0
+
+#define DEBUG 0
+#define LOG_LEVEL (DEBUG ? LOG_LEVEL_DEBUG : LOG_LEVEL_NONE)
+
+// 1: Listen() hands a frame to Pull_Invoke as soon as its last byte arrives,
+// 0: Listen() goes through Driver_Receive and its SERIAL_TIMEOUT.
+#define FRAMED_LISTEN 1
+
+// 1: the listening node announces it is ready and the other one transmits as
+// soon as it hears it, 0: fixed PING_PONG_INTERVAL / LET_HER_PREPARE_DELAY.
+// A token is a whole frame on air, and the module is deaf to the ball while it
+// sends one, so it goes once when the node starts listening and again only
+// after READY_TIMEOUT, doubling up to READY_BACKOFF_MAX. Off until a run on
+// the hardware shows it pays for its air time.
+#ifndef HANDSHAKE
+#define HANDSHAKE 0
+#endif
+#define READY_TIMEOUT 1000
+#define READY_BACKOFF_MAX 8000
+
+// 1: Ping streams counters through a sliding window of WINDOW_SIZE frames and
+// Pong acknowledges them, 0: one Ball per round trip.
+#ifndef WINDOWED
+#define WINDOWED 0
+#endif
+#define WINDOW_SIZE 4
+#define WINDOW_RTO 1500
+#define WINDOW_ACK_DELAY 400
+
+// 1: the pull timeout follows the measured round trip time to her, 0:
+// PULL_TIMEOUT or WINDOW_RTO always. The margin covers the jitter the
+// estimator cannot see coming, a hit log header on her console or a ready
+// token on air, so it is never below the air time of a frame plus a few
+// printed lines.
+#ifndef ADAPTIVE_TIMEOUT
+#define ADAPTIVE_TIMEOUT 1
+#endif
+#define RTT_MARGIN 500
+#define RTT_MAX_TIMEOUT PULL_TIMEOUT
+
+// 1: the driver callbacks record the duration of every radio stage into the
+// trace histograms, printed with the report or sending 't' to the console.
+// A diagnostic build: the ring and the histograms take about 400 bytes of the
+// 2 KB of RAM.
+#ifndef TRACE
+#define TRACE 0
+#endif
+
+// 1: window frames carry batches of records, a counter per hit and a status
+// record every STATUS_EVERY hits, 0: one counter per frame.
+#ifndef BATCHED
+#define BATCHED 1
+#endif
+#define BATCH_DEADLINE 200
+#define STATUS_EVERY 16
+
+// 1: a batched counter is a packed record, see codec.h: its delta to the one
+// before, a byte instead of four, and three counters fit in a window frame
+// instead of one. The window loses nothing and keeps the order, so both ends
+// take the record before as the reference.
+#ifndef PACKED
+#define PACKED 1
+#endif
+#define COUNTER_SCHEMA(FIELD) FIELD(DELTA, counter)
+
+// 1: Ping steps the air data rate up after RATE_UP_AFTER balls in a row and
+// Pong follows, both fall back to RATE_BASE after RATE_FALLBACK_AFTER timeouts
+// in a row. 0: RATE_BASE always. Ping pong only, a window frame has no byte
+// to spare for the rate command. Off until a run on the hardware, over a
+// real range, shows the faster rates hold up.
+#ifndef ADAPTIVE_RATE
+#define ADAPTIVE_RATE 0
+#endif
+#define RATE_BASE AIR_RATE_2400
+#define RATE_TOP AIR_RATE_19200
+#define RATE_UP_AFTER 50
+#define RATE_FALLBACK_AFTER 3
+
+// 1: on boot the module is programmed only when its configuration is neither
+// the copy in EEPROM nor what it reports back in sleep mode, 0: every boot.
+#ifndef CONFIG_CACHE
+#define CONFIG_CACHE 1
+#endif
+#define CONFIG_READ_TIMEOUT 100
+
+// 1: a node waiting for a frame keeps the module in power saving, where it
+// listens for a preamble once every wake up period, (WOR_TIMING + 1) * 250 ms,
+// and powers the MCU down until AUX announces a frame. Frames go out in wake
+// up mode, with a preamble as long as that period, and the report estimates
+// the mAh per day. 0: module and MCU always on.
+#ifndef LOW_POWER
+#define LOW_POWER 0
+#endif
+#ifndef WOR_TIMING
+#define WOR_TIMING 0
+#endif
+#define WOR_PERIOD_MS ((WOR_TIMING + 1) * 250UL)
+
+// 1: star of a coordinator, the node with PING_PIN HIGH, and leaves that read
+// their number on STAR_ID_BITS pins from PIN_ID_FIRST. The coordinator
+// broadcasts a beacon every superframe and every leaf sends one frame in its
+// own slot, see tdma.h. With STAR_SLOTTED 0 the leaves send the same frames at
+// random times of the superframe instead, pure ALOHA to compare with. A leaf
+// leaves and joins again every STAR_STAY_FRAMES frames, 0 for never.
+//
+// A leaf takes a reading every STAR_SAMPLE_MS, and every STAR_ALARM_EVERY-th
+// is an alarm as well, into a transmit queue, see txqueue.h. Its frame in
+// every slot carries the most urgent message queued. The alarms go as
+// control, never coalesced, and the readings as telemetry, where the newest
+// replaces the one queued unless STAR_COALESCE is 0.
+#ifndef STAR
+#define STAR 0
+#endif
+#ifndef STAR_SLOTTED
+#define STAR_SLOTTED 1
+#endif
+#ifndef STAR_STAY_FRAMES
+#define STAR_STAY_FRAMES 0
+#endif
+#define STAR_RATE AIR_RATE_19200
+#define STAR_SLOT_MS 70
+#define STAR_EXPIRE_AFTER 8
+#define STAR_SCAN_MS 5000
+#define STAR_BEACON_ID 0xBE
+#define STAR_LEAF_ID_BASE 0x10
+#define STAR_ID_BITS 5
+#define STAR_SAMPLE_MS 100
+#define STAR_ALARM_EVERY 25
+#ifndef STAR_COALESCE
+#define STAR_COALESCE 1
+#endif
+#define STAR_READING 1
+#define STAR_ALARM 2
+
+#define BOOT_RATE (STAR ? STAR_RATE : BULK ? BULK_RATE : RATE_BASE)
+
+// 1: every node forwards the frames that are not for it, see relay.h. Ping is
+// the sink and floods a beacon on boot, after a timeout and every
+// RELAY_BEACON_INTERVAL, then lets the flood die out for RELAY_FLOOD_MS. A node
+// with PIN_RELAY_ONLY closed to ground only forwards, any other one plays
+// Pong. Every node takes its number from the id straps, like a star leaf.
+#ifndef RELAY
+#define RELAY 0
+#endif
+#define RELAY_BEACON_INTERVAL 20000
+#define RELAY_FLOOD_MS 600
+#define RELAY_JITTER_MS 40
+#define RELAY_ID_BASE 0x20
+#define RELAY_LINK_ID 0xCC
+
+// 1 or more: pairs of Ping and Pong spread over CHANNELS channels from
+// CHANNEL_BASE. Both nodes of pair k strap 2k and 2k + 1 on the id straps,
+// the pair takes the addresses of its number and a home channel from them,
+// and Ping moves the pair along the hop sequence when CHANNEL_HOP_AFTER of the
+// last 16 balls time out, see channelhop.h. 0: every node on LORA_CHANNEL.
+// Pairs on the same channel that time out together would retry together
+// forever, so after a timeout a node waits up to CHANNEL_JITTER_MS more. Ping
+// pong only, like ADAPTIVE_RATE, and searching for a lost Pong takes longer
+// than falling back to RATE_BASE.
+#ifndef CHANNELS
+#define CHANNELS 0
+#endif
+#define CHANNEL_BASE 0x08
+#define CHANNEL_HOP_AFTER 3
+#define CHANNEL_LOST_AFTER 6
+#define CHANNEL_JITTER_MS 500
+
+// 1: instead of the ping pong Pong, the field node, sends its log to Ping in
+// bulk transfers of BULK_BYTES, one after the other, see bulk.h. Ping streams
+// the chunks in order to a check of the content, nothing holds the whole log.
+// Both nodes stay at BULK_RATE, and the goodput in the report compares with
+// the one of the ping pong at the same rate.
+#ifndef BULK
+#define BULK 0
+#endif
+#ifndef BULK_RATE
+#define BULK_RATE AIR_RATE_19200
+#endif
+#define BULK_BYTES 2048
+
+// 1: Ping streams counters to Pong in groups of FEC_DATA frames and
+// FEC_PARITY parity frames, see fec.h, and Pong never answers. A lost frame
+// is rebuilt from the parity of its group or counted lost, there is no round
+// trip and no retransmission. Pong closes a group after FEC_CLOSE_AFTER of
+// silence. To compare with WINDOWED, run the simulator with --loss.
+#ifndef FEC
+#define FEC 0
+#endif
+#ifndef FEC_DATA
+#define FEC_DATA 8
+#endif
+#ifndef FEC_PARITY
+#define FEC_PARITY 2
+#endif
+#define FEC_CLOSE_AFTER 400
+
+// 1: loop() runs the tasks of the cooperative scheduler, see scheduler.h,
+// instead of the blocking ping pong. The ping pong becomes a task that gives
+// the CPU away at every wait on the radio, and next to it PIN_SENSOR is
+// sampled every SAMPLE_INTERVAL, LISTEN_LED_PIN blinks for every ball and the
+// console drains. The report has the idle share of the CPU and how late every
+// task ran after it was due.
+#ifndef TASKS
+#define TASKS 0
+#endif
+#define SAMPLE_INTERVAL 100
+#define BLINK_MS 10
+#define TASK_EVENT_BALL 0x01
+
+#if HANDSHAKE && !FRAMED_LISTEN
+#error "HANDSHAKE needs FRAMED_LISTEN to tell the ready tokens apart"
+#endif
+
+#if LOW_POWER && (HANDSHAKE || WINDOWED || !CONFIG_CACHE)
+#error "LOW_POWER needs the ping pong without HANDSHAKE, and CONFIG_CACHE"
+#endif
+
+#if LOW_POWER && MODE_TIMEOUT < WOR_PERIOD_MS + FRAME_AIR_MS
+#error "MODE_TIMEOUT has to cover a wake up preamble and a frame on air"
+#endif
+
+#if STAR && (WINDOWED || LOW_POWER)
+#error "STAR runs its own schedule, without WINDOWED or LOW_POWER"
+#endif
+
+#if RELAY && (HANDSHAKE || WINDOWED || STAR || LOW_POWER || ADAPTIVE_RATE)
+#error "RELAY carries the ping pong only, without HANDSHAKE or ADAPTIVE_RATE"
+#endif
+
+#if CHANNELS && (WINDOWED || STAR || RELAY || LOW_POWER)
+#error "CHANNELS spreads the ping pong only, without WINDOWED or LOW_POWER"
+#endif
+
+#if BULK && (WINDOWED || STAR || RELAY || CHANNELS || LOW_POWER)
+#error "BULK runs its own transfers, without WINDOWED, STAR, RELAY or CHANNELS"
+#endif
+
+#if FEC && (WINDOWED || STAR || RELAY || CHANNELS || BULK || LOW_POWER)
+#error "FEC runs its own stream, without WINDOWED, STAR, RELAY, CHANNELS or BULK"
+#endif
+
+#if TASKS && (HANDSHAKE || WINDOWED || STAR || RELAY || CHANNELS || BULK || \
+              FEC || LOW_POWER)
+#error "TASKS runs the ping pong only, without HANDSHAKE or another transport"
+#endif
+
+#if 0x20 < CHANNEL_BASE + CHANNELS || CHANNEL_HOP_MAX < CHANNELS
+#error "The E32 has channels 0x00 to 0x1F only"
+#endif
+
+#if SERIAL_RX_PER_TICK * (1000000UL / SERIAL_RX_TICK_US) * 10 <                \
+    EBYTE_SERIAL_FREQ
+#error "The receive ring drains slower than the E32 UART fills it"
+#endif
+
+#if FRAME_POOL_SIZE < 2
+#error "The frame pool needs a frame to publish while Pull holds another"
+#endif
+
+#ifndef LET_HER_PREPARE_DELAY
+#if 1 == DEBUG
+#define LET_HER_PREPARE_DELAY 250
+#else
+#define LET_HER_PREPARE_DELAY 30
+#endif
+#endif
+
+#endif // COMMOTALKINO_SRC_CONFIG_H_
@@ -0,0 +1,86 @@
+#include "console.h"
+#include "ringbuffer.h"
+
+static unsigned char tx_storage[CONSOLE_TX_SIZE];
+static RingBuffer tx_ring;
+static unsigned int dropped;
+static const unsigned char line_end[2] = {'\r', '\n'};
+
+static int fits_or_drop(unsigned int size);
+static void push_all(const unsigned char *data, unsigned int size);
+
+void Console_Begin() {
+  RingBuffer_Init(&tx_ring, tx_storage, CONSOLE_TX_SIZE);
+  dropped = 0;
+}
+
+int fits_or_drop(const unsigned int size) {
+  const unsigned int room = CONSOLE_TX_SIZE - 1 - RingBuffer_Count(&tx_ring);
+  if (room < size) {
+    dropped++;
+    return 0;
+  }
+  return 1;
+}
+
+void push_all(const unsigned char *data, const unsigned int size) {
+  unsigned int i;
+  for (i = 0; i < size; i++)
+    RingBuffer_Push(&tx_ring, data[i]);
+}
+
+int Console_Write(const unsigned char *data, const unsigned int size) {
+  Console_Drain();
+  if (!fits_or_drop(size))
+    return 0;
+  push_all(data, size);
+  return 1;
+}
+
+int Console_Print(const char *line) {
+  const unsigned int size = strlen(line);
+  Console_Drain();
+  if (!fits_or_drop(size + sizeof(line_end)))
+    return 0;
+  push_all((const unsigned char *)line, size);
+  push_all(line_end, sizeof(line_end));
+  return 1;
+}
+
+// Like Console_Print, for a line kept in flash with F().
+int Console_PrintFlash(const __FlashStringHelper *line) {
+  const char *text = reinterpret_cast<const char *>(line);
+  const unsigned int size = strlen_P(text);
+  unsigned int i;
+  Console_Drain();
+  if (!fits_or_drop(size + sizeof(line_end)))
+    return 0;
+  for (i = 0; i < size; i++)
+    RingBuffer_Push(&tx_ring, pgm_read_byte(text + i));
+  push_all(line_end, sizeof(line_end));
+  return 1;
+}
+
+void Console_Drain() {
+  unsigned char value;
+  int room = Serial.availableForWrite();
+  while (0 < room-- && RingBuffer_Pop(&tx_ring, &value))
+    Serial.write(value);
+}
+
+// Blocking, for the output that has to follow the queued one in order.
+void Console_Flush() {
+  unsigned char value;
+  while (RingBuffer_Pop(&tx_ring, &value))
+    Serial.write(value);
+}
+
+// Bytes queued and not written to Serial yet.
+unsigned int Console_Pending() { return RingBuffer_Count(&tx_ring); }
+
+ConsoleStats Console_Stats() {
+  ConsoleStats stats;
+  stats.dropped = dropped;
+  stats.high_water = tx_ring.high_water;
+  return stats;
+}
@@ -0,0 +1,31 @@
+#ifndef COMMOTALKINO_SRC_CONSOLE_H_
+#define COMMOTALKINO_SRC_CONSOLE_H_
+
+#include <Arduino.h>
+
+// Non-blocking console output. Messages are queued whole into a transmit ring
+// and Console_Drain moves only as many bytes to Serial as its hardware buffer
+// takes without waiting. The sketch drains from its idle waits, so the radio
+// loop never stalls on the baud rate. A message that does not fit is dropped
+// and counted, never truncated. Fixed lines stay in flash, Console_PrintFlash
+// copies them into the ring without a RAM copy of their own.
+
+#ifndef CONSOLE_TX_SIZE
+#define CONSOLE_TX_SIZE 256
+#endif
+
+typedef struct ConsoleStats {
+  unsigned int dropped;
+  unsigned char high_water;
+} ConsoleStats;
+
+void Console_Begin();
+int Console_Write(const unsigned char *data, unsigned int size);
+int Console_Print(const char *line);
+int Console_PrintFlash(const __FlashStringHelper *line);
+void Console_Drain();
+void Console_Flush();
+unsigned int Console_Pending();
+ConsoleStats Console_Stats();
+
+#endif // COMMOTALKINO_SRC_CONSOLE_H_
@@ -0,0 +1,58 @@
+#include "energy.h"
+#include <string.h>
+
+static const unsigned long mcu_microamps[ENERGY_MCU_STATES] = {
+    ENERGY_UA_MCU_ACTIVE, ENERGY_UA_MCU_SLEEP};
+
+void Energy_Init(EnergyMeter *meter, const unsigned long wor_period_ms,
+                 const unsigned long now_ms) {
+  memset(meter, 0, sizeof(*meter));
+  meter->mcu = ENERGY_MCU_ACTIVE;
+  meter->radio = ENERGY_RADIO_RX;
+  meter->wor_period_ms = wor_period_ms;
+  meter->since_ms = now_ms;
+}
+
+void Energy_Mcu(EnergyMeter *meter, const unsigned char state,
+                const unsigned long now_ms) {
+  Energy_Charge(meter, now_ms);
+  meter->mcu = state;
+}
+
+void Energy_Radio(EnergyMeter *meter, const unsigned char state,
+                  const unsigned long now_ms) {
+  Energy_Charge(meter, now_ms);
+  meter->radio = state;
+}
+
+// Adds the time since the last change to the current states.
+void Energy_Charge(EnergyMeter *meter, const unsigned long now_ms) {
+  const unsigned long elapsed = now_ms - meter->since_ms;
+  meter->mcu_ms[meter->mcu] += elapsed;
+  meter->radio_ms[meter->radio] += elapsed;
+  meter->since_ms = now_ms;
+}
+
+double Energy_AverageMicroamps(const EnergyMeter *meter) {
+  const unsigned long radio_microamps[ENERGY_RADIO_STATES] = {
+      ENERGY_UA_RADIO_RX, ENERGY_UA_RADIO_TX,
+      Energy_WorMicroamps(meter->wor_period_ms), ENERGY_UA_RADIO_SLEEP};
+  double charge = 0;
+  unsigned long total = 0;
+  unsigned char state;
+  for (state = 0; state < ENERGY_MCU_STATES; state++) {
+    charge += (double)meter->mcu_ms[state] * mcu_microamps[state];
+    total += meter->mcu_ms[state];
+  }
+  for (state = 0; state < ENERGY_RADIO_STATES; state++)
+    charge += (double)meter->radio_ms[state] * radio_microamps[state];
+  return total ? charge / total : 0;
+}
+
+unsigned long Energy_WorMicroamps(const unsigned long wor_period_ms) {
+  if (wor_period_ms <= ENERGY_WOR_LISTEN_MS)
+    return ENERGY_UA_RADIO_RX;
+  return (ENERGY_UA_RADIO_RX * ENERGY_WOR_LISTEN_MS +
+          ENERGY_UA_RADIO_SLEEP * (wor_period_ms - ENERGY_WOR_LISTEN_MS)) /
+         wor_period_ms;
+}
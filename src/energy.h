@@ -0,0 +1,61 @@
+#ifndef COMMOTALKINO_SRC_ENERGY_H_
+#define COMMOTALKINO_SRC_ENERGY_H_
+
+// Energy model of a node: the time the MCU and the radio spend in every
+// state, times the current drawn in it, gives the average current and the
+// mAh per day. The currents are typical figures of the ATmega328P at 8 MHz
+// and 3.3 V with no power LED, and of the E32-433T20D datasheet; a board with
+// a regulator or a LED needs its own. tools/energy.py reads them from here.
+//
+// In power saving the module listens ENERGY_WOR_LISTEN_MS for a preamble once
+// per wake up period and sleeps the rest, its average current follows the
+// period.
+
+#ifndef ENERGY_UA_MCU_ACTIVE
+#define ENERGY_UA_MCU_ACTIVE 4000
+#endif
+#ifndef ENERGY_UA_MCU_SLEEP
+#define ENERGY_UA_MCU_SLEEP 5
+#endif
+#ifndef ENERGY_UA_RADIO_RX
+#define ENERGY_UA_RADIO_RX 16000
+#endif
+#ifndef ENERGY_UA_RADIO_TX
+#define ENERGY_UA_RADIO_TX 118000
+#endif
+#ifndef ENERGY_UA_RADIO_SLEEP
+#define ENERGY_UA_RADIO_SLEEP 2
+#endif
+#ifndef ENERGY_WOR_LISTEN_MS
+#define ENERGY_WOR_LISTEN_MS 4
+#endif
+
+enum EnergyMcu { ENERGY_MCU_ACTIVE, ENERGY_MCU_SLEEP, ENERGY_MCU_STATES };
+
+enum EnergyRadio {
+  ENERGY_RADIO_RX,
+  ENERGY_RADIO_TX,
+  ENERGY_RADIO_WOR,
+  ENERGY_RADIO_SLEEP,
+  ENERGY_RADIO_STATES
+};
+
+typedef struct EnergyMeter {
+  unsigned char mcu;
+  unsigned char radio;
+  unsigned long since_ms;
+  unsigned long wor_period_ms;
+  unsigned long mcu_ms[ENERGY_MCU_STATES];
+  unsigned long radio_ms[ENERGY_RADIO_STATES];
+} EnergyMeter;
+
+void Energy_Init(EnergyMeter *meter, unsigned long wor_period_ms,
+                 unsigned long now_ms);
+void Energy_Mcu(EnergyMeter *meter, unsigned char state, unsigned long now_ms);
+void Energy_Radio(EnergyMeter *meter, unsigned char state,
+                  unsigned long now_ms);
+void Energy_Charge(EnergyMeter *meter, unsigned long now_ms);
+double Energy_AverageMicroamps(const EnergyMeter *meter);
+unsigned long Energy_WorMicroamps(unsigned long wor_period_ms);
+
+#endif // COMMOTALKINO_SRC_ENERGY_H_
@@ -0,0 +1,142 @@
+#include "fec.h"
+#include <string.h>
+
+static unsigned char clamp(unsigned char value, unsigned char low,
+                           unsigned char high);
+static void add_parity(unsigned char *parity, const unsigned char *payload);
+static int rebuild(FecReceiver *receiver, unsigned char index);
+static void deliver_ready(FecReceiver *receiver, FecDeliver deliver);
+
+unsigned char clamp(const unsigned char value, const unsigned char low,
+                    const unsigned char high) {
+  if (value < low)
+    return low;
+  return high < value ? high : value;
+}
+
+void add_parity(unsigned char *parity, const unsigned char *payload) {
+  unsigned char i;
+  for (i = 0; i < FEC_PAYLOAD_LENGTH; i++)
+    parity[i] ^= payload[i];
+}
+
+// -----------------------------------------------------------------------------
+// Sender
+
+void FecSender_Init(FecSender *sender, const unsigned char k,
+                    const unsigned char m) {
+  memset(sender, 0, sizeof(*sender));
+  sender->k = clamp(k, 1, FEC_MAX_DATA);
+  sender->m = clamp(m, 1, FEC_MAX_PARITY);
+}
+
+// Fills the frame with the next parity frame while the group has one due.
+int FecSender_Parity(FecSender *sender, FecFrame *frame) {
+  if (sender->index < sender->k)
+    return 0;
+  const unsigned char j = sender->index - sender->k;
+  frame->group = sender->group;
+  frame->index = sender->index;
+  memcpy(frame->payload, sender->parity[j], FEC_PAYLOAD_LENGTH);
+  sender->parity_frames++;
+  if (++sender->index == sender->k + sender->m) {
+    sender->index = 0;
+    sender->group++;
+    memset(sender->parity, 0, sizeof(sender->parity));
+  }
+  return 1;
+}
+
+// Call only when FecSender_Parity has none due.
+void FecSender_Data(FecSender *sender, const unsigned char *payload,
+                    FecFrame *frame) {
+  frame->group = sender->group;
+  frame->index = sender->index;
+  memcpy(frame->payload, payload, FEC_PAYLOAD_LENGTH);
+  add_parity(sender->parity[sender->index % sender->m], payload);
+  sender->index++;
+  sender->data_frames++;
+}
+
+// -----------------------------------------------------------------------------
+// Receiver
+
+void FecReceiver_Init(FecReceiver *receiver, const unsigned char k,
+                      const unsigned char m) {
+  memset(receiver, 0, sizeof(*receiver));
+  receiver->k = clamp(k, 1, FEC_MAX_DATA);
+  receiver->m = clamp(m, 1, FEC_MAX_PARITY);
+}
+
+void FecReceiver_Push(FecReceiver *receiver, const FecFrame *frame,
+                      FecDeliver deliver) {
+  if (receiver->k + receiver->m <= frame->index)
+    return;
+  if (receiver->open && frame->group != receiver->group) {
+    // A frame of a group already closed arrives late, or the sender moved on.
+    if (0x80 <= (unsigned char)(frame->group - receiver->group))
+      return;
+    FecReceiver_Close(receiver, deliver);
+  }
+  if (!receiver->open) {
+    if (receiver->groups && 0x80 <= (unsigned char)(frame->group -
+                                                    receiver->group))
+      return;
+    receiver->open = 1;
+    receiver->group = frame->group;
+    receiver->delivered = 0;
+    receiver->received = 0;
+  }
+  if (receiver->received & (1U << frame->index))
+    return;
+  memcpy(receiver->payload[frame->index], frame->payload, FEC_PAYLOAD_LENGTH);
+  receiver->received |= 1U << frame->index;
+  deliver_ready(receiver, deliver);
+  if (receiver->delivered == receiver->k)
+    FecReceiver_Close(receiver, deliver);
+}
+
+// Rebuilds what the parity allows, delivers every data frame left in order
+// and counts the ones that could not be rebuilt as lost.
+void FecReceiver_Close(FecReceiver *receiver, FecDeliver deliver) {
+  unsigned char i;
+  if (!receiver->open)
+    return;
+  for (i = receiver->delivered; i < receiver->k; i++) {
+    if (!(receiver->received & (1U << i)) && !rebuild(receiver, i)) {
+      receiver->lost++;
+      continue;
+    }
+    deliver(receiver->payload[i]);
+  }
+  receiver->delivered = receiver->k;
+  receiver->open = 0;
+  receiver->groups++;
+  receiver->group++;
+}
+
+void deliver_ready(FecReceiver *receiver, FecDeliver deliver) {
+  while (receiver->delivered < receiver->k &&
+         (receiver->received & (1U << receiver->delivered)))
+    deliver(receiver->payload[receiver->delivered++]);
+}
+
+// Needs the parity frame of the class and every other data frame in it.
+int rebuild(FecReceiver *receiver, const unsigned char index) {
+  const unsigned char j = index % receiver->m;
+  unsigned char *payload = receiver->payload[index];
+  unsigned char i;
+  if (!(receiver->received & (1U << (receiver->k + j))))
+    return 0;
+  memcpy(payload, receiver->payload[receiver->k + j], FEC_PAYLOAD_LENGTH);
+  for (i = j; i < receiver->k; i += receiver->m) {
+    if (i == index)
+      continue;
+    if (!(receiver->received & (1U << i)))
+      return 0;
+    add_parity(payload, receiver->payload[i]);
+  }
+  receiver->received |= 1U << index;
+  receiver->rebuilt++;
+  return 1;
+}
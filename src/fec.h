@@ -0,0 +1,64 @@
+#ifndef COMMOTALKINO_SRC_FEC_H_
+#define COMMOTALKINO_SRC_FEC_H_
+
+#include "../lib/CommoTalkie/messageconfig.h"
+
+// Forward erasure coding over a one way stream of frames. Every group has k
+// data frames followed by m parity frames, and parity frame j is the XOR of
+// the payloads of the data frames i with i % m == j. The receiver rebuilds a
+// lost data frame from its parity frame and the other data frames of its
+// class, without asking for anything: up to m losses per group, as long as
+// no two fall in the same class. A Reed-Solomon code would only replace
+// add_parity() and rebuild(), the frames stay the same.
+//
+// Data frames are delivered as soon as every earlier one of the group was,
+// and the rest when the group closes: on a frame of a later group, once every
+// data frame is in, or on FecReceiver_Close after a silence.
+
+#define FEC_MAX_DATA 12
+#define FEC_MAX_PARITY 4
+#define FEC_HEADER_LENGTH 2
+#define FEC_PAYLOAD_LENGTH (MESSAGE_BODY_LENGTH - FEC_HEADER_LENGTH)
+
+typedef struct FecFrame {
+  unsigned char group;
+  unsigned char index;
+  unsigned char payload[FEC_PAYLOAD_LENGTH];
+} FecFrame;
+
+typedef struct FecSender {
+  unsigned char k;
+  unsigned char m;
+  unsigned char group;
+  unsigned char index;
+  unsigned char parity[FEC_MAX_PARITY][FEC_PAYLOAD_LENGTH];
+  unsigned long data_frames;
+  unsigned long parity_frames;
+} FecSender;
+
+typedef struct FecReceiver {
+  unsigned char k;
+  unsigned char m;
+  unsigned char open;
+  unsigned char group;
+  unsigned char delivered;
+  unsigned int received;
+  unsigned char payload[FEC_MAX_DATA + FEC_MAX_PARITY][FEC_PAYLOAD_LENGTH];
+  unsigned long rebuilt;
+  unsigned long lost;
+  unsigned long groups;
+} FecReceiver;
+
+typedef void (*FecDeliver)(const unsigned char *payload);
+
+void FecSender_Init(FecSender *sender, unsigned char k, unsigned char m);
+int FecSender_Parity(FecSender *sender, FecFrame *frame);
+void FecSender_Data(FecSender *sender, const unsigned char *payload,
+                    FecFrame *frame);
+
+void FecReceiver_Init(FecReceiver *receiver, unsigned char k, unsigned char m);
+void FecReceiver_Push(FecReceiver *receiver, const FecFrame *frame,
+                      FecDeliver deliver);
+void FecReceiver_Close(FecReceiver *receiver, FecDeliver deliver);
+
+#endif // COMMOTALKINO_SRC_FEC_H_
@@ -0,0 +1,60 @@
+#include "framepool.h"
+#include <string.h>
+
+static int index_of(const FramePool *pool, const Frame *frame);
+
+void FramePool_Init(FramePool *pool) { memset(pool, 0, sizeof(*pool)); }
+
+// A zeroed frame, owned by owner.
+Frame *FramePool_Take(FramePool *pool, const unsigned char owner) {
+  unsigned char i;
+  if (FRAME_FREE == owner)
+    return 0;
+  for (i = 0; i < FRAME_POOL_SIZE; i++) {
+    if (FRAME_FREE != pool->owners[i])
+      continue;
+    pool->owners[i] = owner;
+    memset(&pool->frames[i], 0, sizeof(pool->frames[i]));
+    pool->in_use++;
+    if (pool->high_water < pool->in_use)
+      pool->high_water = pool->in_use;
+    pool->takes++;
+    return &pool->frames[i];
+  }
+  pool->exhausted++;
+  return 0;
+}
+
+// Returns 0, and leaves the frame where it is, unless from owns it.
+int FramePool_Hand(FramePool *pool, Frame *frame, const unsigned char from,
+                   const unsigned char to) {
+  const int index = index_of(pool, frame);
+  if (0 > index || FRAME_FREE == from || pool->owners[index] != from) {
+    pool->misuse++;
+    return 0;
+  }
+  pool->owners[index] = to;
+  if (FRAME_FREE == to)
+    pool->in_use--;
+  return 1;
+}
+
+int FramePool_Release(FramePool *pool, Frame *frame, const unsigned char from) {
+  return FramePool_Hand(pool, frame, from, FRAME_FREE);
+}
+
+unsigned char FramePool_Owner(const FramePool *pool, const Frame *frame) {
+  const int index = index_of(pool, frame);
+  if (0 > index)
+    return FRAME_FREE;
+  return pool->owners[index];
+}
+
+int index_of(const FramePool *pool, const Frame *frame) {
+  unsigned char i;
+  for (i = 0; i < FRAME_POOL_SIZE; i++) {
+    if (&pool->frames[i] == frame)
+      return i;
+  }
+  return -1;
+}
@@ -0,0 +1,49 @@
+#ifndef COMMOTALKINO_SRC_FRAMEPOOL_H_
+#define COMMOTALKINO_SRC_FRAMEPOOL_H_
+
+#include "../lib/CommoTalkie/messageconfig.h"
+#include <stdint.h>
+
+// Fixed pool of frame bodies, sized at compile time, so the RAM frames take is
+// known before the first run and no stage keeps a copy of its own. A frame
+// has one owner at a time: Pull takes it and fills it, hands it to the
+// application, which reads and rewrites it in place and hands it to Publish,
+// which sends it and gives it back. A hand over from a stage that does not
+// own the frame is refused and counted, the sign of a frame used after it
+// was passed on.
+//
+// Take returns 0 when every frame is out: the caller waits for one to come
+// back, it never falls back to a stack buffer.
+
+#ifndef FRAME_POOL_SIZE
+#define FRAME_POOL_SIZE 2
+#endif
+// The body of a message rounded up to whole words, as a Ball, so that Pull
+// can write the whole body and the application a whole Ball.
+#define FRAME_POOL_BODY ((MESSAGE_BODY_LENGTH + 3) / 4 * 4)
+
+enum FrameOwner { FRAME_FREE, FRAME_PULL, FRAME_APP, FRAME_PUBLISH };
+
+typedef union Frame {
+  unsigned char body[FRAME_POOL_BODY];
+  uint32_t align;
+} Frame;
+
+typedef struct FramePool {
+  Frame frames[FRAME_POOL_SIZE];
+  unsigned char owners[FRAME_POOL_SIZE];
+  unsigned char in_use;
+  unsigned char high_water;
+  unsigned long takes;
+  unsigned long exhausted;
+  unsigned long misuse;
+} FramePool;
+
+void FramePool_Init(FramePool *pool);
+Frame *FramePool_Take(FramePool *pool, unsigned char owner);
+int FramePool_Hand(FramePool *pool, Frame *frame, unsigned char from,
+                   unsigned char to);
+int FramePool_Release(FramePool *pool, Frame *frame, unsigned char from);
+unsigned char FramePool_Owner(const FramePool *pool, const Frame *frame);
+
+#endif // COMMOTALKINO_SRC_FRAMEPOOL_H_
@@ -0,0 +1,32 @@
+#include "framereader.h"
+#include <string.h>
+
+void FrameReader_Init(FrameReader *reader) {
+  memset(reader, 0, sizeof(*reader));
+}
+
+int FrameReader_Push(FrameReader *reader, const unsigned char value,
+                     unsigned long size, const unsigned long now_us) {
+  if (sizeof(reader->buffer) < size)
+    size = sizeof(reader->buffer);
+  FrameReader_Expire(reader, now_us);
+  reader->buffer[reader->length++] = value;
+  reader->last_byte_us = now_us;
+  if (reader->length < size)
+    return 0;
+  reader->length = 0;
+  reader->frames++;
+  return 1;
+}
+
+void FrameReader_Expire(FrameReader *reader, const unsigned long now_us) {
+  if (reader->length && FRAME_GAP_US < now_us - reader->last_byte_us) {
+    reader->dropped += reader->length;
+    reader->length = 0;
+  }
+}
+
+void FrameReader_Reset(FrameReader *reader) {
+  reader->dropped += reader->length;
+  reader->length = 0;
+}
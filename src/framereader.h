@@ -0,0 +1,29 @@
+#ifndef COMMOTALKINO_SRC_FRAMEREADER_H_
+#define COMMOTALKINO_SRC_FRAMEREADER_H_
+
+#include "loramessage.h"
+
+// Assembles received bytes into frames of a known length. A frame is complete
+// the moment its last byte is pushed. The E32 outputs every packet as one
+// burst, so a partial frame left without new bytes for FRAME_GAP_US is
+// garbage and gets discarded, which realigns the reader on the next packet.
+
+#ifndef FRAME_GAP_US
+#define FRAME_GAP_US 5000
+#endif
+
+typedef struct FrameReader {
+  unsigned char buffer[LORA_FRAME_LENGTH];
+  unsigned char length;
+  unsigned long last_byte_us;
+  unsigned long frames;
+  unsigned long dropped;
+} FrameReader;
+
+void FrameReader_Init(FrameReader *reader);
+int FrameReader_Push(FrameReader *reader, unsigned char value,
+                     unsigned long size, unsigned long now_us);
+void FrameReader_Expire(FrameReader *reader, unsigned long now_us);
+void FrameReader_Reset(FrameReader *reader);
+
+#endif // COMMOTALKINO_SRC_FRAMEREADER_H_
@@ -0,0 +1,25 @@
+#include "handshake.h"
+#include <string.h>
+
+void Handshake_BuildReady(unsigned char *frame, const unsigned long size,
+                          const unsigned char id) {
+  memset(frame, 0, size);
+  frame[0] = READY_MAGIC_HIGH;
+  frame[1] = READY_MAGIC_LOW;
+  frame[2] = id;
+  frame[3] = (unsigned char)~id;
+}
+
+int Handshake_IsReady(const unsigned char *frame, const unsigned long size,
+                      unsigned char *id) {
+  unsigned long i;
+  if (size < READY_TOKEN_LENGTH || READY_MAGIC_HIGH != frame[0] ||
+      READY_MAGIC_LOW != frame[1] || frame[2] != (unsigned char)~frame[3])
+    return 0;
+  for (i = READY_TOKEN_LENGTH; i < size; i++) {
+    if (frame[i])
+      return 0;
+  }
+  *id = frame[2];
+  return 1;
+}
@@ -0,0 +1,18 @@
+#ifndef COMMOTALKINO_SRC_HANDSHAKE_H_
+#define COMMOTALKINO_SRC_HANDSHAKE_H_
+
+// Readiness token a node announces while it listens, so the peer transmits as
+// soon as it knows the receiver is in NORMAL mode instead of sleeping a fixed
+// delay. The token is a raw frame of message length that never reaches the
+// CommoTalkie subscriber: two magic bytes, the sender id and its complement.
+
+#define READY_MAGIC_HIGH 0xA5
+#define READY_MAGIC_LOW 0x5A
+#define READY_TOKEN_LENGTH 4
+
+void Handshake_BuildReady(unsigned char *frame, unsigned long size,
+                          unsigned char id);
+int Handshake_IsReady(const unsigned char *frame, unsigned long size,
+                      unsigned char *id);
+
+#endif // COMMOTALKINO_SRC_HANDSHAKE_H_
@@ -0,0 +1,117 @@
+#include "linkrate.h"
+#include <string.h>
+
+static const unsigned long link_rate_bps[LINK_RATE_LEVELS] = {
+    300, 1200, 2400, 4800, 9600, 19200};
+
+static void lower_ceiling(LinkRate *link, unsigned char failed);
+
+void lower_ceiling(LinkRate *link, const unsigned char failed) {
+  if (link->base < failed && failed <= link->ceiling)
+    link->ceiling = failed - 1;
+}
+
+void LinkRate_Init(LinkRate *link, const short proposer,
+                   const unsigned char base, const unsigned char top,
+                   const unsigned int up_after,
+                   const unsigned char fallback_after,
+                   const unsigned long now_ms) {
+  memset(link, 0, sizeof(*link));
+  link->proposer = proposer;
+  link->rate = base;
+  link->base = base;
+  link->top = top;
+  link->ceiling = top;
+  link->proposed = LINK_RATE_KEEP;
+  link->confirm = LINK_RATE_KEEP;
+  link->suspect = LINK_RATE_KEEP;
+  link->due = LINK_RATE_KEEP;
+  link->up_after = up_after;
+  link->fallback_after = fallback_after;
+  link->since_ms = now_ms;
+}
+
+// Command for the frame about to be sent. Sending a confirm makes the switch
+// due, proposing marks the rate as the one to blame if the link breaks.
+unsigned char LinkRate_Command(LinkRate *link) {
+  if (LINK_RATE_KEEP != link->confirm) {
+    link->due = link->confirm;
+    link->confirm = LINK_RATE_KEEP;
+    return LINK_RATE_CONFIRM | link->due;
+  }
+  if (!link->proposer || LINK_RATE_KEEP != link->proposed ||
+      link->streak < link->up_after || link->ceiling <= link->rate)
+    return 0;
+  link->proposed = link->rate + 1;
+  link->suspect = link->proposed;
+  return LINK_RATE_PROPOSE | link->proposed;
+}
+
+// Command of a frame just received, the answer to a proposal or a proposal.
+void LinkRate_Handle(LinkRate *link, const unsigned char command) {
+  const unsigned char rate = command & LINK_RATE_MASK;
+  if (link->proposer) {
+    if (LINK_RATE_KEEP == link->proposed)
+      return;
+    if ((LINK_RATE_CONFIRM | link->proposed) == command) {
+      link->due = link->proposed;
+    } else {
+      lower_ceiling(link, link->proposed);
+      link->suspect = LINK_RATE_KEEP;
+    }
+    link->proposed = LINK_RATE_KEEP;
+    return;
+  }
+  if ((command & LINK_RATE_PROPOSE) && rate <= link->top)
+    link->confirm = rate;
+}
+
+void LinkRate_Success(LinkRate *link, const unsigned long bytes) {
+  link->stats[link->rate].hits++;
+  link->stats[link->rate].bytes += bytes;
+  link->streak++;
+  link->misses = 0;
+  if (link->suspect == link->rate)
+    link->suspect = LINK_RATE_KEEP;
+}
+
+void LinkRate_Timeout(LinkRate *link) {
+  link->stats[link->rate].timeouts++;
+  link->streak = 0;
+  link->proposed = LINK_RATE_KEEP;
+  link->confirm = LINK_RATE_KEEP;
+  if (++link->misses < link->fallback_after)
+    return;
+  link->misses = 0;
+  link->fallbacks++;
+  lower_ceiling(link, LINK_RATE_KEEP != link->suspect ? link->suspect
+                                                       : link->rate);
+  link->suspect = LINK_RATE_KEEP;
+  link->due = link->base;
+}
+
+// Rate the radio has to be set to now, or LINK_RATE_KEEP.
+unsigned char LinkRate_Take(LinkRate *link, const unsigned long now_ms) {
+  const unsigned char due = link->due;
+  link->due = LINK_RATE_KEEP;
+  if (LINK_RATE_KEEP == due || due == link->rate)
+    return LINK_RATE_KEEP;
+  link->stats[link->rate].ms += now_ms - link->since_ms;
+  link->since_ms = now_ms;
+  link->rate = due;
+  link->streak = 0;
+  link->misses = 0;
+  link->switches++;
+  return due;
+}
+
+unsigned long LinkRate_Elapsed(const LinkRate *link, const unsigned char rate,
+                               const unsigned long now_ms) {
+  const unsigned long current =
+      rate == link->rate ? now_ms - link->since_ms : 0;
+  return link->stats[rate].ms + current;
+}
+
+unsigned long LinkRate_Bps(const unsigned char rate) {
+  return link_rate_bps[rate];
+}
@@ -0,0 +1,66 @@
+#ifndef COMMOTALKINO_SRC_LINKRATE_H_
+#define COMMOTALKINO_SRC_LINKRATE_H_
+
+// Air data rate agreed between two peers. A rate is the E32 SPED value, from
+// AIR_RATE_300 (0) up to AIR_RATE_19200 (5).
+//
+// The proposer asks for the next rate after up_after answers in a row without
+// a timeout, and the responder confirms it in its next frame. Both switch in
+// the gap between two frames of the exchange, the responder right after
+// sending the confirm and the proposer right after receiving it, so each one
+// hears the next frame of the other at the new rate. A responder above its top
+// does not confirm, and the proposer stops asking.
+//
+// Peers at different rates do not hear each other, so there is no switching
+// back together. Each side falls back to base on its own after fallback_after
+// timeouts in a row, and the proposer never asks again for the rate it failed
+// at. The command takes one byte of the message body:
+//
+//   0 | LINK_RATE_PROPOSE + rate | LINK_RATE_CONFIRM + rate
+
+#define LINK_RATE_LEVELS 6
+#define LINK_RATE_PROPOSE 0x80
+#define LINK_RATE_CONFIRM 0x40
+#define LINK_RATE_MASK 0x0F
+#define LINK_RATE_KEEP 0xFF
+
+typedef struct LinkRateStats {
+  unsigned long hits;
+  unsigned long timeouts;
+  unsigned long bytes;
+  unsigned long ms;
+} LinkRateStats;
+
+typedef struct LinkRate {
+  short proposer;
+  unsigned char rate;
+  unsigned char base;
+  unsigned char top;
+  unsigned char ceiling;
+  unsigned char proposed;
+  unsigned char confirm;
+  unsigned char suspect;
+  unsigned char due;
+  unsigned int up_after;
+  unsigned char fallback_after;
+  unsigned int streak;
+  unsigned char misses;
+  unsigned long since_ms;
+  unsigned long switches;
+  unsigned long fallbacks;
+  LinkRateStats stats[LINK_RATE_LEVELS];
+} LinkRate;
+
+void LinkRate_Init(LinkRate *link, short proposer, unsigned char base,
+                   unsigned char top, unsigned int up_after,
+                   unsigned char fallback_after, unsigned long now_ms);
+unsigned char LinkRate_Command(LinkRate *link);
+void LinkRate_Handle(LinkRate *link, unsigned char command);
+void LinkRate_Success(LinkRate *link, unsigned long bytes);
+void LinkRate_Timeout(LinkRate *link);
+unsigned char LinkRate_Take(LinkRate *link, unsigned long now_ms);
+unsigned long LinkRate_Elapsed(const LinkRate *link, unsigned char rate,
+                               unsigned long now_ms);
+unsigned long LinkRate_Bps(unsigned char rate);
+
+#endif // COMMOTALKINO_SRC_LINKRATE_H_
@@ -0,0 +1,15 @@
+#include "log.h"
+#include "console.h"
+#include <string.h>
+
+// The record is queued on the console in one piece, or dropped whole when the
+// console is full, so the decoder never sees half a record.
+void Log_Write(const unsigned char id, const unsigned char *value,
+               const unsigned char size) {
+  unsigned char record[3 + LOG_MAX_VALUE];
+  record[0] = LOG_SYNC;
+  record[1] = id;
+  record[2] = size;
+  memcpy(record + 3, value, size);
+  Console_Write(record, 3 + size);
+}
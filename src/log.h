@@ -0,0 +1,77 @@
+#ifndef COMMOTALKINO_SRC_LOG_H_
+#define COMMOTALKINO_SRC_LOG_H_
+
+// Log levels resolved at compile time. A call above LOG_LEVEL goes to the
+// empty LogSink<false>, so neither the call nor its message is left in the
+// firmware. An enabled call writes a binary record to the console instead of
+// formatted text:
+//
+//   LOG_SYNC | message id | value length | value bytes
+//
+// LOG_SYNC never shows up in the ASCII text printed around the records.
+// tools/logdecode.py turns a console capture back into text. It takes the
+// message names from LOG_MESSAGES below, so this list is the only table and
+// new messages go at its end to keep older captures readable.
+//
+// The sketch defines LOG_LEVEL before the first log call.
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_DEBUG 3
+
+#define LOG_SYNC 0xA7
+#define LOG_MAX_VALUE 32
+
+#define LOG_MESSAGES(X)                                                        \
+  X(LOG_WRITE_TO_SERIAL, "WriteToSerial")                                      \
+  X(LOG_TRANSMIT_CONTENT, "Transmit content")                                  \
+  X(LOG_LISTEN_CONTENT, "Listen content")                                      \
+  X(LOG_ANNOUNCING_READY, "Announcing ready")                                  \
+  X(LOG_PULL_ADDRESS, "Pull address")                                          \
+  X(LOG_PULLED_PORT, "Pulled message port")                                    \
+  X(LOG_PULLED_ID, "Pulled message id")                                        \
+  X(LOG_MY_ID, "My id")                                                        \
+  X(LOG_PULLED_BODY, "Pulled body")                                            \
+  X(LOG_RESULT_SUCCESS, "Result: Success")                                     \
+  X(LOG_RESULT_TIMEOUT, "Result: Time out")                                    \
+  X(LOG_RESULT_IO_ERROR, "Result: IO Error")                                   \
+  X(LOG_RESULT_UNEXPECTED, "Result: Unexpected")                               \
+  X(LOG_FIXED_MODE, "Fixed address transmission mode")                         \
+  X(LOG_PUBLISH_PORT, "Publish to port")                                       \
+  X(LOG_PUBLISH_ID, "Publish to id")                                           \
+  X(LOG_PUBLISH_ADDRESS, "Publish to address")                                 \
+  X(LOG_PUBLISH_BODY, "Publish body")                                          \
+  X(LOG_BROADCAST_MODE, "Broadcast transmission mode")                         \
+  X(LOG_RELAY_FORWARD, "Relay forward")
+
+#define LOG_ENUM_ENTRY(name, text) name,
+enum LogMessage { LOG_MESSAGES(LOG_ENUM_ENTRY) LOG_MESSAGE_COUNT };
+#undef LOG_ENUM_ENTRY
+
+void Log_Write(unsigned char id, const unsigned char *value,
+               unsigned char size);
+
+template <bool Enabled> struct LogSink {
+  static inline void bytes(const unsigned char id, const void *value,
+                           const unsigned long size) {
+    Log_Write(id, (const unsigned char *)value,
+              LOG_MAX_VALUE < size ? LOG_MAX_VALUE : (unsigned char)size);
+  }
+  static inline void info(const unsigned char id) { Log_Write(id, 0, 0); }
+};
+
+template <> struct LogSink<false> {
+  static inline void bytes(unsigned char, const void *, unsigned long) {}
+  static inline void info(unsigned char) {}
+};
+
+#define LOG_ENABLED(level) ((level) <= LOG_LEVEL)
+
+#define LOG_ERROR(id) LogSink<LOG_ENABLED(LOG_LEVEL_ERROR)>::info(id)
+#define LOG_INFO(id) LogSink<LOG_ENABLED(LOG_LEVEL_INFO)>::info(id)
+#define LOG_DEBUG(id) LogSink<LOG_ENABLED(LOG_LEVEL_DEBUG)>::info(id)
+#define LOG_DEBUG_BYTES(id, value, size)                                       \
+  LogSink<LOG_ENABLED(LOG_LEVEL_DEBUG)>::bytes(id, value, size)
+
+#endif // COMMOTALKINO_SRC_LOG_H_
@@ -3,6 +3,12 @@
 
 #include "../lib/CommoTalkie/messageconfig.h"
 
+#define LORA_HEADER_LENGTH 3
+
+// A transparent mode receiver gets the whole frame, in fixed mode the module
+// strips the 3 address bytes and only MESSAGE_LENGTH bytes are output.
+#define LORA_FRAME_LENGTH (LORA_HEADER_LENGTH + MESSAGE_LENGTH)
+
 struct LoraMessage {
   char address_high;
   char address_low;
@@ -1,88 +1,125 @@
 #include "main.h"
-
-#define BROADCAST_ADDRESS_HIGH 0xFF
-#define BROADCAST_ADDRESS_LOW 0xFF
-
-#define PING_ADDRESS_HIGH 0x70
-#define PING_ADDRESS_LOW 0xA1
-#define PING_ID 0xAA
-#define PONG_ADDRESS_HIGH 0x90
-#define PONG_ADDRESS_LOW 0xB1
-#define PONG_ID 0xBB
-
-#define PING_PONG_INTERVAL 2000
-#define HIT_START 0
-
-#define DEBUG 0
-
-#if 1 == DEBUG
-#define LET_HER_PREPARE_DELAY 250
-#else
-#define LET_HER_PREPARE_DELAY 30
-#endif
-
+#include "mode_bulk.h"
+#include "mode_channels.h"
+#include "mode_fec.h"
+#include "mode_handshake.h"
+#include "mode_lowpower.h"
+#include "mode_rate.h"
+#include "mode_relay.h"
+#include "mode_star.h"
+#include "mode_tasks.h"
+#include "mode_window.h"
 
 // -----------------------------------------------------------------------------
 // Additional Headers
 
 static void set_config(int ping_pin);
 
-static void print_chars(const char *, unsigned long);
-
-static void print_bytes(const unsigned char *body, unsigned long size);
-
+#if LOG_ENABLED(LOG_LEVEL_DEBUG)
 static void blink(int pin);
+#endif
 
 static void debug_state(Driver *driver);
 
-static void debug_result(const char *title, Result result);
-static void debug_info(const char *title);
-static void debug_bytes(const char *title, const unsigned char *value,
-                        unsigned long size);
+static void receiver_off();
+static void measure_frame_latency();
+static void apply_mode();
+static void account_radio();
+static void trace_aux(int value);
+static void print_trace();
+static void track_round_trip(Result result);
+static void init_driver_cached();
+static int read_module_config(unsigned char *block);
+static int exchange_config(unsigned char *command, unsigned long size,
+                           unsigned char *reply);
+static void drop_ball_frame();
+static void print_memory();
+static void read_command();
+
+static void debug_result(Result result);
 
 // -----------------------------------------------------------------------------
 // Global Instances
 
 SoftwareSerial SSerial(PIN_RX, PIN_TX);
 Driver lora_driver;
+FrameReader frame_reader;
+RttEstimator her_rtt;
+FramePool frame_pool;
 
 LoraConfig my_config;
 LoraConfig her_config;
+unsigned char listen_id;
+
+unsigned long receiving_timeout = PULL_TIMEOUT;
 
-const unsigned long receiving_timeout = PULL_TIMEOUT;
+short radio_dry_run;
+short radio_transmitting;
+unsigned char dry_block[RADIO_CONFIG_LENGTH];
+unsigned char dry_length;
+const __FlashStringHelper *config_source;
+unsigned long radio_ready_ms;
+unsigned long first_frame_ms;
 
 unsigned long loop_count;
+unsigned long pull_count;
+unsigned long received_count;
+unsigned long timeout_count;
+unsigned long payload_bytes;
+unsigned long order_errors;
+unsigned long published_at;
+short rtt_pending;
+unsigned long trace_mode_start;
+unsigned long trace_aux_since;
+unsigned long trace_read_start;
+unsigned char trace_aux_stage = TRACE_STAGES;
+unsigned long frame_latency_sum_us;
+unsigned long frame_latency_max_us;
 unsigned long hit;
 unsigned long last_hit;
+Frame *ball_frame;
 unsigned long record;
 
 // -----------------------------------------------------------------------------
 // Device Identity
 
+// Straight into the globals, mine and hers, without a copy of either.
 void set_config(int ping_pin) {
-  LoraConfig ping_config;
-  ping_config.id = PING_ID;
-  ping_config.port = COMMON_PORT;
-  ping_config.address_high = PING_ADDRESS_HIGH;
-  ping_config.address_low = PING_ADDRESS_LOW;
-  ping_config.channel = LORA_CHANNEL;
-  ping_config.do_i_ping = 1;
-
-  LoraConfig pong_config;
-  pong_config.id = PONG_ID;
-  pong_config.port = COMMON_PORT;
-  pong_config.address_high = PONG_ADDRESS_HIGH;
-  pong_config.address_low = PONG_ADDRESS_LOW;
-  pong_config.channel = LORA_CHANNEL;
-  pong_config.do_i_ping = 0;
-
-  if (HIGH == digitalRead(ping_pin)) {
-    my_config = ping_config;
-    her_config = pong_config;
-  } else {
-    my_config = pong_config;
-    her_config = ping_config;
+  const short do_i_ping = HIGH == digitalRead(ping_pin);
+  LoraConfig *ping_config = do_i_ping ? &my_config : &her_config;
+  LoraConfig *pong_config = do_i_ping ? &her_config : &my_config;
+  ping_config->id = PING_ID;
+  ping_config->port = COMMON_PORT;
+  ping_config->address_high = PING_ADDRESS_HIGH;
+  ping_config->address_low = PING_ADDRESS_LOW;
+  ping_config->channel = LORA_CHANNEL;
+  ping_config->do_i_ping = 1;
+
+  pong_config->id = PONG_ID;
+  pong_config->port = COMMON_PORT;
+  pong_config->address_high = PONG_ADDRESS_HIGH;
+  pong_config->address_low = PONG_ADDRESS_LOW;
+  pong_config->channel = LORA_CHANNEL;
+  pong_config->do_i_ping = 0;
+  listen_id = my_config.id;
+  if (STAR)
+    set_star_config();
+  if (RELAY)
+    set_relay_config();
+  if (CHANNELS)
+    set_pair_config();
+}
+
+// Closed to ground for 1, from PIN_ID_FIRST up.
+unsigned char read_id_straps() {
+  unsigned char number = 0;
+  unsigned char bit;
+  for (bit = 0; bit < STAR_ID_BITS; bit++) {
+    pinMode(PIN_ID_FIRST + bit, INPUT_PULLUP);
+    if (LOW == digitalRead(PIN_ID_FIRST + bit))
+      number |= 1 << bit;
   }
+  return number;
 }
 
 // -----------------------------------------------------------------------------
@@ -94,7 +131,7 @@ int InitPublisher() {
   PublisherBuilder_SetSendCallback(Transmit);
   const int result = PublisherBuilder_Build();
   if (!result) {
-    Serial.println("Error: Publisher builder");
+    Serial.println(F("Error: Publisher builder"));
     delay(RETRY_INTERVAL);
   }
   PublisherBuilder_Destroy();
@@ -107,11 +144,11 @@ int InitSubscriber() {
   SubscriberBuilder_SetListenCallback(Listen);
   SubscriberBuilder_SetTimeService(Millis);
   SubscriberBuilder_SetTimeout(&receiving_timeout);
-  SubscriberBuilder_SetReceiverStateCallback(TurnOn, TurnOff);
-  SubscriberBuilder_SetId(&my_config.id);
+  SubscriberBuilder_SetReceiverStateCallback(TurnOn, receiver_off);
+  SubscriberBuilder_SetId(&listen_id);
   const int result = SubscriberBuilder_Build();
   if (!result) {
-    Serial.println("Error: Subscriber builder");
+    Serial.println(F("Error: Subscriber builder"));
     delay(RETRY_INTERVAL);
   }
   SubscriberBuilder_Destroy();
@@ -120,24 +157,103 @@ int InitSubscriber() {
 
 void InitArduino() {
   Serial.begin(SERIAL_FREQ);
-  while (!Serial)
-    ;
+  Console_Begin();
   SSerial.begin(EBYTE_SERIAL_FREQ);
   while (!SSerial)
     ;
+  SerialRx_Begin(&SSerial);
+  FrameReader_Init(&frame_reader);
   pinMode(PIN_RX, INPUT);
   pinMode(PIN_TX, OUTPUT);
   pinMode(PIN_AUX, INPUT);
   pinMode(PIN_M0, OUTPUT);
   pinMode(PIN_M1, OUTPUT);
+  ModePins_Begin(PIN_M0, PIN_M1);
+  if (LOW_POWER)
+    ModePins_MapNormal(LOW, HIGH);
+  Power_Begin(PIN_AUX);
   pinMode(PING_PIN, INPUT);
   pinMode(LED_BUILTIN, OUTPUT);
   pinMode(LISTEN_LED_PIN, OUTPUT);
 }
 
 void InitDriver() {
+  config_source = F("written");
+  if (CONFIG_CACHE)
+    init_driver_cached();
+  else
+    lora_driver = Create_Driver(my_config.address_high,
+                                my_config.address_low, my_config.channel,
+                                BOOT_RATE, 1, 1);
+  radio_ready_ms = millis();
+}
+
+// The module is programmed only when the block is neither the copy in EEPROM
+// nor what the module reports, and checked reading it back.
+void init_driver_cached() {
+  unsigned char block[RADIO_CONFIG_LENGTH];
+  if (!dry_run_driver(BOOT_RATE)) {
+    lora_driver = Create_Driver(my_config.address_high,
+                                my_config.address_low, my_config.channel,
+                                BOOT_RATE, 1, 1);
+    return;
+  }
+  if (RadioConfig_Load(block) && 0 == memcmp(block, dry_block, sizeof(block))) {
+    config_source = F("eeprom");
+    return;
+  }
+  if (read_module_config(block) &&
+      0 == memcmp(block, dry_block, sizeof(block))) {
+    config_source = F("module");
+  } else if (!write_module_config(dry_block) || !read_module_config(block) ||
+             0 != memcmp(block, dry_block, sizeof(block))) {
+    config_source = F("failed");
+    return;
+  }
+  RadioConfig_Store(dry_block);
+}
+
+// Goes through Driver_Create without touching the module, for the driver and
+// the block it would write. Returns 0 for a driver that writes anything else
+// than one C0 block. The driver has no wake up time of its own, it is set
+// here into OPTION.
+int dry_run_driver(const unsigned char rate) {
+  radio_dry_run = 1;
   lora_driver = Create_Driver(my_config.address_high, my_config.address_low,
-                              my_config.channel, AIR_RATE_2400, 1, 1);
+                              my_config.channel, rate, 1, 1);
+  radio_dry_run = 0;
+  if (RADIO_CONFIG_LENGTH != dry_length || 0xC0 != dry_block[0])
+    return 0;
+  if (LOW_POWER)
+    dry_block[5] = (dry_block[5] & ~0x38) | (WOR_TIMING << 3);
+  return 1;
+}
+
+// C1 C1 C1 in sleep mode, the module answers with its saved configuration.
+int read_module_config(unsigned char *block) {
+  unsigned char command[3] = {0xC1, 0xC1, 0xC1};
+  return exchange_config(command, sizeof(command), block);
+}
+
+// The module echoes the parameters with a C0 head, for C2 as well.
+int write_module_config(unsigned char *block) {
+  unsigned char echo[RADIO_CONFIG_LENGTH];
+  return exchange_config(block, RADIO_CONFIG_LENGTH, echo) &&
+         0 == memcmp(echo + 1, block + 1, RADIO_CONFIG_LENGTH - 1);
+}
+
+int exchange_config(unsigned char *command, const unsigned long size,
+                    unsigned char *reply) {
+  unsigned long position = 0;
+  TurnOff();
+  ClearSerial();
+  WriteToSerial(command, size);
+  const unsigned long start = millis();
+  while (position < RADIO_CONFIG_LENGTH &&
+         millis() - start < CONFIG_READ_TIMEOUT)
+    position = ReadFromSerial(reply, RADIO_CONFIG_LENGTH, position);
+  TurnOn();
+  return RADIO_CONFIG_LENGTH == position;
 }
 
 Driver Create_Driver(const unsigned char address_high,
@@ -162,44 +278,112 @@ Driver Create_Driver(const unsigned char address_high,
 // Driver Dependencies
 
 unsigned long WriteToSerial(unsigned char *content, unsigned long size) {
-  debug_bytes("WriteToSerial", content, size);
+  if (radio_dry_run) {
+    dry_length = size < sizeof(dry_block) ? size : sizeof(dry_block);
+    memcpy(dry_block, content, dry_length);
+    return size;
+  }
+  if (ModePins_Mode() < 2) {
+    radio_transmitting = 1;
+    account_radio();
+  }
+  LOG_DEBUG_BYTES(LOG_WRITE_TO_SERIAL, content, size);
+  const unsigned long start = micros();
   unsigned long written = SSerial.write(content, size);
+  if (TRACE) {
+    Trace_Record(TRACE_UART_WRITE, start, micros());
+    trace_aux_stage = TRACE_AIR_WAIT;
+    trace_aux_since = 0;
+  }
   return written;
 }
 
 unsigned long ReadFromSerial(unsigned char *content, unsigned long size,
                              unsigned long position) {
-  while (SSerial.available() > 0 && position <= size) {
-    unsigned char input = SSerial.read();
-    // Serial.println(input, HEX);
+  unsigned char input;
+  const unsigned long first = position;
+  if (radio_dry_run) {
+    while (position < size && position < dry_length) {
+      content[position] = dry_block[position];
+      position++;
+    }
+    return position;
+  }
+  while (position < size && SerialRx_Read(&input)) {
     content[position] = input;
     position++;
   }
+  if (TRACE && 0 == first && position)
+    trace_read_start = micros();
+  if (TRACE && first < size && size == position)
+    Trace_Record(TRACE_UART_READ, trace_read_start, micros());
   return position;
 }
 
 void ClearSerial() {
-  while (SSerial.available() > 0) {
-    SSerial.read();
-  }
+  if (radio_dry_run)
+    return;
+  SerialRx_Clear();
+  FrameReader_Reset(&frame_reader);
 }
 
 int DigitalRead(unsigned char pin) {
+  if (radio_dry_run)
+    return HIGH;
+  if (PIN_AUX == pin)
+    apply_mode();
   int value = digitalRead(pin);
-  //  Serial.print("DigitalRead             ");
-  //  Serial.print(pin);
-  //  Serial.print(" = ");
-  //  Serial.println(value);
+  if (PIN_AUX == pin) {
+    value = ModePins_Aux(value);
+    Console_Drain();
+    // The driver polls AUX in a loop, the tasks between their other work.
+    if (LOW == value && !TASKS)
+      ModePins_AwaitAux(PIN_AUX);
+    if (radio_transmitting && HIGH == value) {
+      radio_transmitting = 0;
+      account_radio();
+    }
+  }
+  if (TRACE && PIN_AUX == pin)
+    trace_aux(value);
   return value;
 }
 
 void DigitalWrite(unsigned char pin, unsigned char value) {
-  digitalWrite(pin, value);
-  delay(1);
-  //  Serial.print("DigitalWrite            ");
-  //  Serial.print(pin);
-  //  Serial.print(" = ");
-  //  Serial.println(value);
+  if (radio_dry_run)
+    return;
+  if (PIN_M0 != pin && PIN_M1 != pin) {
+    digitalWrite(pin, value);
+    return;
+  }
+  ModePins_Latch(pin, value);
+  if (PIN_M1 == pin)
+    apply_mode();
+}
+
+// The driver waits on AUX after setting the mode, a mode still latched goes
+// out before the first read.
+void apply_mode() {
+  const unsigned long start = micros();
+  if (!ModePins_Apply())
+    return;
+  account_radio();
+  if (!TRACE)
+    return;
+  trace_mode_start = start;
+  trace_aux_stage = TRACE_AUX_WAIT;
+  trace_aux_since = 0;
+}
+
+// The radio state follows the mode pins, but for a frame on air, from its
+// write to the UART until AUX is back HIGH.
+void account_radio() {
+  static const EnergyRadio mode_states[4] = {
+      ENERGY_RADIO_RX, ENERGY_RADIO_RX, ENERGY_RADIO_WOR, ENERGY_RADIO_SLEEP};
+  Energy_Radio(&energy,
+               radio_transmitting ? ENERGY_RADIO_TX
+                                  : mode_states[ModePins_Mode()],
+               millis());
 }
 
 unsigned long Millis() {
@@ -212,69 +396,136 @@ unsigned long Millis() {
 
 unsigned long Transmit(const unsigned char *address,
                        const unsigned char *content, const unsigned long size) {
-  debug_bytes("Transmit content", content, size);
+  LOG_DEBUG_BYTES(LOG_TRANSMIT_CONTENT, content, size);
+  mark_first_frame();
   const Destination target = {address[0], address[1], address[2]};
-  return Driver_Send(&lora_driver, &target, content, size);
+  if (TASKS)
+    return send_frame(&target, content, size);
+  if (LOW_POWER)
+    ModePins_MapNormal(HIGH, LOW);
+  const unsigned long sent = Driver_Send(&lora_driver, &target, content, size);
+  if (LOW_POWER) {
+    ModePins_MapNormal(LOW, HIGH);
+    apply_mode();
+  }
+  return sent;
 }
 
 int Listen(const unsigned char *address, unsigned char *content,
            const unsigned long size) {
+  Console_Drain();
+#if FRAMED_LISTEN
+  int result = TASKS       ? take_frame(content, size)
+               : HANDSHAKE ? take_held_frame(content, size)
+                           : listen_framed(content, size);
+#else
   int result = Driver_Receive(&lora_driver, content, size);
+#endif
+  if (HANDSHAKE && !WINDOWED && !STAR && !BULK && !FEC && 0 == result)
+    announce_ready();
+  if (LOW_POWER && 0 == result)
+    listen_sleep();
   if (0 != result) {
-    debug_bytes("Listen content", content, size);
+    LOG_DEBUG_BYTES(LOG_LISTEN_CONTENT, content, size);
   }
   return result;
 }
 
+int listen_framed(unsigned char *content, const unsigned long size) {
+  unsigned char input;
+  unsigned char from;
+  const unsigned long now = micros();
+  FrameReader_Expire(&frame_reader, now);
+  while (SerialRx_Read(&input)) {
+    if (TRACE && 0 == frame_reader.length)
+      trace_read_start = now;
+    if (!FrameReader_Push(&frame_reader, input, size, now))
+      continue;
+    if (TRACE)
+      Trace_Record(TRACE_UART_READ, trace_read_start, micros());
+    if (Handshake_IsReady(frame_reader.buffer, size, &from)) {
+      if (from == her_config.id)
+        her_ready = 1;
+      continue;
+    }
+    memcpy(content, frame_reader.buffer, size);
+    return (int)size;
+  }
+  return 0;
+}
+
+// -----------------------------------------------------------------------------
+// Receiver state
+
+// With the handshake the module stays in NORMAL mode after a pull, otherwise
+// her first ready token arrives while it sleeps and is lost. The window keeps
+// it on for the same reason, the next frame or ACK is never far away, and so
+// do the bulk transfers, the FEC stream and the tasks, which listen between
+// pulls.
+void receiver_off() {
+  if (!HANDSHAKE && !WINDOWED && !BULK && !FEC && !TASKS)
+    TurnOff();
+}
+
 void TurnOn() {
   Driver_TurnOn(&lora_driver);
-  //  Serial.print("Turned on: ");
-  //  Serial.println(lora_driver.state == NORMAL);
 }
 
 void TurnOff() {
   Driver_TurnOff(&lora_driver);
-  //  Serial.print("Turned off: ");
-  //  Serial.println(lora_driver.state == SLEEP);
 }
 
 // -----------------------------------------------------------------------------
 // Use cases
 
-void Pull(unsigned char *body) {
+Result Pull(unsigned char *body) {
   unsigned char id = 0;
   unsigned char port = 0;
   const unsigned char address[3] = {my_config.address_high,
                                     my_config.address_low, my_config.channel};
-  memset(body, 0, sizeof(Ball));
-  debug_bytes("Pull address", address, sizeof(address));
-  Result result = Pull_Invoke(address, &port, &id, body);
-  debug_bytes("Pulled message port", &port, 1);
-  debug_bytes("Pulled message id", &id, 1);
-  debug_bytes("My id", &my_config.id, 1);
-  debug_bytes("Pulled body", body, MESSAGE_BODY_LENGTH);
-  debug_result("Result", result);
+  memset(body, 0, MESSAGE_BODY_LENGTH);
+  LOG_DEBUG_BYTES(LOG_PULL_ADDRESS, address, sizeof(address));
+  announce_gap = 0;
+  Result result = RELAY ? relay_pull(address, &port, &id, body)
+                        : Pull_Invoke(address, &port, &id, body);
+  her_ready = 0;
+  ++pull_count;
+  if (Success == result) {
+    ++received_count;
+    measure_frame_latency();
+  }
+  else if (Timeout == result)
+    ++timeout_count;
+  LOG_DEBUG_BYTES(LOG_PULLED_PORT, &port, 1);
+  LOG_DEBUG_BYTES(LOG_PULLED_ID, &id, 1);
+  LOG_DEBUG_BYTES(LOG_MY_ID, &my_config.id, 1);
+  LOG_DEBUG_BYTES(LOG_PULLED_BODY, body, MESSAGE_BODY_LENGTH);
+  debug_result(result);
+  return result;
 }
 
 void OneToOne(const unsigned char *body) {
   const unsigned char address[3] = {her_config.address_high,
                                     her_config.address_low, her_config.channel};
-  debug_info("Fixed address transmission mode");
-  Publish(address, body);
+  LOG_DEBUG(LOG_FIXED_MODE);
+  if (RELAY)
+    relay_publish(body);
+  else
+    Publish(address, body);
 }
 
 void Publish(const unsigned char address[3], const unsigned char *body) {
-  debug_bytes("Publish to port", &her_config.port, 1);
-  debug_bytes("Publish to id", &her_config.id, 1);
-  debug_bytes("Publish to address", address, 3);
-  debug_bytes("Publish body", body, MESSAGE_BODY_LENGTH);
+  LOG_DEBUG_BYTES(LOG_PUBLISH_PORT, &her_config.port, 1);
+  LOG_DEBUG_BYTES(LOG_PUBLISH_ID, &her_config.id, 1);
+  LOG_DEBUG_BYTES(LOG_PUBLISH_ADDRESS, address, 3);
+  LOG_DEBUG_BYTES(LOG_PUBLISH_BODY, body, MESSAGE_BODY_LENGTH);
   Publish_Invoke(address, her_config.port, her_config.id, body);
 }
 
 void Broadcast(const unsigned char *body) {
   const unsigned char address[3] = {BROADCAST_ADDRESS_HIGH,
                                     BROADCAST_ADDRESS_LOW, LORA_CHANNEL};
-  debug_info("Broadcast transmission mode");
+  LOG_DEBUG(LOG_BROADCAST_MODE);
   Publish(address, body);
 }
 
@@ -282,82 +533,259 @@ void Broadcast(const unsigned char *body) {
 // Debug
 
 void debug_state(Driver *driver) {
-  Serial.print("Driver state: ");
+  Serial.print(F("Driver state: "));
   switch (driver->state) {
   case NORMAL:
-    Serial.println("NORMAL");
+    Serial.println(F("NORMAL"));
     break;
   case SLEEP:
-    Serial.println("SLEEP");
+    Serial.println(F("SLEEP"));
     break;
   case ERROR:
-    Serial.println("ERROR");
+    Serial.println(F("ERROR"));
     break;
   case WARNING:
-    Serial.println("WARNING");
+    Serial.println(F("WARNING"));
     break;
   default:
-    Serial.println("UNKNOWN");
+    Serial.println(F("UNKNOWN"));
   }
 }
 
-void print_bytes(const unsigned char *body, unsigned long size) {
-  unsigned int i;
-  Serial.print("|");
-  for (i = 0; i < size; i++) {
-    Serial.print(body[i], HEX);
-    Serial.print("|");
-  }
-  Serial.println();
-}
-
-void print_chars(const char *anArray, unsigned long size) {
-  char printable[size + 1];
-  memcpy(printable, anArray, size);
-  printable[size] = '\0';
-  Serial.println(printable);
-}
-
+#if LOG_ENABLED(LOG_LEVEL_DEBUG)
 void blink(int pin) {
   digitalWrite(pin, HIGH);
   delay(10);
   digitalWrite(pin, LOW);
 }
 
-void debug_bytes(const char *title, const unsigned char *value,
-                 const unsigned long size) {
-  if (!DEBUG)
-    return;
-  Serial.print(title);
-  Serial.print(": ");
-  print_bytes(value, size);
-}
-
-void debug_info(const char *title) {
-  if (!DEBUG)
-    return;
-  Serial.println(title);
-}
-
-void debug_result(const char *title, Result result) {
-  if (!DEBUG) return;
-  Serial.print(title);
-  Serial.print(": ");
+void debug_result(const Result result) {
   switch (result) {
   case Success:
-    Serial.println("------------------ Success ------------------");
+    LOG_DEBUG(LOG_RESULT_SUCCESS);
     blink(LISTEN_LED_PIN);
     break;
   case Timeout:
-    Serial.println("xxxxxxxxxxxxxxxxxx Time out xxxxxxxxxxxxxxxxxx");
+    LOG_DEBUG(LOG_RESULT_TIMEOUT);
     break;
   case IOError:
     loop_count = 0;
-    Serial.println("XXXXXXXXXXXXXXXXXX IO Error XXXXXXXXXXXXXXXXXX");
+    LOG_DEBUG(LOG_RESULT_IO_ERROR);
     break;
   default:
-    Serial.println("****************** Unexpected ******************");
+    LOG_DEBUG(LOG_RESULT_UNEXPECTED);
+  }
+}
+#else
+void debug_result(Result) {}
+#endif
+
+// -----------------------------------------------------------------------------
+// Trace
+
+// The driver polls AUX after a mode switch and after every UART write. The
+// pin writes up to the first poll are the mode switch, the polls up to AUX
+// going HIGH are the wait for the module, or for the air after a write.
+void trace_aux(const int value) {
+  const unsigned long now = micros();
+  if (TRACE_STAGES == trace_aux_stage)
+    return;
+  if (trace_mode_start) {
+    Trace_Record(TRACE_MODE_SWITCH, trace_mode_start, now);
+    trace_mode_start = 0;
   }
+  if (!trace_aux_since)
+    trace_aux_since = now;
+  if (HIGH != value)
+    return;
+  Trace_Record(trace_aux_stage, trace_aux_since, now);
+  trace_aux_stage = TRACE_STAGES;
+}
+
+// One line per stage and one per non empty bucket: the lower bound of the
+// bucket in microseconds and its count.
+void print_trace() {
+  unsigned char stage;
+  unsigned char bucket;
+  Console_Flush();
+  Trace_Aggregate();
+  for (stage = 0; stage < TRACE_STAGES; stage++) {
+    const TraceHistogram *histogram = Trace_Histogram(stage);
+    Serial.print(F("trace "));
+    Serial.print(Trace_StageName(stage));
+    Serial.print(F(" n "));
+    Serial.print(histogram->count);
+    Serial.print(F(" max "));
+    Serial.println(histogram->max_us);
+    for (bucket = 0; bucket < TRACE_BUCKETS; bucket++) {
+      if (!histogram->buckets[bucket])
+        continue;
+      Serial.print(F("trace "));
+      Serial.print(Trace_StageName(stage));
+      Serial.print(F(" "));
+      Serial.print(Trace_BucketFloor(bucket));
+      Serial.print(F(" "));
+      Serial.println(histogram->buckets[bucket]);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Report
+
+// Time from the last received byte landing in the ring to Pull_Invoke
+// returning the message.
+void mark_first_frame() {
+  if (!first_frame_ms)
+    first_frame_ms = millis();
+}
+
+void measure_frame_latency() {
+  const unsigned long latency = micros() - SerialRx_LastByteUs();
+  frame_latency_sum_us += latency;
+  if (frame_latency_max_us < latency)
+    frame_latency_max_us = latency;
+}
+
+void PrintReport() {
+  const unsigned long elapsed = millis();
+  const ConsoleStats console = Console_Stats();
+  Console_Flush();
+  Serial.print(F("Pulls: "));
+  Serial.print(pull_count);
+  Serial.print(F(" Received: "));
+  Serial.print(received_count);
+  Serial.print(F(" Timeouts: "));
+  Serial.print(timeout_count);
+  Serial.print(F(" Record: "));
+  Serial.println(record);
+  Serial.print(F("Hits/s: "));
+  Serial.print(elapsed ? 1000.0 * received_count / elapsed : 0.0, 3);
+  Serial.print(F(" Timeout rate: "));
+  Serial.println(pull_count ? (double)timeout_count / pull_count : 0.0, 4);
+  const SerialRxStats rx = SerialRx_Stats();
+  Serial.print(F("Rx overruns: "));
+  Serial.print(rx.overruns);
+  Serial.print(F(" Rx high water: "));
+  Serial.print(rx.high_water);
+  Serial.print(F("/"));
+  Serial.println(SERIAL_RX_SIZE - 1);
+  Serial.print(F("Frame latency us avg: "));
+  Serial.print(received_count ? frame_latency_sum_us / received_count : 0);
+  Serial.print(F(" max: "));
+  Serial.print(frame_latency_max_us);
+  Serial.print(F(" Dropped bytes: "));
+  Serial.println(frame_reader.dropped);
+  Serial.print(F("Goodput B/s: "));
+  Serial.print(elapsed ? 1000.0 * payload_bytes / elapsed : 0.0, 2);
+  Serial.print(F(" Order errors: "));
+  Serial.println(order_errors);
+  if (WINDOWED)
+    print_window();
+  Serial.print(F("RTT ms: "));
+  Serial.print(Rtt_Smoothed(&her_rtt));
+  Serial.print(F(" Pull timeout ms: "));
+  Serial.print(Rtt_Timeout(&her_rtt));
+  Serial.print(F(" Samples: "));
+  Serial.print(her_rtt.samples);
+  Serial.print(F(" Backoffs: "));
+  Serial.println(her_rtt.backoffs);
+  Serial.print(F("Console dropped: "));
+  Serial.print(console.dropped);
+  Serial.print(F(" Console high water: "));
+  Serial.print(console.high_water);
+  Serial.print(F("/"));
+  Serial.println(CONSOLE_TX_SIZE - 1);
+  Serial.print(F("Boot ms radio ready: "));
+  Serial.print(radio_ready_ms);
+  Serial.print(F(" first frame: "));
+  Serial.print(first_frame_ms);
+  Serial.print(F(" Config: "));
+  Serial.println(config_source);
+  const ModePinsStats mode = ModePins_Stats();
+  Serial.print(F("Mode switches: "));
+  Serial.print(mode.switches);
+  Serial.print(F(" Latency us avg: "));
+  Serial.print(mode.switches ? mode.latency_sum_us / mode.switches : 0);
+  Serial.print(F(" max: "));
+  Serial.println(mode.latency_max_us);
+  print_handshake();
+  if (ADAPTIVE_RATE && !WINDOWED && !STAR && !BULK && !FEC)
+    print_air_rates(elapsed);
+  if (CHANNELS)
+    print_channel();
+  if (STAR)
+    print_star();
+  if (RELAY)
+    print_relay();
+  if (BULK)
+    print_bulk();
+  if (FEC)
+    print_fec();
+  if (TASKS)
+    print_tasks();
+  print_energy();
+  print_memory();
+  if (TRACE)
+    print_trace();
+}
+
+// The frame pool, the biggest buffers by their compile-time sizes and, on the
+// AVR, the stack peak from painting, see memory.h. tools/memory.py has the
+// static RAM and flash of every module of a build.
+void print_memory() {
+  const MemoryStats memory = Memory_Stats();
+  Serial.print(F("Frame pool in use: "));
+  Serial.print(frame_pool.in_use);
+  Serial.print(F(" high water: "));
+  Serial.print(frame_pool.high_water);
+  Serial.print(F("/"));
+  Serial.print(FRAME_POOL_SIZE);
+  Serial.print(F(" Takes: "));
+  Serial.print(frame_pool.takes);
+  Serial.print(F(" Exhausted: "));
+  Serial.print(frame_pool.exhausted);
+  Serial.print(F(" Misuse: "));
+  Serial.println(frame_pool.misuse);
+  Serial.print(F("RAM bytes frame pool: "));
+  Serial.print(sizeof(frame_pool));
+  Serial.print(F(" console: "));
+  Serial.print(CONSOLE_TX_SIZE);
+  Serial.print(F(" serial rx: "));
+  Serial.print(SERIAL_RX_SIZE);
+  Serial.print(F(" SoftwareSerial: "));
+  Serial.print(SSERIAL_RX_BUFFER);
+  Serial.print(F(" window: "));
+  Serial.print(sizeof(WindowSender) + sizeof(WindowReceiver));
+  Serial.print(F(" tx queue: "));
+  Serial.print(sizeof(TxQueue));
+  Serial.print(F(" scheduler: "));
+  Serial.println(sizeof(Scheduler));
+  if (!MEMORY_MEASURED) {
+    Serial.println(F("Static RAM and stack peak: measured on the AVR only"));
+    return;
+  }
+  Serial.print(F("Static RAM: "));
+  Serial.print(memory.static_bytes);
+  Serial.print(F("/"));
+  Serial.print(MEMORY_RAM);
+  Serial.print(F(" Stack peak: "));
+  Serial.print(memory.stack_peak);
+  Serial.print(F(" Never used: "));
+  Serial.print(memory.never_used);
+  Serial.print(F(" Free now: "));
+  Serial.println(memory.free_now);
+}
+
+// One letter from the console: 't' the trace histograms, 'm' the memory.
+void read_command() {
+  if (0 >= Serial.available())
+    return;
+  const int command = Serial.read();
+  if (TRACE && 't' == command)
+    print_trace();
+  else if ('m' == command)
+    print_memory();
 }
 
 // -----------------------------------------------------------------------------
@@ -373,23 +801,116 @@ void setup() {
   last_hit = HIT_START;
   hit = HIT_START;
   record = HIT_START;
+  Rtt_Init(&her_rtt, WINDOWED || BULK ? WINDOW_RTO : PULL_TIMEOUT, RTT_MARGIN,
+           RTT_MAX_TIMEOUT);
+  Energy_Init(&energy, WOR_PERIOD_MS, millis());
+  FramePool_Init(&frame_pool);
+  // The state of a mode is touched only from behind its flag, so that the
+  // linker drops the globals of the modes a build leaves out.
+  if (WINDOWED)
+    window_begin();
+  if (STAR)
+    star_begin();
+  if (BULK)
+    bulk_begin();
+  if (FEC)
+    fec_begin();
+  if (ADAPTIVE_RATE)
+    rate_begin();
+  if (TASKS)
+    start_tasks();
 }
 
 void i_receive() {
-  Ball ball;
-  Pull((unsigned char *)&ball);
-  hit = ball.hit;
+  if (ADAPTIVE_TIMEOUT)
+    receiving_timeout = Rtt_Timeout(&her_rtt);
+  const Result result = pull_ball();
+  if (ball_frame)
+    handle_ball(result, (const Ball *)ball_frame->body);
+}
+
+// One frame of the pool a turn: Pull fills it and hands it to the
+// application, which reads her ball in place and keeps the frame for the one
+// it publishes back. A frame the last turn did not publish goes back first.
+Result pull_ball() {
+  drop_ball_frame();
+  Frame *frame = FramePool_Take(&frame_pool, FRAME_PULL);
+  if (!frame)
+    return Unexpected;
+  const Result result = Pull(frame->body);
+  FramePool_Hand(&frame_pool, frame, FRAME_PULL, FRAME_APP);
+  ball_frame = frame;
+  return result;
+}
+
+void drop_ball_frame() {
+  if (ball_frame)
+    FramePool_Release(&frame_pool, ball_frame, FRAME_APP);
+  ball_frame = 0;
 }
 
+void handle_ball(const Result result, const Ball *ball) {
+  if (Success == result)
+    payload_bytes += MESSAGE_BODY_LENGTH;
+  track_round_trip(result);
+  if (ADAPTIVE_RATE)
+    rate_handle(result, ball->remaining[0]);
+  if (RELAY && Timeout == result)
+    relay_beacon_due = 1;
+  if (CHANNELS)
+    channel_handle(result, ball->remaining[1]);
+  if (ADAPTIVE_RATE)
+    switch_air_rate();
+  if (CHANNELS)
+    switch_channel();
+  hit = ball->hit;
+}
+
+// Rewrites the frame of her ball, or a new one on the first serve, and hands
+// it to Publish, which gives it back to the pool once it is out.
 void i_publish() {
-  Ball ball;
-  ball.hit = hit;
-  OneToOne((unsigned char *)&ball);
+  Frame *frame =
+      ball_frame ? ball_frame : FramePool_Take(&frame_pool, FRAME_APP);
+  ball_frame = 0;
+  if (!frame)
+    return;
+  Ball *ball = (Ball *)frame->body;
+  memset(ball, 0, sizeof(*ball));
+  ball->hit = hit;
+  if (ADAPTIVE_RATE)
+    ball->remaining[0] = rate_command();
+  if (CHANNELS)
+    ball->remaining[1] = channel_command();
+  FramePool_Hand(&frame_pool, frame, FRAME_APP, FRAME_PUBLISH);
+  OneToOne(frame->body);
+  FramePool_Release(&frame_pool, frame, FRAME_PUBLISH);
+  published_at = millis();
+  rtt_pending = 1;
+  if (ADAPTIVE_RATE)
+    switch_air_rate();
+  if (CHANNELS)
+    switch_channel();
+}
+
+// A round trip is from my publish to her ball, a pull that did not follow a
+// publish of mine only tells something when it times out.
+void track_round_trip(const Result result) {
+  if (!ADAPTIVE_TIMEOUT)
+    return;
+  if (Success == result && rtt_pending)
+    Rtt_Sample(&her_rtt, millis() - published_at);
+  else if (Timeout == result)
+    Rtt_Backoff(&her_rtt);
+  rtt_pending = 0;
+}
+
+unsigned long window_timeout() {
+  return ADAPTIVE_TIMEOUT ? Rtt_Timeout(&her_rtt) : WINDOW_RTO;
 }
 
 void ping_pong() {
   if (0 == loop_count && my_config.do_i_ping) {
-    Serial.println("I am Ping");
+    Serial.println(F("I am Ping"));
   } else {
     i_receive();
     delay(PING_PONG_INTERVAL);
@@ -397,7 +918,7 @@ void ping_pong() {
   i_publish();
   loop_count++;
   hit = loop_count;
-  Serial.print("Succeeded loop count: ");
+  Serial.print(F("Succeeded loop count: "));
   Serial.println(loop_count);
 }
 
@@ -406,22 +927,35 @@ void set_new_record(unsigned long hit_) {
     record = hit;
 }
 
+// Queued on the console, it goes out while the radio waits.
 void print_hit_log() {
-  char hit_log[100];
+  char hit_log[47]; // 3 columns of 12 and their bars
   if (0 == hit % 50 || (!my_config.do_i_ping && 0 == (hit - 1) % 50)) {
-    Serial.println("|--------------+--------------+--------------|");
-    sprintf(hit_log, "| %12s | %12s | %12s |", "Given", "Got", "Record");
-    Serial.println(hit_log);
-    Serial.println("|--------------+--------------+--------------|");
+    Console_PrintFlash(F("|--------------+--------------+--------------|"));
+    Console_PrintFlash(F("|        Given |          Got |       Record |"));
+    Console_PrintFlash(F("|--------------+--------------+--------------|"));
   }
-  sprintf(hit_log, "| %12lu | %12lu | %12lu |", last_hit, hit, record);
-  Serial.println(hit_log);
+  snprintf_P(hit_log, sizeof(hit_log), PSTR("| %12lu | %12lu | %12lu |"),
+             last_hit, hit, record);
+  Console_Print(hit_log);
+}
+
+void deliver_counter(const unsigned char *value) {
+  uint32_t count;
+  memcpy(&count, value, sizeof(count));
+  if (count != hit + 1)
+    ++order_errors;
+  last_hit = hit;
+  hit = count;
+  set_new_record(hit);
+  if (0 == hit % 50)
+    print_hit_log();
 }
 
 void assert_ping_pong() {
   if (HIT_START == hit && my_config.do_i_ping) {
-    Serial.println("I am Ping");
-    delay(PING_PONG_INTERVAL);
+    Console_PrintFlash(F("I am Ping"));
+    let_her_prepare(PING_PONG_INTERVAL);
     ++hit;
     i_publish();
     return;
@@ -430,19 +964,48 @@ void assert_ping_pong() {
     set_new_record(hit);
     print_hit_log();
     if (0 != hit && last_hit == hit) {
-      Serial.print("Error at Hit: ");
-      Serial.println(hit);
-      Serial.println("Hit Error X-X-X-X-X--------=hit=--------X-X-X-X-X-X-X");
+      char error_log[40];
+      sprintf_P(error_log, PSTR("Error at Hit: %lu"), hit);
+      Console_Print(error_log);
+      Console_PrintFlash(
+          F("Hit Error X-X-X-X-X--------=hit=--------X-X-X-X-X-X-X"));
       hit = HIT_START;
-      delay(PING_PONG_INTERVAL);
+      if (!HANDSHAKE)
+        nap(PING_PONG_INTERVAL);
       assert_ping_pong();
     } else if (0 != hit) {
       ++hit;
     }
   }
   last_hit = hit;
-  delay(LET_HER_PREPARE_DELAY);
+  let_her_prepare(LET_HER_PREPARE_DELAY);
   i_publish();
 }
 
-void loop() { assert_ping_pong(); }
+void loop() {
+  if (!TASKS)
+    Console_Drain();
+  read_command();
+  if (TASKS)
+    run_tasks();
+  else if (RELAY && relay_only)
+    relay_serve();
+  else if (STAR && my_config.do_i_ping)
+    star_coordinate();
+  else if (STAR)
+    star_leaf();
+  else if (BULK && my_config.do_i_ping)
+    bulk_receive();
+  else if (BULK)
+    bulk_send();
+  else if (FEC && my_config.do_i_ping)
+    fec_send();
+  else if (FEC)
+    fec_receive();
+  else if (!WINDOWED)
+    assert_ping_pong();
+  else if (my_config.do_i_ping)
+    window_send();
+  else
+    window_receive();
+}
@@ -9,6 +9,30 @@
 #include "../lib/CommoTalkie/Pull.h"
 #include "../lib/CommoTalkie/SubscriberBuilder.h"
 #include "../lib/CommoTalkie/messageconfig.h"
+#include "batch.h"
+#include "bulk.h"
+#include "channelhop.h"
+#include "codec.h"
+#include "console.h"
+#include "energy.h"
+#include "fec.h"
+#include "framepool.h"
+#include "framereader.h"
+#include "handshake.h"
+#include "linkrate.h"
+#include "log.h"
+#include "memory.h"
+#include "modepins.h"
+#include "power.h"
+#include "radioconfig.h"
+#include "relay.h"
+#include "rtt.h"
+#include "scheduler.h"
+#include "serialrx.h"
+#include "tdma.h"
+#include "trace.h"
+#include "txqueue.h"
+#include "window.h"
 #include <Arduino.h>
 #include <SoftwareSerial.h>
 
@@ -22,24 +46,60 @@
 
 #define LISTEN_LED_PIN 11
 #define PING_PIN 12
+// A0 to A4, the number of a star leaf
+#define PIN_ID_FIRST 14
+// Closed to ground: a node that only forwards
+#define PIN_RELAY_ONLY 10
+// A5, sampled by the sensor task
+#define PIN_SENSOR 19
+
+// Receive buffer of SoftwareSerial, for the memory report
+#ifdef _SS_MAX_RX_BUFF
+#define SSERIAL_RX_BUFFER _SS_MAX_RX_BUFF
+#else
+#define SSERIAL_RX_BUFFER 64
+#endif
 
 #define COMMOTALKIE_SALT "1111111111"
 
-#define MODE_TIMEOUT 4000
+// Building with TUNED set to 1 takes the timing constants below, and
+// PING_PONG_INTERVAL and LET_HER_PREPARE_DELAY, from the header
+// tools/tune.py exports.
+#if TUNED
+#include "tuned.h"
+#endif
+
+// Longest wait on AUX, the air time of a message at 300 bps is under 1 s. In
+// wake up mode the frame goes out behind a preamble as long as the wake up
+// period, WOR_PERIOD_MS, and the wait grows by as much.
+#define FRAME_AIR_MS 1000
+#ifndef MODE_TIMEOUT
+#define MODE_TIMEOUT (2000 + (LOW_POWER ? WOR_PERIOD_MS : 0))
+#endif
+#ifndef SERIAL_TIMEOUT
 #define SERIAL_TIMEOUT 5000
+#endif
+#ifndef PULL_TIMEOUT
 #define PULL_TIMEOUT 6000
+#endif
 
+#ifndef RETRY_INTERVAL
 #define RETRY_INTERVAL 30000
+#endif
 
 #define LORA_CHANNEL 0x10
 #define COMMON_PORT 0xC6
 
+#include "config.h"
+
 #pragma pack(push)
 #pragma pack(4)
 
+// The same 4 byte counter on the host as on the AVR, so the commands in
+// remaining have the same room.
 typedef struct Ball {
-  unsigned long hit;
-  unsigned char remaining[MESSAGE_BODY_LENGTH - sizeof(unsigned long)];
+  uint32_t hit;
+  unsigned char remaining[MESSAGE_BODY_LENGTH - sizeof(uint32_t)];
 } Ball;
 
 #pragma pack(pop)
@@ -57,16 +117,44 @@ void InitArduino();
 void InitDriver();
 int InitPublisher();
 int InitSubscriber();
-void Pull(unsigned char *body);
+Result Pull(unsigned char *body);
 void i_receive();
+Result pull_ball();
+void handle_ball(Result result, const Ball *ball);
 void i_publish();
 void OneToOne(const unsigned char *body);
 void Publish(const unsigned char address[3], const unsigned char *body);
 void Broadcast(const unsigned char *body);
+void PrintReport();
+unsigned char read_id_straps();
+int dry_run_driver(unsigned char rate);
+int write_module_config(unsigned char *block);
+int listen_framed(unsigned char *content, unsigned long size);
+void mark_first_frame();
+unsigned long window_timeout();
+void set_new_record(unsigned long hit_);
+void print_hit_log();
+void deliver_counter(const unsigned char *value);
 Driver Create_Driver(unsigned char address_high, unsigned char address_low,
                         unsigned char channel, unsigned char air_data_rate,
                         int is_fixed,
                         int full_power);
+
+// The state of main.cpp the mode files share, see mode_*.h.
+extern Driver lora_driver;
+extern FrameReader frame_reader;
+extern LoraConfig my_config;
+extern LoraConfig her_config;
+extern unsigned char listen_id;
+extern unsigned long receiving_timeout;
+extern unsigned long received_count;
+extern unsigned long payload_bytes;
+extern unsigned long hit;
+extern unsigned long last_hit;
+extern Frame *ball_frame;
+extern RttEstimator her_rtt;
+extern unsigned char dry_block[RADIO_CONFIG_LENGTH];
+
 extern "C" void ClearSerial();
 extern "C" unsigned long WriteToSerial(unsigned char *content,
                                        unsigned long size);
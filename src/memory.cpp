@@ -0,0 +1,53 @@
+#include "memory.h"
+#include <string.h>
+
+#ifdef __AVR__
+// From the linker script: the start of .data, the end of .bss, and RAMEND.
+// The sketch takes nothing from the heap, so the stack has the whole gap.
+extern unsigned char __data_start;
+extern unsigned char _end;
+extern unsigned char __stack;
+
+static void paint_stack() __attribute__((naked, used, section(".init1")));
+#endif
+
+#ifdef __AVR__
+
+// Runs in .init1, straight after reset and before the C runtime has set up
+// r1 or the stack pointer, so in registers only.
+void paint_stack() {
+  __asm__ volatile("    ldi r30, lo8(_end)\n"
+                   "    ldi r31, hi8(_end)\n"
+                   "    ldi r24, %0\n"
+                   "    ldi r25, hi8(__stack)\n"
+                   "    rjmp 2f\n"
+                   "1:  st Z+, r24\n"
+                   "2:  cpi r30, lo8(__stack)\n"
+                   "    cpc r31, r25\n"
+                   "    brlo 1b\n"
+                   "    breq 1b\n"
+                   :
+                   : "i"(MEMORY_CANARY));
+}
+
+MemoryStats Memory_Stats() {
+  MemoryStats stats;
+  const unsigned char *deepest = &_end;
+  while (deepest <= &__stack && MEMORY_CANARY == *deepest)
+    deepest++;
+  stats.static_bytes = (unsigned int)(&_end - &__data_start);
+  stats.never_used = (unsigned int)(deepest - &_end);
+  stats.stack_peak = (unsigned int)(&__stack + 1 - deepest);
+  stats.free_now = (unsigned int)SP - (unsigned int)&_end;
+  return stats;
+}
+
+#else
+
+MemoryStats Memory_Stats() {
+  MemoryStats stats;
+  memset(&stats, 0, sizeof(stats));
+  return stats;
+}
+
+#endif
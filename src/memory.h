@@ -0,0 +1,38 @@
+#ifndef COMMOTALKINO_SRC_MEMORY_H_
+#define COMMOTALKINO_SRC_MEMORY_H_
+
+#include <Arduino.h>
+
+// RAM use of the running sketch on the ATmega328, 2 KB for everything. Static
+// RAM is .data and .bss, the globals, fixed at link time. The stack grows
+// down from the top towards them, and the free RAM is what lies in between.
+//
+// The peak of the stack comes from painting: before the C runtime sets up
+// anything, the whole gap from the end of the globals to the top of RAM is
+// filled with MEMORY_CANARY. The stack overwrites it as it grows, and the
+// lowest byte that no longer holds the canary is as deep as it has ever been.
+// A local that happens to store the canary value hides at most the bytes
+// below it, so the peak is right to a byte or two.
+//
+// The host has no such layout, MEMORY_MEASURED is 0 there and every figure
+// reads 0; tools/memory.py gives the static sizes of a build per module.
+
+#define MEMORY_CANARY 0xC5
+#define MEMORY_RAM 2048
+
+#ifdef __AVR__
+#define MEMORY_MEASURED 1
+#else
+#define MEMORY_MEASURED 0
+#endif
+
+typedef struct MemoryStats {
+  unsigned int static_bytes;
+  unsigned int stack_peak;
+  unsigned int never_used;
+  unsigned int free_now;
+} MemoryStats;
+
+MemoryStats Memory_Stats();
+
+#endif // COMMOTALKINO_SRC_MEMORY_H_
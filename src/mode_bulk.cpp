@@ -0,0 +1,107 @@
+#include "mode_bulk.h"
+#include "main.h"
+
+static void read_log(unsigned long offset, unsigned char *data,
+                     unsigned char length);
+static void check_log(unsigned long offset, const unsigned char *data,
+                      unsigned char length);
+static unsigned char log_byte(unsigned long offset);
+
+BulkSender bulk_sender;
+BulkReceiver bulk_receiver;
+unsigned long bulk_errors;
+unsigned long bulk_transfer_ms;
+
+void bulk_begin() {
+  BulkSender_Init(&bulk_sender);
+  BulkReceiver_Init(&bulk_receiver, 0, 0, check_log);
+}
+
+// Starts the next transfer as soon as one ends, sends the burst and waits for
+// the STATUS it asks for.
+void bulk_send() {
+  BulkFrame frame;
+  if (!BulkSender_Busy(&bulk_sender))
+    BulkSender_Start(&bulk_sender, BULK_BYTES, read_log);
+  const unsigned long retransmissions = bulk_sender.retransmissions;
+  const unsigned long burst_start = millis();
+  while (BulkSender_Next(&bulk_sender, &frame))
+    OneToOne((unsigned char *)&frame);
+  receiving_timeout = window_timeout();
+  if (Success != Pull((unsigned char *)&frame)) {
+    BulkSender_Timeout(&bulk_sender);
+    if (ADAPTIVE_TIMEOUT)
+      Rtt_Backoff(&her_rtt);
+    return;
+  }
+  // Karn, as with the window.
+  if (ADAPTIVE_TIMEOUT && retransmissions == bulk_sender.retransmissions)
+    Rtt_Sample(&her_rtt, millis() - burst_start);
+  payload_bytes += BulkSender_OnStatus(&bulk_sender, &frame);
+}
+
+void bulk_receive() {
+  BulkFrame frame;
+  const unsigned long completed = bulk_receiver.completed;
+  receiving_timeout = PULL_TIMEOUT;
+  if (Success != Pull((unsigned char *)&frame) ||
+      !BulkReceiver_Push(&bulk_receiver, &frame))
+    return;
+  BulkReceiver_BuildStatus(&bulk_receiver, &frame);
+  OneToOne((unsigned char *)&frame);
+  if (completed == bulk_receiver.completed && BULK_CORRUPT != frame.data[1])
+    return;
+  char bulk_log[60];
+  sprintf_P(bulk_log,
+            BULK_CORRUPT == frame.data[1]
+                ? PSTR("Bulk %lu: %lu bytes corrupt in %lu ms")
+                : PSTR("Bulk %lu: %lu bytes complete in %lu ms"),
+            bulk_receiver.completed, bulk_receiver.length,
+            millis() - bulk_transfer_ms);
+  Console_Print(bulk_log);
+  bulk_transfer_ms = millis();
+}
+
+// Stands in for the log store of a field node, any byte is at hand by its
+// offset and nothing of it is in RAM.
+void read_log(const unsigned long offset, unsigned char *data,
+              const unsigned char length) {
+  unsigned char i;
+  for (i = 0; i < length; i++)
+    data[i] = log_byte(offset + i);
+}
+
+void check_log(const unsigned long offset, const unsigned char *data,
+               const unsigned char length) {
+  unsigned char i;
+  for (i = 0; i < length; i++) {
+    if (log_byte(offset + i) != data[i])
+      ++bulk_errors;
+  }
+  payload_bytes += length;
+}
+
+unsigned char log_byte(const unsigned long offset) {
+  return (unsigned char)(offset * 131 + (offset >> 8));
+}
+
+void print_bulk() {
+  Serial.print(F("Bulk transfers sent: "));
+  Serial.print(bulk_sender.completed);
+  Serial.print(F(" Frames: "));
+  Serial.print(bulk_sender.frames);
+  Serial.print(F(" Retransmitted: "));
+  Serial.print(bulk_sender.retransmissions);
+  Serial.print(F(" Timeouts: "));
+  Serial.println(bulk_sender.timeouts);
+  Serial.print(F("Bulk transfers received: "));
+  Serial.print(bulk_receiver.completed);
+  Serial.print(F(" Frames: "));
+  Serial.print(bulk_receiver.frames);
+  Serial.print(F(" Duplicates: "));
+  Serial.print(bulk_receiver.duplicates);
+  Serial.print(F(" Byte errors: "));
+  Serial.print(bulk_errors);
+  Serial.print(F(" Bulk RAM bytes: "));
+  Serial.println(sizeof(bulk_sender) + sizeof(bulk_receiver));
+}
@@ -0,0 +1,13 @@
+#ifndef COMMOTALKINO_SRC_MODE_BULK_H_
+#define COMMOTALKINO_SRC_MODE_BULK_H_
+
+// BULK, see config.h: the loop calls bulk_send() on Pong, the field node,
+// which sends its log in transfers of BULK_BYTES, and bulk_receive() on Ping,
+// which checks every chunk against the same log as it arrives.
+
+void bulk_begin();
+void bulk_send();
+void bulk_receive();
+void print_bulk();
+
+#endif // COMMOTALKINO_SRC_MODE_BULK_H_
@@ -0,0 +1,57 @@
+#include "mode_channels.h"
+#include "main.h"
+#include "mode_rate.h"
+
+ChannelHop channel_hop;
+
+// The hop sequence comes from the address of Pong, the same for both ends.
+void set_pair_config() {
+  const unsigned char pair = read_id_straps() >> 1;
+  LoraConfig *pong = my_config.do_i_ping ? &her_config : &my_config;
+  my_config.address_low += pair;
+  her_config.address_low += pair;
+  ChannelHop_Init(&channel_hop, my_config.do_i_ping, pong->address_high,
+                  pong->address_low, CHANNEL_BASE, CHANNELS,
+                  CHANNEL_HOP_AFTER, CHANNEL_LOST_AFTER);
+  my_config.channel = ChannelHop_Channel(&channel_hop, 0);
+  her_config.channel = my_config.channel;
+}
+
+// Her ball carries the hop command of Ping. Pairs on the same channel that
+// time out together would retry together, the jitter keeps them apart.
+void channel_handle(const Result result, const unsigned char command) {
+  if (Success == result) {
+    ChannelHop_Handle(&channel_hop, command);
+    ChannelHop_Success(&channel_hop);
+  } else if (Timeout == result) {
+    ChannelHop_Timeout(&channel_hop);
+    delay(random(CHANNEL_JITTER_MS));
+  }
+}
+
+unsigned char channel_command() { return ChannelHop_Command(&channel_hop); }
+
+// Like the air data rate, with C2 and at the rate in use. Both ends of the
+// pair are always on the same channel, so the address of her has it too.
+void switch_channel() {
+  const unsigned char channel = ChannelHop_Take(&channel_hop);
+  if (CHANNEL_HOP_KEEP == channel)
+    return;
+  my_config.channel = channel;
+  her_config.channel = channel;
+  if (!dry_run_driver(ADAPTIVE_RATE ? link_rate.rate : BOOT_RATE))
+    return;
+  dry_block[0] = 0xC2;
+  write_module_config(dry_block);
+}
+
+void print_channel() {
+  Serial.print(F("Channel: "));
+  Serial.print(my_config.channel);
+  Serial.print(F(" Home: "));
+  Serial.print(ChannelHop_Channel(&channel_hop, 0));
+  Serial.print(F(" Hops: "));
+  Serial.print(channel_hop.hops);
+  Serial.print(F(" Searches: "));
+  Serial.println(channel_hop.searches);
+}
@@ -0,0 +1,16 @@
+#ifndef COMMOTALKINO_SRC_MODE_CHANNELS_H_
+#define COMMOTALKINO_SRC_MODE_CHANNELS_H_
+
+#include "main.h"
+
+// CHANNELS, see config.h: the pair takes its addresses and home channel from
+// the id straps, Ping sends the hop command in every ball and both ends
+// switch the module to the channel it names once the ball is through.
+
+void set_pair_config();
+void channel_handle(Result result, unsigned char command);
+unsigned char channel_command();
+void switch_channel();
+void print_channel();
+
+#endif // COMMOTALKINO_SRC_MODE_CHANNELS_H_
@@ -0,0 +1,57 @@
+#include "mode_fec.h"
+#include "main.h"
+
+static void fec_deliver(const unsigned char *payload);
+
+FecSender fec_sender;
+FecReceiver fec_receiver;
+
+void fec_begin() {
+  FecSender_Init(&fec_sender, FEC_DATA, FEC_PARITY);
+  FecReceiver_Init(&fec_receiver, FEC_DATA, FEC_PARITY);
+}
+
+// One frame per call, the parity frames of a group right after its data.
+void fec_send() {
+  FecFrame frame;
+  unsigned char payload[FEC_PAYLOAD_LENGTH];
+  if (!FecSender_Parity(&fec_sender, &frame)) {
+    const uint32_t count = ++hit;
+    memset(payload, 0, sizeof(payload));
+    memcpy(payload, &count, sizeof(count));
+    FecSender_Data(&fec_sender, payload, &frame);
+    last_hit = hit;
+    set_new_record(hit);
+  }
+  OneToOne((unsigned char *)&frame);
+}
+
+void fec_receive() {
+  FecFrame frame;
+  receiving_timeout = FEC_CLOSE_AFTER;
+  if (Success == Pull((unsigned char *)&frame))
+    FecReceiver_Push(&fec_receiver, &frame, fec_deliver);
+  else
+    FecReceiver_Close(&fec_receiver, fec_deliver);
+}
+
+// Counts the counter only, like a batched window frame does.
+void fec_deliver(const unsigned char *payload) {
+  payload_bytes += sizeof(uint32_t);
+  deliver_counter(payload);
+}
+
+void print_fec() {
+  Serial.print(F("FEC data frames: "));
+  Serial.print(fec_sender.data_frames);
+  Serial.print(F(" Parity frames: "));
+  Serial.print(fec_sender.parity_frames);
+  Serial.print(F(" Groups: "));
+  Serial.print(fec_receiver.groups);
+  Serial.print(F(" Rebuilt: "));
+  Serial.print(fec_receiver.rebuilt);
+  Serial.print(F(" Lost: "));
+  Serial.print(fec_receiver.lost);
+  Serial.print(F(" FEC RAM bytes: "));
+  Serial.println(sizeof(fec_sender) + sizeof(fec_receiver));
+}
@@ -0,0 +1,13 @@
+#ifndef COMMOTALKINO_SRC_MODE_FEC_H_
+#define COMMOTALKINO_SRC_MODE_FEC_H_
+
+// FEC, see config.h: the loop calls fec_send() on Ping, which streams
+// counters in groups of data and parity frames, and fec_receive() on Pong,
+// which rebuilds what it can of a group and never answers.
+
+void fec_begin();
+void fec_send();
+void fec_receive();
+void print_fec();
+
+#endif // COMMOTALKINO_SRC_MODE_FEC_H_
@@ -0,0 +1,90 @@
+#include "mode_handshake.h"
+#include "main.h"
+#include "mode_lowpower.h"
+
+static void await_her_ready();
+
+unsigned long last_announce;
+unsigned long announce_gap;
+short her_ready;
+unsigned long ready_wait_count;
+unsigned long ready_wait_sum;
+unsigned long ready_wait_timeouts;
+unsigned char held_frame[MESSAGE_LENGTH];
+short held_frame_ready;
+unsigned long held_frames;
+unsigned long held_frames_dropped;
+
+// Called from the listen loop: the token goes right away on a new pull, then
+// after READY_TIMEOUT, when she has given up waiting for it and sent anyway,
+// and ever further apart, unless a frame is arriving, so that the token
+// never steps on the incoming ball.
+void announce_ready() {
+  unsigned char token[MESSAGE_LENGTH];
+  if (millis() - last_announce < announce_gap || frame_reader.length ||
+      SerialRx_Available())
+    return;
+  const Destination target = {her_config.address_high,
+                              her_config.address_low, her_config.channel};
+  Handshake_BuildReady(token, sizeof(token), my_config.id);
+  LOG_DEBUG(LOG_ANNOUNCING_READY);
+  mark_first_frame();
+  Driver_Send(&lora_driver, &target, token, sizeof(token));
+  last_announce = millis();
+  if (!announce_gap)
+    announce_gap = READY_TIMEOUT;
+  else if (announce_gap < READY_BACKOFF_MAX)
+    announce_gap *= 2;
+}
+
+// A frame other than her token that arrives meanwhile is held for the next
+// Listen. There is room for one, a second one is counted and dropped.
+void await_her_ready() {
+  unsigned char frame[MESSAGE_LENGTH];
+  const unsigned long start = millis();
+  TurnOn();
+  while (!her_ready && millis() - start < READY_TIMEOUT) {
+    Console_Drain();
+    if (!listen_framed(frame, sizeof(frame)))
+      continue;
+    if (held_frame_ready) {
+      ++held_frames_dropped;
+      continue;
+    }
+    memcpy(held_frame, frame, sizeof(held_frame));
+    held_frame_ready = 1;
+    ++held_frames;
+  }
+  if (!her_ready)
+    ++ready_wait_timeouts;
+  ++ready_wait_count;
+  ready_wait_sum += millis() - start;
+  her_ready = 0;
+}
+
+int take_held_frame(unsigned char *content, const unsigned long size) {
+  if (!held_frame_ready)
+    return listen_framed(content, size);
+  memcpy(content, held_frame, size < sizeof(held_frame) ? size
+                                                         : sizeof(held_frame));
+  held_frame_ready = 0;
+  return (int)size;
+}
+
+void let_her_prepare(const unsigned long fallback_delay) {
+  if (HANDSHAKE)
+    await_her_ready();
+  else
+    nap(fallback_delay);
+}
+
+void print_handshake() {
+  Serial.print(F("Ready wait ms avg: "));
+  Serial.print(ready_wait_count ? ready_wait_sum / ready_wait_count : 0);
+  Serial.print(F(" Ready timeouts: "));
+  Serial.print(ready_wait_timeouts);
+  Serial.print(F(" Frames held: "));
+  Serial.print(held_frames);
+  Serial.print(F(" dropped: "));
+  Serial.println(held_frames_dropped);
+}
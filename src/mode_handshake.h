@@ -0,0 +1,17 @@
+#ifndef COMMOTALKINO_SRC_MODE_HANDSHAKE_H_
+#define COMMOTALKINO_SRC_MODE_HANDSHAKE_H_
+
+// HANDSHAKE, see config.h: Listen calls announce_ready() while it waits and
+// takes the frame held meanwhile with take_held_frame(). The ping pong waits
+// for her token in let_her_prepare(), or the fixed delay without the
+// handshake. Pull starts every wait over, listen_framed() notes her token.
+
+extern short her_ready;
+extern unsigned long announce_gap;
+
+void announce_ready();
+int take_held_frame(unsigned char *content, unsigned long size);
+void let_her_prepare(unsigned long fallback_delay);
+void print_handshake();
+
+#endif // COMMOTALKINO_SRC_MODE_HANDSHAKE_H_
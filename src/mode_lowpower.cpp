@@ -0,0 +1,60 @@
+#include "mode_lowpower.h"
+#include "main.h"
+
+static unsigned long power_down(unsigned long max_ms);
+
+EnergyMeter energy;
+
+// Nothing is on the way: power down for a watchdog period at most, so that
+// Pull_Invoke still checks its timeout in between.
+void listen_sleep() {
+  if (2 != ModePins_Mode() || SerialRx_Available() || frame_reader.length ||
+      LOW == digitalRead(PIN_AUX))
+    return;
+  power_down(POWER_WDT_MS);
+}
+
+// A delay() that powers the MCU down for the whole watchdog periods in it.
+void nap(unsigned long ms) {
+  if (LOW_POWER && POWER_WDT_MS <= ms) {
+    const unsigned long slept = power_down(ms);
+    ms = slept < ms ? ms - slept : 0;
+  }
+  delay(ms);
+}
+
+// The UART stops in power-down, the console goes out first.
+unsigned long power_down(const unsigned long max_ms) {
+  Console_Flush();
+  Serial.flush();
+  const unsigned long start = millis();
+  Energy_Mcu(&energy, ENERGY_MCU_SLEEP, start);
+  Power_Sleep(max_ms);
+  Energy_Mcu(&energy, ENERGY_MCU_ACTIVE, millis());
+  return millis() - start;
+}
+
+// Estimate from the time in every state and the currents in energy.h.
+void print_energy() {
+  const PowerStats power = Power_Stats();
+  Energy_Charge(&energy, millis());
+  const double microamps = Energy_AverageMicroamps(&energy);
+  Serial.print(F("Energy uA avg: "));
+  Serial.print(microamps, 1);
+  Serial.print(F(" mAh/day: "));
+  Serial.print(microamps * 24 / 1000, 2);
+  Serial.print(F(" MCU asleep ms: "));
+  Serial.print(energy.mcu_ms[ENERGY_MCU_SLEEP]);
+  Serial.print(F(" AUX wakes: "));
+  Serial.print(power.aux_wakes);
+  Serial.print(F("/"));
+  Serial.println(power.sleeps);
+  Serial.print(F("Radio ms rx: "));
+  Serial.print(energy.radio_ms[ENERGY_RADIO_RX]);
+  Serial.print(F(" tx: "));
+  Serial.print(energy.radio_ms[ENERGY_RADIO_TX]);
+  Serial.print(F(" wor: "));
+  Serial.print(energy.radio_ms[ENERGY_RADIO_WOR]);
+  Serial.print(F(" sleep: "));
+  Serial.println(energy.radio_ms[ENERGY_RADIO_SLEEP]);
+}
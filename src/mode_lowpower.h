@@ -0,0 +1,17 @@
+#ifndef COMMOTALKINO_SRC_MODE_LOWPOWER_H_
+#define COMMOTALKINO_SRC_MODE_LOWPOWER_H_
+
+#include "energy.h"
+
+// LOW_POWER, see config.h: Listen calls listen_sleep() while nothing is on
+// the way and the waits of the ping pong go through nap(), both power the MCU
+// down until AUX or the watchdog wakes it. The energy meter runs in every
+// build, print_energy() has its estimate.
+
+extern EnergyMeter energy;
+
+void listen_sleep();
+void nap(unsigned long ms);
+void print_energy();
+
+#endif // COMMOTALKINO_SRC_MODE_LOWPOWER_H_
@@ -0,0 +1,62 @@
+#include "mode_rate.h"
+#include "main.h"
+
+LinkRate link_rate;
+
+void rate_begin() {
+  LinkRate_Init(&link_rate, my_config.do_i_ping, RATE_BASE, RATE_TOP,
+                RATE_UP_AFTER, RATE_FALLBACK_AFTER, millis());
+}
+
+// Her ball carries the rate command of the other end.
+void rate_handle(const Result result, const unsigned char command) {
+  if (Success == result) {
+    LinkRate_Handle(&link_rate, command);
+    LinkRate_Success(&link_rate, MESSAGE_BODY_LENGTH);
+  } else if (Timeout == result) {
+    LinkRate_Timeout(&link_rate);
+  }
+}
+
+unsigned char rate_command() { return LinkRate_Command(&link_rate); }
+
+// Writes the new configuration to the module with C2, not saved, so that
+// after a reset it is back at RATE_BASE like both ends of the link and the
+// configuration cached in EEPROM still holds. The round trip changes with the
+// rate, so the estimator starts over.
+void switch_air_rate() {
+  const unsigned char rate = LinkRate_Take(&link_rate, millis());
+  if (LINK_RATE_KEEP == rate || !dry_run_driver(rate))
+    return;
+  dry_block[0] = 0xC2;
+  write_module_config(dry_block);
+  Rtt_Init(&her_rtt, PULL_TIMEOUT, RTT_MARGIN, RTT_MAX_TIMEOUT);
+}
+
+// One line per air data rate the link has been on: balls, timeouts, time
+// spent and goodput at that rate.
+void print_air_rates(const unsigned long elapsed) {
+  unsigned char rate;
+  Serial.print(F("Rate switches: "));
+  Serial.print(link_rate.switches);
+  Serial.print(F(" Fallbacks: "));
+  Serial.print(link_rate.fallbacks);
+  Serial.print(F(" Ceiling bps: "));
+  Serial.println(LinkRate_Bps(link_rate.ceiling));
+  for (rate = 0; rate < LINK_RATE_LEVELS; rate++) {
+    const LinkRateStats *stats = &link_rate.stats[rate];
+    const unsigned long ms = LinkRate_Elapsed(&link_rate, rate, elapsed);
+    if (!ms)
+      continue;
+    Serial.print(F("Air rate "));
+    Serial.print(LinkRate_Bps(rate));
+    Serial.print(F(" hits "));
+    Serial.print(stats->hits);
+    Serial.print(F(" timeouts "));
+    Serial.print(stats->timeouts);
+    Serial.print(F(" ms "));
+    Serial.print(ms);
+    Serial.print(F(" goodput B/s "));
+    Serial.println(1000.0 * stats->bytes / ms, 2);
+  }
+}
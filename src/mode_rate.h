@@ -0,0 +1,18 @@
+#ifndef COMMOTALKINO_SRC_MODE_RATE_H_
+#define COMMOTALKINO_SRC_MODE_RATE_H_
+
+#include "main.h"
+
+// ADAPTIVE_RATE, see config.h: every ball carries the rate command of its
+// sender, rate_handle() takes hers and rate_command() gives mine, and both
+// ends switch the module to the rate agreed once the ball is through.
+
+extern LinkRate link_rate;
+
+void rate_begin();
+void rate_handle(Result result, unsigned char command);
+unsigned char rate_command();
+void switch_air_rate();
+void print_air_rates(unsigned long elapsed);
+
+#endif // COMMOTALKINO_SRC_MODE_RATE_H_
@@ -0,0 +1,153 @@
+#include "mode_relay.h"
+#include "main.h"
+
+static void relay_beacon();
+static void relay_forward(const RelayFrame *frame, unsigned char next_hop);
+static void relay_send(const RelayFrame *frame, unsigned char next_hop);
+
+Relay relay;
+short relay_only;
+short relay_beacon_due = 1;
+unsigned long relay_beacon_ms;
+unsigned char relay_hops;
+unsigned long relay_latency_count;
+unsigned long relay_latency_sum_us;
+unsigned long relay_latency_max_us;
+
+// Every node has the address of its number, so a neighbour's number is all it
+// takes to send to it. Ids stay end to end, links use RELAY_LINK_ID.
+void set_relay_config() {
+  const unsigned char number = read_id_straps();
+  pinMode(PIN_RELAY_ONLY, INPUT_PULLUP);
+  relay_only = !my_config.do_i_ping && LOW == digitalRead(PIN_RELAY_ONLY);
+  if (relay_only)
+    my_config.id = RELAY_ID_BASE + number;
+  my_config.address_high = PONG_ADDRESS_HIGH;
+  my_config.address_low = PONG_ADDRESS_LOW + number;
+  listen_id = RELAY_LINK_ID;
+  Relay_Init(&relay, my_config.id, number);
+}
+
+// Pull_Invoke for a relay: forwards the frames for others and returns the
+// first one for me, all within the same receiving_timeout. Only the payload
+// reaches the caller.
+Result relay_pull(const unsigned char *address, unsigned char *port,
+                  unsigned char *id, unsigned char *body) {
+  RelayFrame frame;
+  unsigned char next_hop;
+  const unsigned long timeout = receiving_timeout;
+  const unsigned long start = millis();
+  Result result = Timeout;
+  while (millis() - start < timeout) {
+    receiving_timeout = timeout - (millis() - start);
+    result = Pull_Invoke(address, port, id, body);
+    if (Success != result)
+      break;
+    Relay_Decode(body, &frame);
+    const unsigned char action =
+        Relay_Handle(&relay, &frame, &next_hop, millis());
+    if (RELAY_DELIVER == action && RELAY_DATA == frame.kind) {
+      memset(body, 0, MESSAGE_BODY_LENGTH);
+      memcpy(body, frame.payload, RELAY_PAYLOAD_LENGTH);
+      relay_hops = frame.hops + 1;
+      break;
+    }
+    if (RELAY_FORWARD == action)
+      relay_forward(&frame, next_hop);
+    result = Timeout;
+  }
+  receiving_timeout = timeout;
+  return result;
+}
+
+// The first RELAY_PAYLOAD_LENGTH bytes of the body travel to her.
+void relay_publish(const unsigned char *body) {
+  RelayFrame frame;
+  if (my_config.do_i_ping &&
+      (relay_beacon_due || millis() - relay_beacon_ms >= RELAY_BEACON_INTERVAL))
+    relay_beacon();
+  const unsigned char next_hop = Relay_Originate(
+      &relay, &frame, RELAY_DATA, her_config.id, body, millis());
+  relay_send(&frame, next_hop);
+}
+
+void relay_beacon() {
+  RelayFrame frame;
+  Relay_Originate(&relay, &frame, RELAY_BEACON, RELAY_EVERYONE, 0, millis());
+  relay_send(&frame, RELAY_NEIGHBOURS);
+  relay_beacon_due = 0;
+  relay_beacon_ms = millis();
+  delay(RELAY_FLOOD_MS);
+}
+
+// The neighbours of a node that floods got the frame at the same time, the
+// jitter keeps them from all sending it on at once. The latency is from the
+// last byte of the frame in to the end of the frame out.
+void relay_forward(const RelayFrame *frame, const unsigned char next_hop) {
+  if (RELAY_NEIGHBOURS == next_hop)
+    delay(random(RELAY_JITTER_MS));
+  LOG_DEBUG_BYTES(LOG_RELAY_FORWARD, frame, sizeof(*frame));
+  relay_send(frame, next_hop);
+  const unsigned long latency = micros() - SerialRx_LastByteUs();
+  ++relay_latency_count;
+  relay_latency_sum_us += latency;
+  if (relay_latency_max_us < latency)
+    relay_latency_max_us = latency;
+}
+
+void relay_send(const RelayFrame *frame, const unsigned char next_hop) {
+  unsigned char body[MESSAGE_BODY_LENGTH];
+  unsigned char address[3] = {BROADCAST_ADDRESS_HIGH, BROADCAST_ADDRESS_LOW,
+                              LORA_CHANNEL};
+  if (RELAY_NEIGHBOURS != next_hop) {
+    address[0] = PONG_ADDRESS_HIGH;
+    address[1] = PONG_ADDRESS_LOW + next_hop;
+  }
+  Relay_Encode(frame, body);
+  LOG_DEBUG_BYTES(LOG_PUBLISH_ADDRESS, address, sizeof(address));
+  Publish_Invoke(address, COMMON_PORT, RELAY_LINK_ID, body);
+}
+
+// A node that only forwards listens all the time, nothing is for it.
+void relay_serve() {
+  unsigned char body[MESSAGE_BODY_LENGTH];
+  receiving_timeout = PULL_TIMEOUT;
+  Pull(body);
+}
+
+void print_relay() {
+  unsigned char i;
+  Serial.print(F("Relay id: "));
+  Serial.print(relay.id);
+  Serial.print(F(" Number: "));
+  Serial.print(relay.number);
+  Serial.print(F(" Forwarded: "));
+  Serial.print(relay.forwarded);
+  Serial.print(F(" Flooded: "));
+  Serial.print(relay.flooded);
+  Serial.print(F(" Duplicates: "));
+  Serial.print(relay.duplicates);
+  Serial.print(F(" Hop limited: "));
+  Serial.println(relay.hop_limited);
+  Serial.print(F("Forward latency us avg: "));
+  Serial.print(relay_latency_count ? relay_latency_sum_us / relay_latency_count
+                                   : 0);
+  Serial.print(F(" max: "));
+  Serial.print(relay_latency_max_us);
+  Serial.print(F(" Relay RAM bytes: "));
+  Serial.println(sizeof(relay));
+  for (i = 0; i < relay.routes_used; i++) {
+    Serial.print(F("Route to "));
+    Serial.print(relay.routes[i].destination);
+    Serial.print(F(" via "));
+    Serial.print(relay.routes[i].next_hop);
+    Serial.print(F(" hops "));
+    Serial.println(relay.routes[i].hops);
+  }
+  if (relay_only || !relay_hops)
+    return;
+  Serial.print(F("Hops to her: "));
+  Serial.print(relay_hops);
+  Serial.print(F(" RTT ms per hop: "));
+  Serial.println(Rtt_Smoothed(&her_rtt) / (2 * relay_hops));
+}
@@ -0,0 +1,22 @@
+#ifndef COMMOTALKINO_SRC_MODE_RELAY_H_
+#define COMMOTALKINO_SRC_MODE_RELAY_H_
+
+#include "main.h"
+
+// RELAY, see config.h: Pull and OneToOne go through relay_pull() and
+// relay_publish(), which forward the frames for other nodes on the way. A
+// node with PIN_RELAY_ONLY closed only forwards, the loop calls
+// relay_serve() on it. A pull that times out has the sink flood a beacon
+// before its next frame.
+
+extern short relay_only;
+extern short relay_beacon_due;
+
+void set_relay_config();
+Result relay_pull(const unsigned char *address, unsigned char *port,
+                  unsigned char *id, unsigned char *body);
+void relay_publish(const unsigned char *body);
+void relay_serve();
+void print_relay();
+
+#endif // COMMOTALKINO_SRC_MODE_RELAY_H_
@@ -0,0 +1,223 @@
+#include "mode_star.h"
+#include "main.h"
+
+static void star_deliver(const unsigned char *body);
+static void star_send(unsigned char kind);
+static void star_produce();
+static void print_tx_queue();
+
+TdmaCoordinator coordinator;
+TdmaLeaf leaf;
+TxQueue tx_queue;
+uint32_t star_sequence;
+uint32_t leaf_sequences[TDMA_MAX_SLOTS];
+unsigned long star_lost;
+#if STAR_STAY_FRAMES
+unsigned long star_stayed;
+#endif
+unsigned long star_sample_ms;
+unsigned long star_readings;
+unsigned long star_alarms;
+unsigned long star_messages[3];
+
+// The coordinator talks to every leaf at once. A leaf takes its number from
+// the id straps, closed to ground for 1, and listens only to beacons.
+void set_star_config() {
+  if (my_config.do_i_ping) {
+    her_config.id = STAR_BEACON_ID;
+    return;
+  }
+  const unsigned char number = read_id_straps();
+  my_config.id = STAR_LEAF_ID_BASE + number;
+  my_config.address_low = PONG_ADDRESS_LOW + number;
+  listen_id = STAR_BEACON_ID;
+}
+
+void star_begin() {
+  TdmaCoordinator_Init(&coordinator, STAR_SLOT_MS, STAR_EXPIRE_AFTER);
+  TdmaLeaf_Init(&leaf, my_config.id);
+  TxQueue_Init(&tx_queue);
+}
+
+// One beacon, then every frame the leaves send until the superframe is over.
+void star_coordinate() {
+  unsigned char body[MESSAGE_BODY_LENGTH];
+  TdmaBeacon beacon;
+  TdmaCoordinator_Beacon(&coordinator, millis(), &beacon);
+  Tdma_EncodeBeacon(&beacon, body);
+  Broadcast(body);
+  const unsigned long start = millis();
+  const unsigned long length = Tdma_SuperframeMs(beacon.slots, beacon.slot_ms);
+  while (millis() - start < length) {
+    receiving_timeout = length - (millis() - start);
+    if (Success == Pull(body))
+      star_deliver(body);
+  }
+}
+
+// A leaf frame: kind, leaf id and, for data, its sequence number, so that the
+// frames lost on the way show up as gaps, then the message the leaf queued:
+// its kind and a 2 byte value.
+void star_deliver(const unsigned char *body) {
+  uint32_t sequence;
+  const unsigned char number = body[1] - STAR_LEAF_ID_BASE;
+  TdmaCoordinator_Receive(&coordinator, body[0], body[1]);
+  if (TDMA_DATA != body[0] || TDMA_MAX_SLOTS <= number)
+    return;
+  memcpy(&sequence, body + 2, sizeof(sequence));
+  payload_bytes += sizeof(sequence);
+  if (leaf_sequences[number] && leaf_sequences[number] < sequence)
+    star_lost += sequence - leaf_sequences[number] - 1;
+  leaf_sequences[number] = sequence;
+  if (body[6] < sizeof(star_messages) / sizeof(star_messages[0]))
+    star_messages[body[6]]++;
+}
+
+// At most one frame per superframe, then the next beacon. It is expected one
+// superframe after the last one, a leaf out of sync waits up to STAR_SCAN_MS.
+void star_leaf() {
+  unsigned char body[MESSAGE_BODY_LENGTH];
+  TdmaBeacon beacon;
+  unsigned long at;
+  const unsigned char kind =
+      TdmaLeaf_Plan(&leaf, (unsigned char)random(256), &at);
+  if (kind) {
+    if (!STAR_SLOTTED && TDMA_DATA == kind)
+      at = leaf.anchor_ms +
+           random(Tdma_SuperframeMs(leaf.slots, leaf.slot_ms) - leaf.slot_ms);
+    if ((long)(at - millis()) > 0)
+      delay(at - millis());
+    star_send(kind);
+  }
+  receiving_timeout = STAR_SCAN_MS;
+  if (leaf.synced) {
+    const unsigned long due = TdmaLeaf_NextBeacon(&leaf) + leaf.slot_ms;
+    receiving_timeout = (long)(due - millis()) > 0 ? due - millis() : 1;
+  }
+  if (Success == Pull(body) && Tdma_DecodeBeacon(body, &beacon))
+    TdmaLeaf_Beacon(&leaf, &beacon, millis());
+  else
+    TdmaLeaf_Missed(&leaf);
+}
+
+void star_send(const unsigned char kind) {
+  unsigned char body[MESSAGE_BODY_LENGTH];
+  memset(body, 0, sizeof(body));
+  body[0] = kind;
+  body[1] = my_config.id;
+  if (TDMA_DATA == kind) {
+    TxMessage message;
+    ++star_sequence;
+    memcpy(body + 2, &star_sequence, sizeof(star_sequence));
+    star_produce();
+    if (TxQueue_Pop(&tx_queue, &message, millis()))
+      memcpy(body + 6, message.body, sizeof(message.body));
+#if STAR_STAY_FRAMES
+    if (STAR_STAY_FRAMES <= ++star_stayed) {
+      star_stayed = 0;
+      TdmaLeaf_Leave(&leaf);
+    }
+#endif
+  }
+  OneToOne(body);
+}
+
+// The leaf blocks between its frames, the readings it missed meanwhile are
+// taken when it gets back, each at its own time.
+void star_produce() {
+  unsigned char body[TX_QUEUE_BODY_LENGTH];
+  const unsigned long now = millis();
+  if (!star_sample_ms)
+    star_sample_ms = now;
+  while (STAR_SAMPLE_MS <= now - star_sample_ms) {
+    star_sample_ms += STAR_SAMPLE_MS;
+    ++star_readings;
+    body[0] = STAR_READING;
+    body[1] = (unsigned char)star_readings;
+    body[2] = (unsigned char)(star_readings >> 8);
+    TxQueue_Push(&tx_queue, TX_TELEMETRY,
+                 STAR_COALESCE ? STAR_READING : TX_NO_KEY, body,
+                 star_sample_ms);
+    if (star_readings % STAR_ALARM_EVERY)
+      continue;
+    ++star_alarms;
+    body[0] = STAR_ALARM;
+    TxQueue_Push(&tx_queue, TX_CONTROL, TX_NO_KEY, body, star_sample_ms);
+  }
+}
+
+void print_star() {
+  if (my_config.do_i_ping) {
+    const unsigned long delivered = received_count;
+    Serial.print(F("Star members: "));
+    Serial.print(TdmaCoordinator_Members(&coordinator));
+    Serial.print(F(" Slots: "));
+    Serial.print(coordinator.slots);
+    Serial.print(F(" Superframes: "));
+    Serial.print(coordinator.superframes);
+    Serial.print(F(" Joins: "));
+    Serial.print(coordinator.joins);
+    Serial.print(F(" Leaves: "));
+    Serial.print(coordinator.leaves);
+    Serial.print(F(" Expired: "));
+    Serial.println(coordinator.expirations);
+    Serial.print(F("Star readings: "));
+    Serial.print(star_messages[STAR_READING]);
+    Serial.print(F(" Alarms: "));
+    Serial.println(star_messages[STAR_ALARM]);
+    Serial.print(F("Star frames lost: "));
+    Serial.print(star_lost);
+    Serial.print(F(" Delivery: "));
+    Serial.println(delivered + star_lost
+                       ? (double)delivered / (delivered + star_lost)
+                       : 0.0,
+                   4);
+    return;
+  }
+  Serial.print(F("Leaf id: "));
+  Serial.print(leaf.id);
+  Serial.print(F(" Slot: "));
+  Serial.print(leaf.slot);
+  Serial.print(F(" Sent: "));
+  Serial.print(star_sequence);
+  Serial.print(F(" Beacons: "));
+  Serial.print(leaf.beacons);
+  Serial.print(F(" Missed: "));
+  Serial.print(leaf.missed);
+  Serial.print(F(" Joins: "));
+  Serial.println(leaf.joins);
+  Serial.print(F("Sync error ms avg: "));
+  Serial.print(leaf.sync_samples ? leaf.sync_error_sum_ms / leaf.sync_samples
+                                 : 0);
+  Serial.print(F(" max: "));
+  Serial.print(leaf.sync_error_max_ms);
+  Serial.print(F(" Network time ms: "));
+  Serial.println(TdmaLeaf_NetworkTime(&leaf, millis()));
+  print_tx_queue();
+}
+
+// The wait is from the time of a value to its frame, per class.
+void print_tx_queue() {
+  Serial.print(F("Tx queue readings: "));
+  Serial.print(star_readings);
+  Serial.print(F(" Alarms: "));
+  Serial.print(star_alarms);
+  Serial.print(F(" Depth: "));
+  Serial.print(tx_queue.count);
+  Serial.print(F(" High water: "));
+  Serial.print(tx_queue.high_water);
+  Serial.print(F("/"));
+  Serial.println(TX_QUEUE_SIZE);
+  Serial.print(F("Tx queue sent: "));
+  Serial.print(tx_queue.sent);
+  Serial.print(F(" Coalesced: "));
+  Serial.print(tx_queue.coalesced);
+  Serial.print(F(" Dropped: "));
+  Serial.print(tx_queue.dropped);
+  Serial.print(F(" Wait ms avg: "));
+  Serial.print(tx_queue.sent ? tx_queue.wait_sum_ms / tx_queue.sent : 0);
+  Serial.print(F(" max control: "));
+  Serial.print(tx_queue.wait_max_ms[TX_CONTROL]);
+  Serial.print(F(" telemetry: "));
+  Serial.println(tx_queue.wait_max_ms[TX_TELEMETRY]);
+}
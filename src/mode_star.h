@@ -0,0 +1,15 @@
+#ifndef COMMOTALKINO_SRC_MODE_STAR_H_
+#define COMMOTALKINO_SRC_MODE_STAR_H_
+
+// STAR, see config.h: the coordinator beacons every superframe and collects
+// the frames of the leaves, a leaf sends the most urgent message of its
+// transmit queue in its slot. The loop calls star_coordinate() on the node
+// with PING_PIN HIGH and star_leaf() on the others.
+
+void set_star_config();
+void star_begin();
+void star_coordinate();
+void star_leaf();
+void print_star();
+
+#endif // COMMOTALKINO_SRC_MODE_STAR_H_
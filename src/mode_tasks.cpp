@@ -0,0 +1,173 @@
+#include "mode_tasks.h"
+#include "main.h"
+
+static void ping_pong_task(Task *task);
+static void sample_task(Task *task);
+static void blink_task(Task *task);
+static void console_task(Task *task);
+static void task_receive();
+static int pull_expired();
+static int radio_idle();
+static int poll_frame();
+
+Scheduler scheduler;
+unsigned char task_frame[MESSAGE_LENGTH];
+short task_frame_ready;
+unsigned long task_pull_start;
+unsigned long task_pull_timeout;
+unsigned long sample_count;
+unsigned long sample_sum;
+
+void start_tasks() {
+  Scheduler_Init(&scheduler, micros);
+  Scheduler_Add(&scheduler, ping_pong_task, "ping pong");
+  Scheduler_Add(&scheduler, sample_task, "sample");
+  Scheduler_Add(&scheduler, blink_task, "blink");
+  Scheduler_Add(&scheduler, console_task, "console");
+}
+
+void run_tasks() { Scheduler_RunOnce(&scheduler); }
+
+// assert_ping_pong() as a protothread: every delay and every wait on the
+// radio gives the CPU to the other tasks. After a hit error the ping pong
+// starts over from the top of the loop instead of calling itself.
+void ping_pong_task(Task *task) {
+  TASK_BEGIN(task);
+  TurnOn();
+  for (;;) {
+    if (HIT_START == hit && my_config.do_i_ping) {
+      Console_PrintFlash(F("I am Ping"));
+      TASK_SLEEP(task, PING_PONG_INTERVAL);
+      ++hit;
+    } else {
+      task_pull_start = millis();
+      task_pull_timeout =
+          ADAPTIVE_TIMEOUT ? Rtt_Timeout(&her_rtt) : PULL_TIMEOUT;
+      TASK_WAIT_UNTIL(task, poll_frame() || pull_expired());
+      task_receive();
+      set_new_record(hit);
+      print_hit_log();
+      if (0 != hit && last_hit == hit) {
+        char error_log[40];
+        sprintf_P(error_log, PSTR("Error at Hit: %lu"), hit);
+        Console_Print(error_log);
+        Console_PrintFlash(
+            F("Hit Error X-X-X-X-X--------=hit=--------X-X-X-X-X-X-X"));
+        hit = HIT_START;
+        TASK_SLEEP(task, PING_PONG_INTERVAL);
+        continue;
+      }
+      if (0 != hit)
+        ++hit;
+      TASK_SLEEP(task, LET_HER_PREPARE_DELAY);
+    }
+    last_hit = hit;
+    TASK_WAIT_UNTIL(task, radio_idle());
+    i_publish();
+  }
+  TASK_END(task);
+}
+
+// The frame is in, or the wait is over: Pull_Invoke takes the frame on its
+// first listen, or times out without listening at all.
+void task_receive() {
+  receiving_timeout = task_frame_ready ? 1 : 0;
+  const Result result = pull_ball();
+  if (ball_frame)
+    handle_ball(result, (const Ball *)ball_frame->body);
+  if (Success == result)
+    Scheduler_Signal(&scheduler, TASK_EVENT_BALL);
+}
+
+int pull_expired() { return task_pull_timeout <= millis() - task_pull_start; }
+
+int radio_idle() { return HIGH == DigitalRead(PIN_AUX); }
+
+// Takes a whole frame off the UART without waiting, for the next Listen.
+int poll_frame() {
+  if (!task_frame_ready)
+    task_frame_ready = 0 < listen_framed(task_frame, sizeof(task_frame));
+  return task_frame_ready;
+}
+
+int take_frame(unsigned char *content, const unsigned long size) {
+  if (!poll_frame())
+    return 0;
+  memcpy(content, task_frame, size < sizeof(task_frame) ? size
+                                                         : sizeof(task_frame));
+  task_frame_ready = 0;
+  return (int)size;
+}
+
+// Driver_Send waits on AUX for the whole air time. The task only publishes
+// once the module is idle, so the frame just goes into the UART: address and
+// channel, as in fixed transmission, then the message.
+unsigned long send_frame(const Destination *target,
+                         const unsigned char *content,
+                         const unsigned long size) {
+  unsigned char frame[3 + MESSAGE_LENGTH];
+  const unsigned long length = size < MESSAGE_LENGTH ? size : MESSAGE_LENGTH;
+  frame[0] = target->address_high;
+  frame[1] = target->address_low;
+  frame[2] = target->channel;
+  memcpy(frame + 3, content, length);
+  const unsigned long written = WriteToSerial(frame, length + 3);
+  return 3 <= written ? written - 3 : 0;
+}
+
+void sample_task(Task *task) {
+  TASK_BEGIN(task);
+  for (;;) {
+    sample_sum += analogRead(PIN_SENSOR);
+    sample_count++;
+    TASK_SLEEP(task, SAMPLE_INTERVAL);
+  }
+  TASK_END(task);
+}
+
+void blink_task(Task *task) {
+  TASK_BEGIN(task);
+  for (;;) {
+    TASK_WAIT_EVENT(task, TASK_EVENT_BALL);
+    digitalWrite(LISTEN_LED_PIN, HIGH);
+    TASK_SLEEP(task, BLINK_MS);
+    digitalWrite(LISTEN_LED_PIN, LOW);
+  }
+  TASK_END(task);
+}
+
+void console_task(Task *task) {
+  TASK_BEGIN(task);
+  for (;;) {
+    TASK_WAIT_UNTIL(task,
+                    Console_Pending() && 0 < Serial.availableForWrite());
+    Console_Drain();
+  }
+  TASK_END(task);
+}
+
+// The longest run of a task is the latency it adds to every other one.
+void print_tasks() {
+  unsigned char i;
+  Serial.print(F("CPU idle %: "));
+  Serial.print(100 * Scheduler_IdleShare(&scheduler, micros()), 1);
+  Serial.print(F(" Passes: "));
+  Serial.print(scheduler.passes);
+  Serial.print(F(" Worst latency us: "));
+  Serial.println(Scheduler_MaxLateUs(&scheduler));
+  for (i = 0; i < scheduler.count; i++) {
+    const Task *task = &scheduler.tasks[i];
+    Serial.print(F("Task "));
+    Serial.print(task->name);
+    Serial.print(F(" runs "));
+    Serial.print(task->runs);
+    Serial.print(F(" max run us "));
+    Serial.print(task->max_run_us);
+    Serial.print(F(" max late us "));
+    Serial.println(task->max_late_us);
+  }
+  Serial.print(F("Samples: "));
+  Serial.print(sample_count);
+  Serial.print(F(" avg: "));
+  Serial.println(sample_count ? sample_sum / sample_count : 0);
+}
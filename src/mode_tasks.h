@@ -0,0 +1,18 @@
+#ifndef COMMOTALKINO_SRC_MODE_TASKS_H_
+#define COMMOTALKINO_SRC_MODE_TASKS_H_
+
+#include "main.h"
+
+// TASKS, see config.h: the loop calls run_tasks(), one pass of the
+// cooperative scheduler over the ping pong, sampling, blink and console
+// tasks. Listen takes the frames the ping pong task polled with take_frame()
+// and Transmit hands the frames to the idle module with send_frame().
+
+void start_tasks();
+void run_tasks();
+int take_frame(unsigned char *content, unsigned long size);
+unsigned long send_frame(const Destination *target,
+                         const unsigned char *content, unsigned long size);
+void print_tasks();
+
+#endif // COMMOTALKINO_SRC_MODE_TASKS_H_
@@ -0,0 +1,202 @@
+#include "mode_window.h"
+#include "main.h"
+
+CODEC_DEFINE(Counter, COUNTER_SCHEMA)
+
+static void deliver_payload(const unsigned char *payload);
+static void produce_records();
+static void queue_batch(const unsigned char *body);
+static void add_packed_counter(uint32_t count);
+static void deliver_packed(const BatchRecord *record);
+
+WindowSender window_sender;
+WindowReceiver window_receiver;
+Batch batch;
+unsigned long records_received;
+unsigned long batch_drops;
+CounterRecord counter_sent;
+CounterRecord counter_got;
+unsigned long packed_records;
+unsigned long packed_bytes;
+unsigned long packed_received;
+unsigned long packed_errors;
+unsigned long encode_us;
+unsigned long decode_us;
+unsigned char her_status;
+short status_due;
+
+void window_begin() {
+  WindowSender_Init(&window_sender, WINDOW_SIZE);
+  WindowReceiver_Init(&window_receiver, WINDOW_SIZE);
+  if (BATCHED)
+    Batch_Init(&batch, WINDOW_PAYLOAD_LENGTH, BATCH_DEADLINE, queue_batch);
+}
+
+// Keeps the window full of counters, sends whatever is due and waits for the
+// ACK the last frame of the burst asks for.
+void window_send() {
+  WindowFrame frame;
+  unsigned char payload[WINDOW_PAYLOAD_LENGTH];
+  memset(payload, 0, sizeof(payload));
+  while (WindowSender_InFlight(&window_sender) < window_sender.size) {
+    if (BATCHED) {
+      produce_records();
+      continue;
+    }
+    const uint32_t count = ++hit;
+    memcpy(payload, &count, sizeof(count));
+    WindowSender_Queue(&window_sender, payload);
+  }
+  if (BATCHED)
+    Batch_Poll(&batch, millis());
+  const unsigned long retransmissions = window_sender.retransmissions;
+  const unsigned long expirations = window_sender.expirations;
+  const unsigned long burst_start = millis();
+  while (WindowSender_Next(&window_sender, &frame, millis(), window_timeout()))
+    OneToOne((unsigned char *)&frame);
+  if (ADAPTIVE_TIMEOUT && expirations != window_sender.expirations)
+    Rtt_Backoff(&her_rtt);
+  receiving_timeout = window_timeout();
+  if (Success != Pull((unsigned char *)&frame))
+    return;
+  const unsigned char acked = WindowSender_OnAck(&window_sender, &frame);
+  // Karn: a burst with retransmissions in it gives an ambiguous sample.
+  if (ADAPTIVE_TIMEOUT && acked &&
+      retransmissions == window_sender.retransmissions)
+    Rtt_Sample(&her_rtt, millis() - burst_start);
+  payload_bytes += acked * WINDOW_PAYLOAD_LENGTH;
+  last_hit = hit - WindowSender_InFlight(&window_sender);
+  set_new_record(last_hit);
+}
+
+// Acknowledges when the sender asks for it, or after WINDOW_ACK_DELAY of
+// silence in case the frame asking for it was lost.
+void window_receive() {
+  WindowFrame frame;
+  receiving_timeout = WINDOW_ACK_DELAY;
+  const Result result = Pull((unsigned char *)&frame);
+  if (Success == result &&
+      !WindowReceiver_Push(&window_receiver, &frame, deliver_payload))
+    return;
+  if (!window_receiver.ack_due)
+    return;
+  WindowReceiver_BuildAck(&window_receiver, &frame);
+  OneToOne((unsigned char *)&frame);
+}
+
+void deliver_payload(const unsigned char *payload) {
+  BatchIterator iterator;
+  BatchRecord record;
+  if (!BATCHED) {
+    payload_bytes += WINDOW_PAYLOAD_LENGTH;
+    deliver_counter(payload);
+    return;
+  }
+  BatchIterator_Init(&iterator, payload, WINDOW_PAYLOAD_LENGTH);
+  while (BatchIterator_Next(&iterator, &record)) {
+    ++records_received;
+    if (BATCH_PACKED == record.type) {
+      deliver_packed(&record);
+      continue;
+    }
+    payload_bytes += record.length;
+    if (BATCH_COUNTER == record.type)
+      deliver_counter(record.value);
+    else if (BATCH_STATUS == record.type)
+      her_status = record.value[0];
+  }
+}
+
+// One record per call, so that a call flushes one frame at most and the
+// window always has room for it. The status record goes along with the
+// counters and costs no frame of its own.
+void produce_records() {
+  if (status_due) {
+    const unsigned char status = (unsigned char)lora_driver.state;
+    Batch_Add(&batch, BATCH_STATUS, &status, sizeof(status), millis());
+    status_due = 0;
+    return;
+  }
+  const uint32_t count = ++hit;
+  if (PACKED)
+    add_packed_counter(count);
+  else
+    Batch_Add(&batch, BATCH_COUNTER, &count, sizeof(count), millis());
+  status_due = 0 == hit % STATUS_EVERY;
+}
+
+void add_packed_counter(const uint32_t count) {
+  unsigned char value[BATCH_MAX_VALUE];
+  CounterRecord record;
+  record.counter = count;
+  const unsigned long start = micros();
+  const unsigned char length =
+      Counter_Encode(&record, &counter_sent, value, sizeof(value));
+  encode_us += micros() - start;
+  Batch_Add(&batch, BATCH_PACKED, value, length, millis());
+  counter_sent = record;
+  packed_records++;
+  packed_bytes += length;
+}
+
+// Counts the counter, not the bytes it took, for a goodput to compare.
+void deliver_packed(const BatchRecord *record) {
+  CounterRecord decoded;
+  const unsigned long start = micros();
+  const unsigned char length =
+      Counter_Decode(record->value, record->length, &counter_got, &decoded);
+  decode_us += micros() - start;
+  packed_received++;
+  if (!length) {
+    ++packed_errors;
+    return;
+  }
+  counter_got = decoded;
+  payload_bytes += sizeof(decoded.counter);
+  deliver_counter((const unsigned char *)&decoded.counter);
+}
+
+void queue_batch(const unsigned char *body) {
+  if (!WindowSender_Queue(&window_sender, body))
+    ++batch_drops;
+}
+
+void print_window() {
+  Serial.print(F("Window sent: "));
+  Serial.print(window_sender.transmissions);
+  Serial.print(F(" Retransmitted: "));
+  Serial.print(window_sender.retransmissions);
+  Serial.print(F(" Acked: "));
+  Serial.print(window_sender.acked);
+  Serial.print(F(" Delivered: "));
+  Serial.print(window_receiver.delivered);
+  Serial.print(F(" Duplicates: "));
+  Serial.println(window_receiver.duplicates);
+  if (BATCHED) {
+    Serial.print(F("Records sent: "));
+    Serial.print(batch.records);
+    Serial.print(F(" in frames: "));
+    Serial.print(batch.frames);
+    Serial.print(F(" Records received: "));
+    Serial.print(records_received);
+    Serial.print(F(" Drops: "));
+    Serial.println(batch_drops);
+  }
+  if (BATCHED && PACKED) {
+    Serial.print(F("Packed counters: "));
+    Serial.print(packed_records);
+    Serial.print(F(" bytes avg: "));
+    Serial.print(packed_records ? (double)packed_bytes / packed_records : 0.0,
+                 2);
+    Serial.print(F(" of "));
+    Serial.print(sizeof(uint32_t));
+    Serial.print(F(" Errors: "));
+    Serial.print(packed_errors);
+    Serial.print(F(" Encode us avg: "));
+    Serial.print(packed_records ? (double)encode_us / packed_records : 0.0,
+                 1);
+    Serial.print(F(" Decode us avg: "));
+    Serial.println(packed_received ? (double)decode_us / packed_received : 0.0,
+                   1);
+  }
+}
@@ -0,0 +1,14 @@
+#ifndef COMMOTALKINO_SRC_MODE_WINDOW_H_
+#define COMMOTALKINO_SRC_MODE_WINDOW_H_
+
+// WINDOWED, see config.h: the loop calls window_send() on Ping, which keeps
+// a window of counters in flight, and window_receive() on Pong, which
+// acknowledges them. With BATCHED the frames carry batches of records, with
+// PACKED as well the counters go as varint deltas.
+
+void window_begin();
+void window_send();
+void window_receive();
+void print_window();
+
+#endif // COMMOTALKINO_SRC_MODE_WINDOW_H_
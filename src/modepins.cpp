@@ -0,0 +1,132 @@
+#include "modepins.h"
+
+#ifdef __AVR__
+#include <avr/sleep.h>
+#endif
+
+static unsigned char mode_pins[2];
+static unsigned char latched[2];
+static unsigned char normal[2];
+static unsigned char wanted[2];
+static unsigned char applied[2];
+static short settling;
+static unsigned long switched_us;
+static ModePinsStats stats;
+#ifdef __AVR__
+static volatile uint8_t *mode_port;
+static uint8_t mode_masks[2];
+#endif
+
+static void write_pins();
+
+void ModePins_Begin(const unsigned char m0_pin, const unsigned char m1_pin) {
+  mode_pins[0] = m0_pin;
+  mode_pins[1] = m1_pin;
+  latched[0] = latched[1] = LOW;
+  normal[0] = normal[1] = LOW;
+  // Unknown until the first write.
+  applied[0] = applied[1] = 0xFF;
+  settling = 0;
+#ifdef __AVR__
+  mode_port = 0;
+  if (digitalPinToPort(m0_pin) == digitalPinToPort(m1_pin)) {
+    mode_port = portOutputRegister(digitalPinToPort(m0_pin));
+    mode_masks[0] = digitalPinToBitMask(m0_pin);
+    mode_masks[1] = digitalPinToBitMask(m1_pin);
+  }
+#endif
+}
+
+// SoftwareSerial writes its TX pin on the same port from the main loop with
+// interrupts off, the read-modify-write must not interleave with it either.
+void write_pins() {
+#ifdef __AVR__
+  if (mode_port) {
+    const uint8_t set = (wanted[0] ? mode_masks[0] : 0) |
+                        (wanted[1] ? mode_masks[1] : 0);
+    noInterrupts();
+    *mode_port = (*mode_port & ~(mode_masks[0] | mode_masks[1])) | set;
+    interrupts();
+    return;
+  }
+#endif
+  digitalWrite(mode_pins[0], wanted[0]);
+  digitalWrite(mode_pins[1], wanted[1]);
+}
+
+void ModePins_Latch(const unsigned char pin, const unsigned char value) {
+  latched[mode_pins[1] == pin] = value ? HIGH : LOW;
+}
+
+void ModePins_MapNormal(const unsigned char m0, const unsigned char m1) {
+  normal[0] = m0 ? HIGH : LOW;
+  normal[1] = m1 ? HIGH : LOW;
+}
+
+// Returns 1 when the mode changed.
+int ModePins_Apply() {
+  const short is_normal = LOW == latched[0] && LOW == latched[1];
+  wanted[0] = is_normal ? normal[0] : latched[0];
+  wanted[1] = is_normal ? normal[1] : latched[1];
+  if (wanted[0] == applied[0] && wanted[1] == applied[1])
+    return 0;
+  write_pins();
+  applied[0] = wanted[0];
+  applied[1] = wanted[1];
+  switched_us = micros();
+  settling = 1;
+  return 1;
+}
+
+// Filters a read of AUX.
+int ModePins_Aux(const int value) {
+  if (!settling)
+    return value;
+  const unsigned long latency = micros() - switched_us;
+  if (latency < MODE_SETTLE_US)
+    return LOW;
+  if (HIGH != value)
+    return value;
+  settling = 0;
+  stats.switches++;
+  stats.latency_sum_us += latency;
+  if (stats.latency_max_us < latency)
+    stats.latency_max_us = latency;
+  return value;
+}
+
+#ifdef __AVR__
+
+// Interrupts are back on with the instruction before sleep_cpu(), so an edge
+// after the check still wakes it.
+void ModePins_AwaitAux(const unsigned char aux_pin) {
+  volatile uint8_t *pcmsk = digitalPinToPCMSK(aux_pin);
+  const uint8_t mask = _BV(digitalPinToPCMSKbit(aux_pin));
+  noInterrupts();
+  if (HIGH == digitalRead(aux_pin)) {
+    interrupts();
+    return;
+  }
+  *pcmsk |= mask;
+  *digitalPinToPCICR(aux_pin) |= _BV(digitalPinToPCICRbit(aux_pin));
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  sleep_enable();
+  interrupts();
+  sleep_cpu();
+  sleep_disable();
+  *pcmsk &= ~mask;
+}
+
+#else
+
+// The host waits in virtual time, the next read is the next poll.
+void ModePins_AwaitAux(unsigned char) {}
+
+#endif
+
+// E32 numbering, M0 + 2 * M1: 0 normal, 1 wake up, 2 power saving, 3 sleep.
+unsigned char ModePins_Mode() {
+  return (applied[0] & 1) | (applied[1] & 1) << 1;
+}
+
+ModePinsStats ModePins_Stats() { return stats; }
@@ -0,0 +1,47 @@
+#ifndef COMMOTALKINO_SRC_MODEPINS_H_
+#define COMMOTALKINO_SRC_MODEPINS_H_
+
+#include <Arduino.h>
+
+// M0 and M1 of the E32 written as one mode. The driver sets M0 and then M1,
+// M0 is only latched and goes out together with M1, in a single port write
+// when both pins share a port, so the module never passes through the mode in
+// between. A mode equal to the current one writes nothing and the module has
+// nothing to settle.
+//
+// The pins written for the driver's NORMAL mode can be mapped to another
+// mode, wake up to transmit to a module in power saving or power saving to
+// listen like one.
+//
+// After a switch AUX is read LOW for MODE_SETTLE_US, the module takes a
+// moment to pull it down, and the switch is over at the first HIGH after
+// that. The time from the write to that HIGH is the transition latency.
+//
+// While AUX is LOW, after a switch or for a frame on air, ModePins_AwaitAux
+// idles the CPU until the next interrupt instead of polling. AUX is unmasked
+// in the pin change mask of its port for the wait, like in power.h, so its
+// rising edge is one of them. The handler is SoftwareSerial's and ignores
+// anything but its RX pin. The edge only wakes the CPU, the caller reads AUX
+// again. Any other interrupt wakes the CPU as well, a received byte or the
+// millis() tick, so a wait is never longer than a millisecond.
+
+#ifndef MODE_SETTLE_US
+#define MODE_SETTLE_US 500
+#endif
+
+typedef struct ModePinsStats {
+  unsigned long switches;
+  unsigned long latency_sum_us;
+  unsigned long latency_max_us;
+} ModePinsStats;
+
+void ModePins_Begin(unsigned char m0_pin, unsigned char m1_pin);
+void ModePins_Latch(unsigned char pin, unsigned char value);
+void ModePins_MapNormal(unsigned char m0, unsigned char m1);
+int ModePins_Apply();
+unsigned char ModePins_Mode();
+int ModePins_Aux(int value);
+void ModePins_AwaitAux(unsigned char aux_pin);
+ModePinsStats ModePins_Stats();
+
+#endif // COMMOTALKINO_SRC_MODEPINS_H_
@@ -0,0 +1,80 @@
+#include "power.h"
+
+#ifdef __AVR__
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+
+extern volatile unsigned long timer0_millis;
+static volatile unsigned char wdt_fired;
+#endif
+
+static unsigned char aux;
+static PowerStats stats;
+
+static int sleep_period();
+
+void Power_Begin(const unsigned char aux_pin) { aux = aux_pin; }
+
+// Whole watchdog periods only, returns the time slept.
+unsigned long Power_Sleep(const unsigned long max_ms) {
+  unsigned long slept = 0;
+  while (slept + POWER_WDT_MS <= max_ms && HIGH == digitalRead(aux)) {
+    const int woken_by_aux = sleep_period();
+    const unsigned long period = woken_by_aux ? POWER_WDT_MS / 2 : POWER_WDT_MS;
+    slept += period;
+    stats.sleeps++;
+    stats.slept_ms += period;
+    if (woken_by_aux) {
+      stats.aux_wakes++;
+      break;
+    }
+  }
+  return slept;
+}
+
+PowerStats Power_Stats() { return stats; }
+
+#ifdef __AVR__
+
+ISR(WDT_vect) { wdt_fired = 1; }
+
+// Watchdog in interrupt mode, no reset, with the WDTO_120MS prescaler.
+int sleep_period() {
+  volatile uint8_t *pcmsk = digitalPinToPCMSK(aux);
+  const uint8_t mask = _BV(digitalPinToPCMSKbit(aux));
+  noInterrupts();
+  wdt_fired = 0;
+  MCUSR &= ~_BV(WDRF);
+  WDTCSR = _BV(WDCE) | _BV(WDE);
+  WDTCSR = _BV(WDIE) | _BV(WDP0) | _BV(WDP1);
+  *pcmsk |= mask;
+  *digitalPinToPCICR(aux) |= _BV(digitalPinToPCICRbit(aux));
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  sleep_enable();
+  interrupts();
+  sleep_cpu();
+  sleep_disable();
+  wdt_disable();
+  *pcmsk &= ~mask;
+  const int woken_by_aux = !wdt_fired;
+  noInterrupts();
+  timer0_millis += woken_by_aux ? POWER_WDT_MS / 2 : POWER_WDT_MS;
+  interrupts();
+  return woken_by_aux;
+}
+
+#else
+
+// The host has nothing to power down, it waits for AUX in virtual time.
+int sleep_period() {
+  unsigned long waited;
+  for (waited = 0; waited < POWER_WDT_MS; waited++) {
+    if (LOW == digitalRead(aux))
+      return 1;
+    delay(1);
+  }
+  return 0;
+}
+
+#endif
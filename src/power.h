@@ -0,0 +1,30 @@
+#ifndef COMMOTALKINO_SRC_POWER_H_
+#define COMMOTALKINO_SRC_POWER_H_
+
+#include <Arduino.h>
+
+// MCU power-down with two ways out: AUX going LOW, the module in power saving
+// heard a preamble and is about to output a frame, or the watchdog after
+// POWER_WDT_MS. The AUX pin change wakes the MCU through the pin change
+// interrupt of its port, whose handler belongs to SoftwareSerial and ignores
+// anything that is not its RX pin. The module pulls AUX down a few
+// milliseconds before the first byte, enough for the oscillator to start.
+//
+// millis() stands still in power-down. A watchdog wake-up adds its period,
+// an AUX wake-up half of it, so timeouts are right to half a period.
+
+#ifndef POWER_WDT_MS
+#define POWER_WDT_MS 120
+#endif
+
+typedef struct PowerStats {
+  unsigned long sleeps;
+  unsigned long aux_wakes;
+  unsigned long slept_ms;
+} PowerStats;
+
+void Power_Begin(unsigned char aux_pin);
+unsigned long Power_Sleep(unsigned long max_ms);
+PowerStats Power_Stats();
+
+#endif // COMMOTALKINO_SRC_POWER_H_
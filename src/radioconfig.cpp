@@ -0,0 +1,40 @@
+#include "radioconfig.h"
+#include <EEPROM.h>
+
+typedef struct RadioConfigRecord {
+  unsigned char magic;
+  unsigned char block[RADIO_CONFIG_LENGTH];
+  unsigned char crc;
+} RadioConfigRecord;
+
+int RadioConfig_Load(unsigned char *block) {
+  RadioConfigRecord record;
+  EEPROM.get(RADIO_CONFIG_ADDRESS, record);
+  if (RADIO_CONFIG_MAGIC != record.magic ||
+      RadioConfig_Crc8(record.block, RADIO_CONFIG_LENGTH) != record.crc)
+    return 0;
+  memcpy(block, record.block, RADIO_CONFIG_LENGTH);
+  return 1;
+}
+
+// update() rewrites only the bytes that changed, the EEPROM wears out after
+// some 100000 writes per cell.
+void RadioConfig_Store(const unsigned char *block) {
+  RadioConfigRecord record;
+  record.magic = RADIO_CONFIG_MAGIC;
+  memcpy(record.block, block, RADIO_CONFIG_LENGTH);
+  record.crc = RadioConfig_Crc8(block, RADIO_CONFIG_LENGTH);
+  EEPROM.put(RADIO_CONFIG_ADDRESS, record);
+}
+
+// CRC-8 with polynomial 0x07.
+unsigned char RadioConfig_Crc8(const unsigned char *data, unsigned int size) {
+  unsigned char crc = 0;
+  unsigned char bit;
+  while (size--) {
+    crc ^= *data++;
+    for (bit = 0; bit < 8; bit++)
+      crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+  }
+  return crc;
+}
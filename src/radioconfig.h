@@ -0,0 +1,24 @@
+#ifndef COMMOTALKINO_SRC_RADIOCONFIG_H_
+#define COMMOTALKINO_SRC_RADIOCONFIG_H_
+
+#include <Arduino.h>
+
+// Copy of the configuration last saved into the E32, kept in the MCU EEPROM
+// so a reset does not program the module again. The block is the one the
+// driver writes in sleep mode, the C0 head followed by ADDH, ADDL, SPED, CHAN
+// and OPTION, the same six bytes the module answers to C1 C1 C1. It is stored
+// behind a magic byte and followed by a CRC-8, so a blank or torn record
+// never matches.
+
+#define RADIO_CONFIG_LENGTH 6
+#define RADIO_CONFIG_MAGIC 0xE3
+
+#ifndef RADIO_CONFIG_ADDRESS
+#define RADIO_CONFIG_ADDRESS 0
+#endif
+
+int RadioConfig_Load(unsigned char *block);
+void RadioConfig_Store(const unsigned char *block);
+unsigned char RadioConfig_Crc8(const unsigned char *data, unsigned int size);
+
+#endif // COMMOTALKINO_SRC_RADIOCONFIG_H_
@@ -0,0 +1,153 @@
+#include "relay.h"
+#include <string.h>
+
+static void learn(Relay *relay, unsigned char destination,
+                  unsigned char next_hop, unsigned char hops,
+                  unsigned long now_ms);
+static int is_fresh(const RelayRoute *route, unsigned long now_ms);
+static int seen_before(Relay *relay, unsigned char origin,
+                       unsigned char sequence);
+
+void Relay_Init(Relay *relay, const unsigned char id,
+                const unsigned char number) {
+  memset(relay, 0, sizeof(*relay));
+  relay->id = id;
+  relay->number = number;
+}
+
+void Relay_Encode(const RelayFrame *frame, unsigned char *body) {
+  memset(body, 0, MESSAGE_BODY_LENGTH);
+  body[0] = (unsigned char)(frame->kind << 4 | (frame->hops & 0x0F));
+  body[1] = frame->origin;
+  body[2] = frame->destination;
+  body[3] = frame->sequence;
+  body[4] = frame->from;
+  memcpy(body + RELAY_HEADER_LENGTH, frame->payload, RELAY_PAYLOAD_LENGTH);
+}
+
+void Relay_Decode(const unsigned char *body, RelayFrame *frame) {
+  frame->kind = body[0] >> 4;
+  frame->hops = body[0] & 0x0F;
+  frame->origin = body[1];
+  frame->destination = body[2];
+  frame->sequence = body[3];
+  frame->from = body[4];
+  memcpy(frame->payload, body + RELAY_HEADER_LENGTH, RELAY_PAYLOAD_LENGTH);
+}
+
+// Returns the number of the neighbour to send it to, or RELAY_NEIGHBOURS.
+unsigned char Relay_Originate(Relay *relay, RelayFrame *frame,
+                              const unsigned char kind,
+                              const unsigned char destination,
+                              const unsigned char *payload,
+                              const unsigned long now_ms) {
+  const RelayRoute *route = Relay_Route(relay, destination, now_ms);
+  frame->kind = kind;
+  frame->hops = 0;
+  frame->origin = relay->id;
+  frame->destination = destination;
+  frame->sequence = ++relay->sequence;
+  frame->from = relay->number;
+  memset(frame->payload, 0, RELAY_PAYLOAD_LENGTH);
+  if (payload)
+    memcpy(frame->payload, payload, RELAY_PAYLOAD_LENGTH);
+  return route ? route->next_hop : RELAY_NEIGHBOURS;
+}
+
+// Learns from a received frame and decides what to do with it. A frame to
+// forward leaves with one more hop and my number, towards next_hop.
+unsigned char Relay_Handle(Relay *relay, RelayFrame *frame,
+                           unsigned char *next_hop,
+                           const unsigned long now_ms) {
+  const RelayRoute *route;
+  if (relay->id == frame->origin) {
+    relay->duplicates++;
+    return RELAY_DROP;
+  }
+  learn(relay, frame->origin, frame->from, frame->hops + 1, now_ms);
+  if (seen_before(relay, frame->origin, frame->sequence)) {
+    relay->duplicates++;
+    return RELAY_DROP;
+  }
+  if (relay->id == frame->destination) {
+    relay->delivered++;
+    return RELAY_DELIVER;
+  }
+  if (RELAY_MAX_HOPS <= frame->hops + 1) {
+    relay->hop_limited++;
+    return RELAY_DROP;
+  }
+  frame->hops++;
+  frame->from = relay->number;
+  route = Relay_Route(relay, frame->destination, now_ms);
+  *next_hop = route ? route->next_hop : RELAY_NEIGHBOURS;
+  if (!route)
+    relay->flooded++;
+  relay->forwarded++;
+  return RELAY_FORWARD;
+}
+
+const RelayRoute *Relay_Route(const Relay *relay,
+                              const unsigned char destination,
+                              const unsigned long now_ms) {
+  unsigned char i;
+  for (i = 0; i < relay->routes_used; i++) {
+    const RelayRoute *route = &relay->routes[i];
+    if (destination == route->destination && is_fresh(route, now_ms))
+      return route;
+  }
+  return 0;
+}
+
+int is_fresh(const RelayRoute *route, const unsigned long now_ms) {
+  return now_ms - route->learned_ms < RELAY_ROUTE_MS;
+}
+
+// A shorter or equal path wins, and so does any news from the current next
+// hop. A full table gives the oldest entry away.
+void learn(Relay *relay, const unsigned char destination,
+           const unsigned char next_hop, const unsigned char hops,
+           const unsigned long now_ms) {
+  RelayRoute *route = 0;
+  unsigned char i;
+  if (RELAY_EVERYONE == destination)
+    return;
+  for (i = 0; i < relay->routes_used; i++) {
+    if (destination == relay->routes[i].destination) {
+      route = &relay->routes[i];
+      break;
+    }
+  }
+  if (route && is_fresh(route, now_ms) && hops > route->hops &&
+      next_hop != route->next_hop)
+    return;
+  if (!route && relay->routes_used < RELAY_ROUTES)
+    route = &relay->routes[relay->routes_used++];
+  if (!route) {
+    route = &relay->routes[0];
+    for (i = 1; i < RELAY_ROUTES; i++) {
+      if (now_ms - relay->routes[i].learned_ms > now_ms - route->learned_ms)
+        route = &relay->routes[i];
+    }
+  }
+  route->destination = destination;
+  route->next_hop = next_hop;
+  route->hops = hops;
+  route->learned_ms = now_ms;
+}
+
+int seen_before(Relay *relay, const unsigned char origin,
+                const unsigned char sequence) {
+  unsigned char i;
+  for (i = 0; i < relay->seen_count; i++) {
+    if (origin == relay->seen[i].origin &&
+        sequence == relay->seen[i].sequence)
+      return 1;
+  }
+  relay->seen[relay->seen_next].origin = origin;
+  relay->seen[relay->seen_next].sequence = sequence;
+  relay->seen_next = (relay->seen_next + 1) % RELAY_SEEN;
+  if (relay->seen_count < RELAY_SEEN)
+    relay->seen_count++;
+  return 0;
+}
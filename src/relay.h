@@ -0,0 +1,85 @@
+#ifndef COMMOTALKINO_SRC_RELAY_H_
+#define COMMOTALKINO_SRC_RELAY_H_
+
+#include "../lib/CommoTalkie/messageconfig.h"
+
+// Forwarding across several hops. Every frame carries its origin, its final
+// destination, a sequence number of the origin, the hops so far and the
+// number of the node that sent it last, ahead of RELAY_PAYLOAD_LENGTH bytes
+// of payload. Node numbers are link addresses, ids are end to end.
+//
+// Routes are learned backwards: a frame from origin O that arrives from
+// neighbour N says O is reachable through N, in hops + 1. The sink floods a
+// beacon now and then so every node has a route to it, and every frame
+// teaches the nodes on its way the route back to its origin. A frame without
+// a route, and a beacon, goes out to every neighbour; each one forwards it
+// once, since a node remembers the last RELAY_SEEN (origin, sequence) pairs,
+// and not past RELAY_MAX_HOPS. A route not refreshed in RELAY_ROUTE_MS is dropped.
+//
+// On the ATmega328 a Relay takes 114 bytes of RAM: 8 routes of 7 bytes, 16
+// seen pairs of 2, 6 bytes of state and 5 counters of 4.
+
+#define RELAY_ROUTES 8
+#define RELAY_SEEN 16
+#define RELAY_MAX_HOPS 6
+#define RELAY_ROUTE_MS 60000UL
+#define RELAY_HEADER_LENGTH 5
+#define RELAY_PAYLOAD_LENGTH (MESSAGE_BODY_LENGTH - RELAY_HEADER_LENGTH)
+#define RELAY_EVERYONE 0xFF
+#define RELAY_NEIGHBOURS 0xFF
+
+enum RelayKind { RELAY_BEACON = 1, RELAY_DATA };
+
+enum RelayAction { RELAY_DROP, RELAY_DELIVER, RELAY_FORWARD };
+
+typedef struct RelayFrame {
+  unsigned char kind;
+  unsigned char hops;
+  unsigned char origin;
+  unsigned char destination;
+  unsigned char sequence;
+  unsigned char from;
+  unsigned char payload[RELAY_PAYLOAD_LENGTH];
+} RelayFrame;
+
+typedef struct RelayRoute {
+  unsigned char destination;
+  unsigned char next_hop;
+  unsigned char hops;
+  unsigned long learned_ms;
+} RelayRoute;
+
+typedef struct RelaySeen {
+  unsigned char origin;
+  unsigned char sequence;
+} RelaySeen;
+
+typedef struct Relay {
+  unsigned char id;
+  unsigned char number;
+  unsigned char sequence;
+  unsigned char routes_used;
+  unsigned char seen_count;
+  unsigned char seen_next;
+  RelayRoute routes[RELAY_ROUTES];
+  RelaySeen seen[RELAY_SEEN];
+  unsigned long forwarded;
+  unsigned long flooded;
+  unsigned long duplicates;
+  unsigned long hop_limited;
+  unsigned long delivered;
+} Relay;
+
+void Relay_Init(Relay *relay, unsigned char id, unsigned char number);
+unsigned char Relay_Originate(Relay *relay, RelayFrame *frame,
+                              unsigned char kind, unsigned char destination,
+                              const unsigned char *payload,
+                              unsigned long now_ms);
+unsigned char Relay_Handle(Relay *relay, RelayFrame *frame,
+                           unsigned char *next_hop, unsigned long now_ms);
+const RelayRoute *Relay_Route(const Relay *relay, unsigned char destination,
+                              unsigned long now_ms);
+void Relay_Encode(const RelayFrame *frame, unsigned char *body);
+void Relay_Decode(const unsigned char *body, RelayFrame *frame);
+
+#endif // COMMOTALKINO_SRC_RELAY_H_
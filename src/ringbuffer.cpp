@@ -0,0 +1,42 @@
+#include "ringbuffer.h"
+
+void RingBuffer_Init(RingBuffer *ring, unsigned char *data,
+                     const unsigned int size) {
+  ring->data = data;
+  ring->mask = (unsigned char)(size - 1);
+  ring->head = 0;
+  ring->tail = 0;
+  ring->high_water = 0;
+  ring->overruns = 0;
+}
+
+int RingBuffer_Push(RingBuffer *ring, const unsigned char value) {
+  const unsigned char head = ring->head;
+  const unsigned char next = (head + 1) & ring->mask;
+  unsigned char count;
+  if (next == ring->tail) {
+    ring->overruns++;
+    return 0;
+  }
+  ring->data[head] = value;
+  ring->head = next;
+  count = (next - ring->tail) & ring->mask;
+  if (ring->high_water < count)
+    ring->high_water = count;
+  return 1;
+}
+
+int RingBuffer_Pop(RingBuffer *ring, unsigned char *value) {
+  const unsigned char tail = ring->tail;
+  if (tail == ring->head)
+    return 0;
+  *value = ring->data[tail];
+  ring->tail = (tail + 1) & ring->mask;
+  return 1;
+}
+
+unsigned char RingBuffer_Count(const RingBuffer *ring) {
+  return (ring->head - ring->tail) & ring->mask;
+}
+
+void RingBuffer_Clear(RingBuffer *ring) { ring->tail = ring->head; }
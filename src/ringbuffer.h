@@ -0,0 +1,24 @@
+#ifndef COMMOTALKINO_SRC_RINGBUFFER_H_
+#define COMMOTALKINO_SRC_RINGBUFFER_H_
+
+// Lock-free single producer, single consumer byte queue. The producer (an
+// interrupt handler) only moves head, the consumer only moves tail, and both
+// indexes are one byte wide so that every access is atomic on the AVR.
+// The size must be a power of two, up to 256. One slot is kept empty.
+
+typedef struct RingBuffer {
+  unsigned char *data;
+  unsigned char mask;
+  volatile unsigned char head;
+  volatile unsigned char tail;
+  volatile unsigned char high_water;
+  volatile unsigned int overruns;
+} RingBuffer;
+
+void RingBuffer_Init(RingBuffer *ring, unsigned char *data, unsigned int size);
+int RingBuffer_Push(RingBuffer *ring, unsigned char value);
+int RingBuffer_Pop(RingBuffer *ring, unsigned char *value);
+unsigned char RingBuffer_Count(const RingBuffer *ring);
+void RingBuffer_Clear(RingBuffer *ring);
+
+#endif // COMMOTALKINO_SRC_RINGBUFFER_H_
@@ -0,0 +1,45 @@
+#include "rtt.h"
+
+static unsigned long clamp(const RttEstimator *rtt, unsigned long value);
+
+unsigned long clamp(const RttEstimator *rtt, const unsigned long value) {
+  if (value < rtt->margin_ms)
+    return rtt->margin_ms;
+  return rtt->max_ms < value ? rtt->max_ms : value;
+}
+
+void Rtt_Init(RttEstimator *rtt, const unsigned long initial_ms,
+              const unsigned long margin_ms, const unsigned long max_ms) {
+  rtt->srtt8 = 0;
+  rtt->rttvar4 = 0;
+  rtt->margin_ms = margin_ms;
+  rtt->max_ms = max_ms;
+  rtt->samples = 0;
+  rtt->backoffs = 0;
+  rtt->timeout_ms = clamp(rtt, initial_ms);
+}
+
+void Rtt_Sample(RttEstimator *rtt, const unsigned long sample_ms) {
+  if (0 == rtt->samples) {
+    rtt->srtt8 = sample_ms << 3;
+    rtt->rttvar4 = sample_ms << 1;
+  } else {
+    const long error = (long)sample_ms - (long)(rtt->srtt8 >> 3);
+    const unsigned long deviation = error < 0 ? -error : error;
+    rtt->srtt8 += error;
+    rtt->rttvar4 = rtt->rttvar4 - (rtt->rttvar4 >> 2) + deviation;
+  }
+  rtt->samples++;
+  const unsigned long margin =
+      rtt->rttvar4 < rtt->margin_ms ? rtt->margin_ms : rtt->rttvar4;
+  rtt->timeout_ms = clamp(rtt, (rtt->srtt8 >> 3) + margin);
+}
+
+void Rtt_Backoff(RttEstimator *rtt) {
+  rtt->backoffs++;
+  rtt->timeout_ms = clamp(rtt, rtt->timeout_ms << 1);
+}
+
+unsigned long Rtt_Timeout(const RttEstimator *rtt) { return rtt->timeout_ms; }
+
+unsigned long Rtt_Smoothed(const RttEstimator *rtt) { return rtt->srtt8 >> 3; }
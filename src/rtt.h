@@ -0,0 +1,29 @@
+#ifndef COMMOTALKINO_SRC_RTT_H_
+#define COMMOTALKINO_SRC_RTT_H_
+
+// Round trip time estimator of a peer, Jacobson/Karels as in TCP: a smoothed
+// mean with gain 1/8 and a mean deviation with gain 1/4. The timeout is the
+// mean plus the larger of four deviations and margin_ms, the granularity term
+// of RFC 6298, up to max_ms. A steady link drives the deviation to zero and
+// the margin keeps a single late answer from counting as lost. Every timeout
+// doubles the current value until the next sample arrives. Values are kept
+// scaled by 8 and 4 so the arithmetic stays integer.
+
+typedef struct RttEstimator {
+  unsigned long srtt8;
+  unsigned long rttvar4;
+  unsigned long timeout_ms;
+  unsigned long margin_ms;
+  unsigned long max_ms;
+  unsigned long samples;
+  unsigned long backoffs;
+} RttEstimator;
+
+void Rtt_Init(RttEstimator *rtt, unsigned long initial_ms,
+              unsigned long margin_ms, unsigned long max_ms);
+void Rtt_Sample(RttEstimator *rtt, unsigned long sample_ms);
+void Rtt_Backoff(RttEstimator *rtt);
+unsigned long Rtt_Timeout(const RttEstimator *rtt);
+unsigned long Rtt_Smoothed(const RttEstimator *rtt);
+
+#endif // COMMOTALKINO_SRC_RTT_H_
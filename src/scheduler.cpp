@@ -0,0 +1,120 @@
+#include "scheduler.h"
+#include <string.h>
+
+static int is_due(Scheduler *scheduler, Task *task, unsigned long now_us);
+static int has_passed(unsigned long now_us, unsigned long due_us);
+static void run_task(Scheduler *scheduler, Task *task, unsigned long now_us);
+
+void Scheduler_Init(Scheduler *scheduler, SchedulerClock clock) {
+  memset(scheduler, 0, sizeof(*scheduler));
+  scheduler->clock = clock;
+  scheduler->start_us = clock();
+}
+
+// Tasks run in the order they were added, the first call right on the next
+// pass. Returns 0 once the table is full.
+Task *Scheduler_Add(Scheduler *scheduler, TaskRun run, const char *name) {
+  if (SCHEDULER_TASKS <= scheduler->count)
+    return 0;
+  Task *task = &scheduler->tasks[scheduler->count++];
+  memset(task, 0, sizeof(*task));
+  task->run = run;
+  task->name = name;
+  task->state = TASK_POLLING;
+  return task;
+}
+
+// Wakes every task waiting for one of the events. An event no task waits for
+// yet stays pending for the first one that does.
+void Scheduler_Signal(Scheduler *scheduler, const unsigned char events) {
+  unsigned char taken = 0;
+  unsigned char i;
+  for (i = 0; i < scheduler->count; i++) {
+    Task *task = &scheduler->tasks[i];
+    if (TASK_WAITING != task->state || !(task->events & events))
+      continue;
+    task->events &= events;
+    taken |= task->events;
+    task->state = TASK_DUE;
+    task->due_us = scheduler->clock();
+  }
+  scheduler->events |= events & ~taken;
+}
+
+// One pass over the table. Returns how many tasks did more than poll, 0 when
+// the whole pass was idle.
+int Scheduler_RunOnce(Scheduler *scheduler) {
+  int worked = 0;
+  unsigned char i;
+  scheduler->passes++;
+  for (i = 0; i < scheduler->count; i++) {
+    Task *task = &scheduler->tasks[i];
+    const unsigned long now_us = scheduler->clock();
+    if (!is_due(scheduler, task, now_us))
+      continue;
+    run_task(scheduler, task, now_us);
+    worked += !task->idle;
+  }
+  return worked;
+}
+
+int is_due(Scheduler *scheduler, Task *task, const unsigned long now_us) {
+  switch (task->state) {
+  case TASK_POLLING:
+  case TASK_DUE:
+    return 1;
+  case TASK_SLEEPING:
+    return has_passed(now_us, task->due_us);
+  case TASK_WAITING:
+    if (!(task->events & scheduler->events))
+      return 0;
+    task->events &= scheduler->events;
+    scheduler->events &= ~task->events;
+    task->due_us = now_us;
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+int has_passed(const unsigned long now_us, const unsigned long due_us) {
+  return now_us - due_us < 0x80000000UL;
+}
+
+void run_task(Scheduler *scheduler, Task *task, const unsigned long now_us) {
+  if (TASK_POLLING != task->state) {
+    const unsigned long late_us = now_us - task->due_us;
+    if (task->max_late_us < late_us)
+      task->max_late_us = late_us;
+  }
+  task->now_us = now_us;
+  task->idle = 0;
+  task->run(task);
+  const unsigned long run_us = scheduler->clock() - now_us;
+  if (task->max_run_us < run_us)
+    task->max_run_us = run_us;
+  if (task->idle)
+    return;
+  task->runs++;
+  scheduler->busy_us += run_us;
+}
+
+// The share of the time since init spent in passes and polls with nothing
+// to do.
+double Scheduler_IdleShare(const Scheduler *scheduler,
+                           const unsigned long now_us) {
+  const unsigned long elapsed_us = now_us - scheduler->start_us;
+  if (!elapsed_us || elapsed_us < scheduler->busy_us)
+    return 0;
+  return 1.0 - (double)scheduler->busy_us / elapsed_us;
+}
+
+unsigned long Scheduler_MaxLateUs(const Scheduler *scheduler) {
+  unsigned long late_us = 0;
+  unsigned char i;
+  for (i = 0; i < scheduler->count; i++) {
+    if (late_us < scheduler->tasks[i].max_late_us)
+      late_us = scheduler->tasks[i].max_late_us;
+  }
+  return late_us;
+}
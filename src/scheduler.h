@@ -0,0 +1,122 @@
+#ifndef COMMOTALKINO_SRC_SCHEDULER_H_
+#define COMMOTALKINO_SRC_SCHEDULER_H_
+
+// Cooperative scheduler over a fixed table of tasks, run to completion in
+// turn from loop(). A task is a protothread: a function called again and
+// again that returns at every wait and resumes right after it on the next
+// call, from the line kept in its Task. Locals do not survive a wait, what
+// has to goes into statics, and a line holds one wait at most. No task may
+// block: a delay becomes TASK_SLEEP and a busy wait TASK_WAIT_UNTIL or
+// TASK_WAIT_EVENT, and the time goes to the other tasks meanwhile.
+//
+// A task is due once its sleep is over or an event it waits for is signalled,
+// and on every pass while it polls a condition. A poll that finds the
+// condition false is idle time, everything else a task runs is busy time; the
+// scheduler counts both, the longest run of every task, and how late after it
+// was due a task gets the CPU, the latency the others cause it.
+//
+// All times are in microseconds of the clock given at init, durations have to
+// stay under half its wrap around.
+
+#define SCHEDULER_TASKS 6
+
+enum TaskState {
+  TASK_POLLING,
+  TASK_SLEEPING,
+  TASK_WAITING,
+  TASK_DUE,
+  TASK_DONE
+};
+
+typedef struct Task Task;
+typedef void (*TaskRun)(Task *task);
+typedef unsigned long (*SchedulerClock)();
+
+struct Task {
+  TaskRun run;
+  const char *name;
+  unsigned int line;
+  unsigned char state;
+  unsigned char idle;
+  unsigned char events;
+  unsigned long due_us;
+  unsigned long now_us;
+  unsigned long runs;
+  unsigned long max_run_us;
+  unsigned long max_late_us;
+};
+
+typedef struct Scheduler {
+  Task tasks[SCHEDULER_TASKS];
+  unsigned char count;
+  unsigned char events;
+  SchedulerClock clock;
+  unsigned long start_us;
+  unsigned long busy_us;
+  unsigned long passes;
+} Scheduler;
+
+// A wait falls through into the case of its own line on the first call.
+#if defined(__has_attribute)
+#if __has_attribute(fallthrough)
+#define TASK_FALLTHROUGH __attribute__((fallthrough))
+#endif
+#endif
+#ifndef TASK_FALLTHROUGH
+#define TASK_FALLTHROUGH
+#endif
+
+#define TASK_BEGIN(task)                                                       \
+  switch ((task)->line) {                                                      \
+  case 0:
+
+#define TASK_END(task)                                                         \
+  }                                                                            \
+  (task)->line = 0;                                                            \
+  (task)->state = TASK_DONE
+
+#define TASK_YIELD_AS(task, new_state)                                         \
+  do {                                                                         \
+    (task)->state = (new_state);                                               \
+    (task)->line = __LINE__;                                                   \
+    return;                                                                    \
+  case __LINE__:;                                                              \
+  } while (0)
+
+// Back on the next pass, after every other task due.
+#define TASK_YIELD(task) TASK_YIELD_AS(task, TASK_POLLING)
+
+#define TASK_SLEEP(task, ms)                                                   \
+  do {                                                                         \
+    (task)->due_us = (task)->now_us + (unsigned long)(ms) * 1000UL;            \
+    TASK_YIELD_AS(task, TASK_SLEEPING);                                        \
+  } while (0)
+
+// The condition is checked on every pass, keep it cheap.
+#define TASK_WAIT_UNTIL(task, condition)                                       \
+  do {                                                                         \
+    (task)->state = TASK_POLLING;                                              \
+    (task)->line = __LINE__;                                                   \
+    TASK_FALLTHROUGH;                                                          \
+  case __LINE__:                                                               \
+    if (!(condition)) {                                                        \
+      (task)->idle = 1;                                                        \
+      return;                                                                  \
+    }                                                                          \
+  } while (0)
+
+// Afterwards events holds the ones of the mask that were signalled.
+#define TASK_WAIT_EVENT(task, mask)                                            \
+  do {                                                                         \
+    (task)->events = (mask);                                                   \
+    TASK_YIELD_AS(task, TASK_WAITING);                                         \
+  } while (0)
+
+void Scheduler_Init(Scheduler *scheduler, SchedulerClock clock);
+Task *Scheduler_Add(Scheduler *scheduler, TaskRun run, const char *name);
+void Scheduler_Signal(Scheduler *scheduler, unsigned char events);
+int Scheduler_RunOnce(Scheduler *scheduler);
+double Scheduler_IdleShare(const Scheduler *scheduler, unsigned long now_us);
+unsigned long Scheduler_MaxLateUs(const Scheduler *scheduler);
+
+#endif // COMMOTALKINO_SRC_SCHEDULER_H_
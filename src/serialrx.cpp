@@ -0,0 +1,87 @@
+#include "serialrx.h"
+#include "ringbuffer.h"
+
+#ifdef __AVR__
+#include <avr/interrupt.h>
+#else
+#include <HostSim.h>
+#endif
+
+static unsigned char storage[SERIAL_RX_SIZE];
+static RingBuffer ring;
+static Stream *source;
+static volatile unsigned long last_byte_us;
+
+static void start_timer();
+
+void SerialRx_Begin(Stream *port) {
+  RingBuffer_Init(&ring, storage, SERIAL_RX_SIZE);
+  source = port;
+  start_timer();
+}
+
+// Producer side, interrupt context only.
+void SerialRx_Service() {
+  unsigned char moved;
+  if (source->available() <= 0)
+    return;
+  last_byte_us = micros();
+  for (moved = 0; moved < SERIAL_RX_PER_TICK && source->available() > 0;
+       moved++)
+    RingBuffer_Push(&ring, (unsigned char)source->read());
+}
+
+int SerialRx_Read(unsigned char *value) { return RingBuffer_Pop(&ring, value); }
+
+unsigned char SerialRx_Available() { return RingBuffer_Count(&ring); }
+
+void SerialRx_Clear() {
+  noInterrupts();
+  while (source->available() > 0) {
+    source->read();
+  }
+  RingBuffer_Clear(&ring);
+  interrupts();
+}
+
+SerialRxStats SerialRx_Stats() {
+  SerialRxStats stats;
+  noInterrupts();
+  stats.overruns = ring.overruns;
+  stats.high_water = ring.high_water;
+  interrupts();
+  return stats;
+}
+
+unsigned long SerialRx_LastByteUs() {
+  unsigned long at_us;
+  noInterrupts();
+  at_us = last_byte_us;
+  interrupts();
+  return at_us;
+}
+
+// -----------------------------------------------------------------------------
+// Timer
+
+#ifdef __AVR__
+
+ISR(TIMER2_COMPA_vect) { SerialRx_Service(); }
+
+// Timer2 in CTC mode, clk/64, one compare match per SERIAL_RX_TICK_US.
+void start_timer() {
+  noInterrupts();
+  TCCR2A = _BV(WGM21);
+  TCCR2B = _BV(CS22);
+  OCR2A = (unsigned char)(F_CPU / 64 / (1000000UL / SERIAL_RX_TICK_US) - 1);
+  TIMSK2 |= _BV(OCIE2A);
+  interrupts();
+}
+
+#else
+
+void start_timer() {
+  HostSim_AttachTimer(SERIAL_RX_TICK_US, SerialRx_Service);
+}
+
+#endif
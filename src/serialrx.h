@@ -0,0 +1,44 @@
+#ifndef COMMOTALKINO_SRC_SERIALRX_H_
+#define COMMOTALKINO_SRC_SERIALRX_H_
+
+#include <Arduino.h>
+
+// Interrupt-driven receive path of the E32 UART. A timer interrupt moves the
+// bytes buffered by the UART driver into a larger ring, so the small
+// SoftwareSerial buffer (64 bytes) never overflows while the loop is busy
+// printing or sleeping. ReadFromSerial only copies out of the ring.
+//
+// The interrupt takes at most SERIAL_RX_PER_TICK bytes a tick, a few
+// microseconds with interrupts off, so it never holds back the pin change
+// interrupt of a start bit long enough to skew SoftwareSerial's sampling.
+// Two bytes a millisecond are twice what the UART delivers at 9600 baud; a
+// burst waits in the SoftwareSerial buffer for the next ticks.
+//
+// On the AVR the tick is Timer2, which the sketch then owns: tone() and the
+// PWM of pins 3 and 11 are not available. Pin 3 is the E32 TX anyway.
+
+#ifndef SERIAL_RX_SIZE
+#define SERIAL_RX_SIZE 128
+#endif
+
+#ifndef SERIAL_RX_TICK_US
+#define SERIAL_RX_TICK_US 1000
+#endif
+#ifndef SERIAL_RX_PER_TICK
+#define SERIAL_RX_PER_TICK 2
+#endif
+
+typedef struct SerialRxStats {
+  unsigned int overruns;
+  unsigned char high_water;
+} SerialRxStats;
+
+void SerialRx_Begin(Stream *port);
+void SerialRx_Service();
+int SerialRx_Read(unsigned char *value);
+unsigned char SerialRx_Available();
+void SerialRx_Clear();
+SerialRxStats SerialRx_Stats();
+unsigned long SerialRx_LastByteUs();
+
+#endif // COMMOTALKINO_SRC_SERIALRX_H_
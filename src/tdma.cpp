@@ -0,0 +1,244 @@
+#include "tdma.h"
+#include <string.h>
+
+static unsigned char slot_of(const TdmaCoordinator *coordinator,
+                             unsigned char id);
+static void free_slot(TdmaCoordinator *coordinator, unsigned char slot);
+static void count_slots(TdmaCoordinator *coordinator);
+static void notify(TdmaCoordinator *coordinator, unsigned char id,
+                   unsigned char slot);
+
+void Tdma_EncodeBeacon(const TdmaBeacon *beacon, unsigned char *body) {
+  unsigned char i;
+  memset(body, 0, MESSAGE_BODY_LENGTH);
+  body[0] = TDMA_BEACON;
+  body[1] = beacon->slots;
+  body[2] = (unsigned char)(beacon->slot_ms / TDMA_SLOT_UNIT_MS);
+  for (i = 0; i < 4; i++)
+    body[3 + i] = (unsigned char)(beacon->time_ms >> (8 * i));
+  body[7] = beacon->grant_id;
+  body[8] = beacon->grant_slot;
+}
+
+int Tdma_DecodeBeacon(const unsigned char *body, TdmaBeacon *beacon) {
+  unsigned char i;
+  if (TDMA_BEACON != body[0] || TDMA_MAX_SLOTS < body[1] || 0 == body[2])
+    return 0;
+  beacon->slots = body[1];
+  beacon->slot_ms = body[2] * TDMA_SLOT_UNIT_MS;
+  beacon->time_ms = 0;
+  for (i = 0; i < 4; i++)
+    beacon->time_ms |= (unsigned long)body[3 + i] << (8 * i);
+  beacon->grant_id = body[7];
+  beacon->grant_slot = body[8];
+  return 1;
+}
+
+// From the end of one beacon to the start of the next one.
+unsigned long Tdma_SuperframeMs(const unsigned char slots,
+                                const unsigned int slot_ms) {
+  return (unsigned long)(slots + 1) * slot_ms;
+}
+
+// -----------------------------------------------------------------------------
+// Coordinator
+
+void TdmaCoordinator_Init(TdmaCoordinator *coordinator,
+                          const unsigned int slot_ms,
+                          const unsigned char expire_after) {
+  memset(coordinator, 0, sizeof(*coordinator));
+  coordinator->slot_ms = slot_ms;
+  coordinator->expire_after = expire_after;
+}
+
+unsigned char slot_of(const TdmaCoordinator *coordinator,
+                      const unsigned char id) {
+  unsigned char slot;
+  for (slot = 1; slot <= TDMA_MAX_SLOTS; slot++) {
+    if (id == coordinator->owner[slot])
+      return slot;
+  }
+  return TDMA_NO_SLOT;
+}
+
+void free_slot(TdmaCoordinator *coordinator, const unsigned char slot) {
+  coordinator->owner[slot] = TDMA_FREE;
+  coordinator->idle[slot] = 0;
+}
+
+void count_slots(TdmaCoordinator *coordinator) {
+  unsigned char slot = TDMA_MAX_SLOTS;
+  while (slot && TDMA_FREE == coordinator->owner[slot])
+    slot--;
+  coordinator->slots = slot;
+}
+
+// One notice per leaf, the latest. A full queue drops it, the leaf asks again.
+void notify(TdmaCoordinator *coordinator, const unsigned char id,
+            const unsigned char slot) {
+  unsigned char i;
+  for (i = 0; i < coordinator->notice_count; i++) {
+    if (id == coordinator->notices[i].id) {
+      coordinator->notices[i].slot = slot;
+      return;
+    }
+  }
+  if (TDMA_NOTICES == coordinator->notice_count)
+    return;
+  coordinator->notices[coordinator->notice_count].id = id;
+  coordinator->notices[coordinator->notice_count].slot = slot;
+  coordinator->notice_count++;
+}
+
+// Opens a superframe: expires the silent leaves and carries the oldest notice.
+void TdmaCoordinator_Beacon(TdmaCoordinator *coordinator,
+                            const unsigned long now_ms, TdmaBeacon *beacon) {
+  unsigned char slot;
+  coordinator->superframes++;
+  for (slot = 1; slot <= coordinator->slots; slot++) {
+    if (TDMA_FREE == coordinator->owner[slot] ||
+        ++coordinator->idle[slot] <= coordinator->expire_after)
+      continue;
+    notify(coordinator, coordinator->owner[slot], TDMA_NO_SLOT);
+    free_slot(coordinator, slot);
+    coordinator->expirations++;
+  }
+  count_slots(coordinator);
+  beacon->slots = coordinator->slots;
+  beacon->slot_ms = coordinator->slot_ms;
+  beacon->time_ms = now_ms;
+  beacon->grant_id = TDMA_FREE;
+  beacon->grant_slot = TDMA_NO_SLOT;
+  if (!coordinator->notice_count)
+    return;
+  beacon->grant_id = coordinator->notices[0].id;
+  beacon->grant_slot = coordinator->notices[0].slot;
+  coordinator->notice_count--;
+  memmove(coordinator->notices, coordinator->notices + 1,
+          coordinator->notice_count * sizeof(TdmaNotice));
+}
+
+void TdmaCoordinator_Receive(TdmaCoordinator *coordinator,
+                             const unsigned char kind, const unsigned char id) {
+  unsigned char slot = slot_of(coordinator, id);
+  if (TDMA_FREE == id)
+    return;
+  switch (kind) {
+  case TDMA_JOIN:
+    if (TDMA_NO_SLOT == slot) {
+      slot = slot_of(coordinator, TDMA_FREE);
+      if (TDMA_NO_SLOT == slot)
+        return;
+      coordinator->owner[slot] = id;
+      coordinator->idle[slot] = 0;
+      coordinator->joins++;
+    }
+    notify(coordinator, id, slot);
+    break;
+  case TDMA_DATA:
+    if (TDMA_NO_SLOT == slot)
+      notify(coordinator, id, TDMA_NO_SLOT);
+    else
+      coordinator->idle[slot] = 0;
+    break;
+  case TDMA_LEAVE:
+    if (TDMA_NO_SLOT != slot) {
+      free_slot(coordinator, slot);
+      coordinator->leaves++;
+    }
+    notify(coordinator, id, TDMA_NO_SLOT);
+    break;
+  }
+  count_slots(coordinator);
+}
+
+unsigned char TdmaCoordinator_Members(const TdmaCoordinator *coordinator) {
+  unsigned char slot;
+  unsigned char members = 0;
+  for (slot = 1; slot <= TDMA_MAX_SLOTS; slot++)
+    members += TDMA_FREE != coordinator->owner[slot];
+  return members;
+}
+
+// -----------------------------------------------------------------------------
+// Leaf
+
+void TdmaLeaf_Init(TdmaLeaf *leaf, const unsigned char id) {
+  memset(leaf, 0, sizeof(*leaf));
+  leaf->id = id;
+  leaf->slot = TDMA_NO_SLOT;
+  leaf->backoff = 1;
+}
+
+// Takes the time reference of the superframe and the grant, if it is mine.
+// The change of the offset to the coordinator clock since the previous beacon
+// is the sync error, drift and jitter together.
+void TdmaLeaf_Beacon(TdmaLeaf *leaf, const TdmaBeacon *beacon,
+                     const unsigned long now_ms) {
+  const short joining = TDMA_NO_SLOT == leaf->slot && leaf->joining;
+  const long offset_ms = (long)(beacon->time_ms - now_ms);
+  if (leaf->synced) {
+    const unsigned long error = offset_ms < leaf->offset_ms
+                                    ? leaf->offset_ms - offset_ms
+                                    : offset_ms - leaf->offset_ms;
+    leaf->sync_error_sum_ms += error;
+    leaf->sync_samples++;
+    if (leaf->sync_error_max_ms < error)
+      leaf->sync_error_max_ms = error;
+  }
+  leaf->beacons++;
+  leaf->synced = 1;
+  leaf->joining = 0;
+  leaf->anchor_ms = now_ms;
+  leaf->offset_ms = offset_ms;
+  leaf->slots = beacon->slots;
+  leaf->slot_ms = beacon->slot_ms;
+  if (leaf->id == beacon->grant_id) {
+    leaf->slot = beacon->grant_slot;
+    leaf->backoff = 1;
+    if (TDMA_NO_SLOT == leaf->slot)
+      leaf->leaving = 0;
+  } else if (TDMA_NO_SLOT != leaf->slot && leaf->slots < leaf->slot) {
+    // The notice that took it away was lost, the table no longer has it.
+    leaf->slot = TDMA_NO_SLOT;
+  } else if (joining && leaf->backoff < TDMA_MAX_BACKOFF) {
+    leaf->backoff++;
+  }
+}
+
+// Without the beacon the slot table may have changed, no transmitting until
+// the next one.
+void TdmaLeaf_Missed(TdmaLeaf *leaf) {
+  leaf->missed++;
+  leaf->synced = 0;
+  leaf->joining = 0;
+}
+
+void TdmaLeaf_Leave(TdmaLeaf *leaf) { leaf->leaving = 1; }
+
+// The frame to send in this superframe and when, or 0. draw is a random byte,
+// it decides whether a leaf without a slot tries to join now.
+unsigned char TdmaLeaf_Plan(TdmaLeaf *leaf, const unsigned char draw,
+                            unsigned long *at_ms) {
+  if (!leaf->synced)
+    return 0;
+  if (TDMA_NO_SLOT != leaf->slot) {
+    *at_ms = leaf->anchor_ms + (unsigned long)leaf->slot * leaf->slot_ms;
+    return leaf->leaving ? TDMA_LEAVE : TDMA_DATA;
+  }
+  if (draw & ((1 << leaf->backoff) - 1))
+    return 0;
+  leaf->joining = 1;
+  leaf->joins++;
+  *at_ms = leaf->anchor_ms;
+  return TDMA_JOIN;
+}
+
+unsigned long TdmaLeaf_NextBeacon(const TdmaLeaf *leaf) {
+  return leaf->anchor_ms + Tdma_SuperframeMs(leaf->slots, leaf->slot_ms);
+}
+
+unsigned long TdmaLeaf_NetworkTime(const TdmaLeaf *leaf,
+                                   const unsigned long now_ms) {
+  return now_ms + leaf->offset_ms;
+}
@@ -0,0 +1,108 @@
+#ifndef COMMOTALKINO_SRC_TDMA_H_
+#define COMMOTALKINO_SRC_TDMA_H_
+
+#include "../lib/CommoTalkie/messageconfig.h"
+
+// Time slots of a star: one coordinator and up to TDMA_MAX_SLOTS leaves on
+// the same channel. The coordinator opens every superframe with a broadcast
+// beacon, and the end of the beacon is the time reference of the superframe.
+// Slot 0 is the join slot, open to any leaf without a slot, and slots 1 to
+// `slots` belong to one leaf each, so no two leaves transmit at once.
+//
+//   | beacon | join | slot 1 | slot 2 | ... | slot n | beacon | ...
+//
+// A leaf without a slot sends a JOIN in the join slot with a probability that
+// halves every superframe it goes without a grant, up to 1 in
+// 2^TDMA_MAX_BACKOFF, since two JOINs in the same slot collide. The
+// coordinator grants the lowest free slot, or the one the leaf already has,
+// in the next beacon. A LEAVE frees the slot and so does a leaf silent for
+// expire_after superframes. Both are confirmed with a grant of TDMA_NO_SLOT.
+// The superframe is only as long as the highest slot in use.
+//
+// A beacon takes the whole message body: kind, slots, slot length in
+// TDMA_SLOT_UNIT_MS, the coordinator clock and a grant, leaf id and slot.
+// Leaf ids are never 0, TDMA_FREE marks a free slot.
+
+#define TDMA_MAX_SLOTS 32
+#define TDMA_NO_SLOT 0xFF
+#define TDMA_FREE 0
+#define TDMA_SLOT_UNIT_MS 10
+#define TDMA_NOTICES 8
+#define TDMA_MAX_BACKOFF 5
+#define TDMA_BEACON_LENGTH 9
+
+#if MESSAGE_BODY_LENGTH < TDMA_BEACON_LENGTH
+#error "The message body is too short for a TDMA beacon"
+#endif
+
+enum TdmaKind { TDMA_BEACON = 0xB0, TDMA_JOIN, TDMA_DATA, TDMA_LEAVE };
+
+typedef struct TdmaBeacon {
+  unsigned char slots;
+  unsigned int slot_ms;
+  unsigned long time_ms;
+  unsigned char grant_id;
+  unsigned char grant_slot;
+} TdmaBeacon;
+
+typedef struct TdmaNotice {
+  unsigned char id;
+  unsigned char slot;
+} TdmaNotice;
+
+typedef struct TdmaCoordinator {
+  unsigned int slot_ms;
+  unsigned char expire_after;
+  unsigned char slots;
+  unsigned char owner[TDMA_MAX_SLOTS + 1];
+  unsigned char idle[TDMA_MAX_SLOTS + 1];
+  TdmaNotice notices[TDMA_NOTICES];
+  unsigned char notice_count;
+  unsigned long superframes;
+  unsigned long joins;
+  unsigned long leaves;
+  unsigned long expirations;
+} TdmaCoordinator;
+
+typedef struct TdmaLeaf {
+  unsigned char id;
+  unsigned char slot;
+  unsigned char slots;
+  unsigned int slot_ms;
+  unsigned long anchor_ms;
+  long offset_ms;
+  short synced;
+  short leaving;
+  short joining;
+  unsigned char backoff;
+  unsigned long beacons;
+  unsigned long missed;
+  unsigned long joins;
+  unsigned long sync_samples;
+  unsigned long sync_error_sum_ms;
+  unsigned long sync_error_max_ms;
+} TdmaLeaf;
+
+void Tdma_EncodeBeacon(const TdmaBeacon *beacon, unsigned char *body);
+int Tdma_DecodeBeacon(const unsigned char *body, TdmaBeacon *beacon);
+unsigned long Tdma_SuperframeMs(unsigned char slots, unsigned int slot_ms);
+
+void TdmaCoordinator_Init(TdmaCoordinator *coordinator, unsigned int slot_ms,
+                          unsigned char expire_after);
+void TdmaCoordinator_Beacon(TdmaCoordinator *coordinator,
+                            unsigned long now_ms, TdmaBeacon *beacon);
+void TdmaCoordinator_Receive(TdmaCoordinator *coordinator, unsigned char kind,
+                             unsigned char id);
+unsigned char TdmaCoordinator_Members(const TdmaCoordinator *coordinator);
+
+void TdmaLeaf_Init(TdmaLeaf *leaf, unsigned char id);
+void TdmaLeaf_Beacon(TdmaLeaf *leaf, const TdmaBeacon *beacon,
+                     unsigned long now_ms);
+void TdmaLeaf_Missed(TdmaLeaf *leaf);
+void TdmaLeaf_Leave(TdmaLeaf *leaf);
+unsigned char TdmaLeaf_Plan(TdmaLeaf *leaf, unsigned char draw,
+                            unsigned long *at_ms);
+unsigned long TdmaLeaf_NextBeacon(const TdmaLeaf *leaf);
+unsigned long TdmaLeaf_NetworkTime(const TdmaLeaf *leaf, unsigned long now_ms);
+
+#endif // COMMOTALKINO_SRC_TDMA_H_
@@ -0,0 +1,69 @@
+#include "trace.h"
+#include <string.h>
+
+static TraceEvent events[TRACE_RING_SIZE];
+static unsigned char events_head;
+static unsigned char events_count;
+static TraceHistogram trace_histograms[TRACE_STAGES];
+
+static const char *const trace_stage_names[TRACE_STAGES] = {
+    "mode_switch", "aux_wait", "uart_write", "air_wait", "uart_read"};
+
+static void fold_oldest();
+
+void fold_oldest() {
+  const TraceEvent *event =
+      &events[(unsigned char)(events_head - events_count) % TRACE_RING_SIZE];
+  TraceHistogram *histogram = &trace_histograms[event->stage];
+  histogram->count++;
+  if (histogram->max_us < event->duration_us)
+    histogram->max_us = event->duration_us;
+  histogram->buckets[Trace_Bucket(event->duration_us)]++;
+  events_count--;
+}
+
+void Trace_Record(const unsigned char stage, const unsigned long start_us,
+                  const unsigned long end_us) {
+  if (TRACE_STAGES <= stage)
+    return;
+  if (TRACE_RING_SIZE == events_count)
+    fold_oldest();
+  TraceEvent *event = &events[events_head % TRACE_RING_SIZE];
+  event->stage = stage;
+  event->start_us = start_us;
+  event->duration_us = end_us - start_us;
+  events_head++;
+  events_count++;
+}
+
+void Trace_Aggregate() {
+  while (events_count)
+    fold_oldest();
+}
+
+void Trace_Reset() {
+  events_head = 0;
+  events_count = 0;
+  memset(trace_histograms, 0, sizeof(trace_histograms));
+}
+
+unsigned char Trace_Bucket(unsigned long duration_us) {
+  unsigned char bucket = 0;
+  while (duration_us && bucket < TRACE_BUCKETS - 1) {
+    duration_us >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+unsigned long Trace_BucketFloor(const unsigned char bucket) {
+  return bucket ? 1UL << (bucket - 1) : 0;
+}
+
+const TraceHistogram *Trace_Histogram(const unsigned char stage) {
+  return &trace_histograms[stage];
+}
+
+const char *Trace_StageName(const unsigned char stage) {
+  return trace_stage_names[stage];
+}
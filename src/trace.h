@@ -0,0 +1,47 @@
+#ifndef COMMOTALKINO_SRC_TRACE_H_
+#define COMMOTALKINO_SRC_TRACE_H_
+
+// Hot path trace points. Every stage of a transmission or a reception is
+// recorded as a (stage, start, duration) event in microseconds into a small
+// ring, the ring is folded into one log2 histogram per stage when it fills up
+// or on Trace_Aggregate. Bucket b counts durations in [2^(b-1), 2^b) us, bucket
+// 0 the zero ones and the last bucket everything above. Nothing here depends
+// on the board, boards and simulations produce the same numbers.
+
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE 16 // a power of two
+#endif
+
+#define TRACE_BUCKETS 22
+
+enum TraceStage {
+  TRACE_MODE_SWITCH,
+  TRACE_AUX_WAIT,
+  TRACE_UART_WRITE,
+  TRACE_AIR_WAIT,
+  TRACE_UART_READ,
+  TRACE_STAGES
+};
+
+typedef struct TraceEvent {
+  unsigned char stage;
+  unsigned long start_us;
+  unsigned long duration_us;
+} TraceEvent;
+
+typedef struct TraceHistogram {
+  unsigned long count;
+  unsigned long max_us;
+  unsigned int buckets[TRACE_BUCKETS];
+} TraceHistogram;
+
+void Trace_Record(unsigned char stage, unsigned long start_us,
+                  unsigned long end_us);
+void Trace_Aggregate();
+void Trace_Reset();
+unsigned char Trace_Bucket(unsigned long duration_us);
+unsigned long Trace_BucketFloor(unsigned char bucket);
+const TraceHistogram *Trace_Histogram(unsigned char stage);
+const char *Trace_StageName(unsigned char stage);
+
+#endif // COMMOTALKINO_SRC_TRACE_H_
@@ -0,0 +1,88 @@
+#include "txqueue.h"
+#include <string.h>
+
+static int find_key(const TxQueue *queue, unsigned char priority,
+                    unsigned char key);
+static int find_next(const TxQueue *queue, int least_urgent);
+static void remove_at(TxQueue *queue, unsigned char index);
+
+void TxQueue_Init(TxQueue *queue) { memset(queue, 0, sizeof(*queue)); }
+
+// Returns 0 when the message itself is dropped.
+int TxQueue_Push(TxQueue *queue, const unsigned char priority,
+                 const unsigned char key, const unsigned char *body,
+                 const unsigned long now_ms) {
+  TxMessage *message;
+  if (TX_PRIORITIES <= priority)
+    return 0;
+  queue->pushed++;
+  const int same = TX_NO_KEY == key ? -1 : find_key(queue, priority, key);
+  if (0 <= same) {
+    message = &queue->messages[same];
+    message->queued_ms = now_ms;
+    memcpy(message->body, body, TX_QUEUE_BODY_LENGTH);
+    queue->coalesced++;
+    return 1;
+  }
+  if (TX_QUEUE_SIZE == queue->count) {
+    const int victim = find_next(queue, 1);
+    queue->dropped++;
+    if (queue->messages[victim].priority < priority)
+      return 0;
+    remove_at(queue, (unsigned char)victim);
+  }
+  message = &queue->messages[queue->count++];
+  message->priority = priority;
+  message->key = key;
+  message->queued_ms = now_ms;
+  memcpy(message->body, body, TX_QUEUE_BODY_LENGTH);
+  if (queue->high_water < queue->count)
+    queue->high_water = queue->count;
+  return 1;
+}
+
+int TxQueue_Pop(TxQueue *queue, TxMessage *message,
+                const unsigned long now_ms) {
+  if (!queue->count)
+    return 0;
+  const int next = find_next(queue, 0);
+  *message = queue->messages[next];
+  remove_at(queue, (unsigned char)next);
+  const unsigned long wait_ms = now_ms - message->queued_ms;
+  queue->wait_sum_ms += wait_ms;
+  if (queue->wait_max_ms[message->priority] < wait_ms)
+    queue->wait_max_ms[message->priority] = wait_ms;
+  queue->sent++;
+  return 1;
+}
+
+int find_key(const TxQueue *queue, const unsigned char priority,
+             const unsigned char key) {
+  unsigned char i;
+  for (i = 0; i < queue->count; i++) {
+    if (queue->messages[i].priority == priority &&
+        queue->messages[i].key == key)
+      return i;
+  }
+  return -1;
+}
+
+// The oldest message of the most urgent class queued, or of the least urgent
+// one. Call with a message in the queue.
+int find_next(const TxQueue *queue, const int least_urgent) {
+  unsigned char best = 0;
+  unsigned char i;
+  for (i = 1; i < queue->count; i++) {
+    const unsigned char priority = queue->messages[i].priority;
+    if (least_urgent ? queue->messages[best].priority < priority
+                     : priority < queue->messages[best].priority)
+      best = i;
+  }
+  return best;
+}
+
+void remove_at(TxQueue *queue, const unsigned char index) {
+  memmove(&queue->messages[index], &queue->messages[index + 1],
+          (queue->count - index - 1) * sizeof(queue->messages[0]));
+  queue->count--;
+}
@@ -0,0 +1,46 @@
+#ifndef COMMOTALKINO_SRC_TXQUEUE_H_
+#define COMMOTALKINO_SRC_TXQUEUE_H_
+
+// Bounded queue of outgoing messages in priority classes, for a node that
+// produces more than it gets to send. The most urgent class with anything
+// queued goes first, in order of arrival within a class. A message pushed
+// with a key replaces the queued one of the same class and key in place, so a
+// burst of updates of the same value takes one place and never waits behind
+// its own older copies; its wait counts from the newest value.
+//
+// A full queue makes room by dropping the oldest message of its least urgent
+// class, unless that class is more urgent than the new message, which is then
+// dropped instead. The depth, and with it the wait, stay bounded whatever the
+// load.
+
+#define TX_QUEUE_SIZE 8
+#define TX_QUEUE_BODY_LENGTH 3
+#define TX_NO_KEY 0
+
+enum TxPriority { TX_CONTROL, TX_ACK, TX_TELEMETRY, TX_PRIORITIES };
+
+typedef struct TxMessage {
+  unsigned char priority;
+  unsigned char key;
+  unsigned long queued_ms;
+  unsigned char body[TX_QUEUE_BODY_LENGTH];
+} TxMessage;
+
+typedef struct TxQueue {
+  TxMessage messages[TX_QUEUE_SIZE];
+  unsigned char count;
+  unsigned char high_water;
+  unsigned long pushed;
+  unsigned long sent;
+  unsigned long coalesced;
+  unsigned long dropped;
+  unsigned long wait_sum_ms;
+  unsigned long wait_max_ms[TX_PRIORITIES];
+} TxQueue;
+
+void TxQueue_Init(TxQueue *queue);
+int TxQueue_Push(TxQueue *queue, unsigned char priority, unsigned char key,
+                 const unsigned char *body, unsigned long now_ms);
+int TxQueue_Pop(TxQueue *queue, TxMessage *message, unsigned long now_ms);
+
+#endif // COMMOTALKINO_SRC_TXQUEUE_H_
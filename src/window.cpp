@@ -0,0 +1,177 @@
+#include "window.h"
+#include <string.h>
+
+#define SLOT_PENDING 0
+#define SLOT_SENT 1
+#define SLOT_LOST 2
+#define SLOT_ACKED 3
+
+static unsigned char slot_of(unsigned char seq);
+static unsigned char clamp_size(unsigned char size);
+static int is_due(const WindowSender *sender, unsigned char seq,
+                  unsigned long now_ms, unsigned long rto_ms);
+static int any_due(const WindowSender *sender, unsigned long now_ms,
+                   unsigned long rto_ms);
+
+unsigned char slot_of(const unsigned char seq) {
+  return seq & (WINDOW_MAX - 1);
+}
+
+unsigned char clamp_size(const unsigned char size) {
+  if (0 == size)
+    return 1;
+  return WINDOW_MAX < size ? WINDOW_MAX : size;
+}
+
+// -----------------------------------------------------------------------------
+// Sender
+
+void WindowSender_Init(WindowSender *sender, const unsigned char size) {
+  memset(sender, 0, sizeof(*sender));
+  sender->size = clamp_size(size);
+}
+
+unsigned char WindowSender_InFlight(const WindowSender *sender) {
+  return (unsigned char)(sender->next - sender->base);
+}
+
+int WindowSender_Queue(WindowSender *sender, const unsigned char *payload) {
+  if (sender->size <= WindowSender_InFlight(sender))
+    return 0;
+  const unsigned char slot = slot_of(sender->next++);
+  memcpy(sender->payload[slot], payload, WINDOW_PAYLOAD_LENGTH);
+  sender->state[slot] = SLOT_PENDING;
+  return 1;
+}
+
+int is_due(const WindowSender *sender, const unsigned char seq,
+           const unsigned long now_ms, const unsigned long rto_ms) {
+  const unsigned char slot = slot_of(seq);
+  switch (sender->state[slot]) {
+  case SLOT_PENDING:
+  case SLOT_LOST:
+    return 1;
+  case SLOT_SENT:
+    return rto_ms <= now_ms - sender->sent_ms[slot];
+  default:
+    return 0;
+  }
+}
+
+int any_due(const WindowSender *sender, const unsigned long now_ms,
+            const unsigned long rto_ms) {
+  unsigned char seq;
+  for (seq = sender->base; seq != sender->next; seq++) {
+    if (is_due(sender, seq, now_ms, rto_ms))
+      return 1;
+  }
+  return 0;
+}
+
+// Fills the frame with the oldest in-flight frame that has to go on air, the
+// last one before the window runs dry asks the receiver for an ACK.
+int WindowSender_Next(WindowSender *sender, WindowFrame *frame,
+                      const unsigned long now_ms, const unsigned long rto_ms) {
+  unsigned char seq;
+  for (seq = sender->base; seq != sender->next; seq++) {
+    if (is_due(sender, seq, now_ms, rto_ms))
+      break;
+  }
+  if (seq == sender->next)
+    return 0;
+  const unsigned char slot = slot_of(seq);
+  if (SLOT_PENDING != sender->state[slot])
+    sender->retransmissions++;
+  if (SLOT_SENT == sender->state[slot])
+    sender->expirations++;
+  sender->transmissions++;
+  sender->state[slot] = SLOT_SENT;
+  sender->sent_ms[slot] = now_ms;
+  frame->seq = seq;
+  frame->bits = 0;
+  memcpy(frame->payload, sender->payload[slot], WINDOW_PAYLOAD_LENGTH);
+  frame->kind =
+      any_due(sender, now_ms, rto_ms) ? WINDOW_DATA : WINDOW_DATA_LAST;
+  return 1;
+}
+
+// Returns how many frames the ACK confirms for the first time.
+unsigned char WindowSender_OnAck(WindowSender *sender, const WindowFrame *ack) {
+  unsigned char newly = 0;
+  unsigned char i;
+  int highest = -1;
+  if (WINDOW_ACK != ack->kind ||
+      WindowSender_InFlight(sender) < (unsigned char)(ack->seq - sender->base))
+    return 0;
+  while (sender->base != ack->seq) {
+    if (SLOT_ACKED != sender->state[slot_of(sender->base)])
+      newly++;
+    sender->base++;
+  }
+  for (i = 0; i < WINDOW_MAX - 1; i++) {
+    if (ack->bits & (1 << i))
+      highest = i;
+  }
+  for (i = 0; (int)i <= highest; i++) {
+    const unsigned char seq = (unsigned char)(ack->seq + 1 + i);
+    const unsigned char slot = slot_of(seq);
+    if (WindowSender_InFlight(sender) <= (unsigned char)(seq - sender->base))
+      break;
+    if (ack->bits & (1 << i)) {
+      if (SLOT_ACKED != sender->state[slot])
+        newly++;
+      sender->state[slot] = SLOT_ACKED;
+    } else if (SLOT_SENT == sender->state[slot]) {
+      sender->state[slot] = SLOT_LOST;
+    }
+  }
+  if (0 <= highest && SLOT_SENT == sender->state[slot_of(ack->seq)])
+    sender->state[slot_of(ack->seq)] = SLOT_LOST;
+  sender->acked += newly;
+  return newly;
+}
+
+// -----------------------------------------------------------------------------
+// Receiver
+
+void WindowReceiver_Init(WindowReceiver *receiver, const unsigned char size) {
+  memset(receiver, 0, sizeof(*receiver));
+  receiver->size = clamp_size(size);
+}
+
+// Delivers every frame that became in order and returns 1 when the sender
+// expects an ACK right away.
+int WindowReceiver_Push(WindowReceiver *receiver, const WindowFrame *frame,
+                        WindowDeliver deliver) {
+  if (WINDOW_DATA != frame->kind && WINDOW_DATA_LAST != frame->kind)
+    return 0;
+  const unsigned char offset = (unsigned char)(frame->seq - receiver->expected);
+  const unsigned char slot = slot_of(frame->seq);
+  receiver->ack_due = 1;
+  if (receiver->size <= offset || receiver->received[slot]) {
+    receiver->duplicates++;
+  } else {
+    memcpy(receiver->payload[slot], frame->payload, WINDOW_PAYLOAD_LENGTH);
+    receiver->received[slot] = 1;
+  }
+  while (receiver->received[slot_of(receiver->expected)]) {
+    const unsigned char next = slot_of(receiver->expected);
+    deliver(receiver->payload[next]);
+    receiver->received[next] = 0;
+    receiver->expected++;
+    receiver->delivered++;
+  }
+  return WINDOW_DATA_LAST == frame->kind;
+}
+
+void WindowReceiver_BuildAck(WindowReceiver *receiver, WindowFrame *ack) {
+  unsigned char i;
+  memset(ack, 0, sizeof(*ack));
+  ack->kind = WINDOW_ACK;
+  ack->seq = receiver->expected;
+  for (i = 0; i + 1 < receiver->size; i++) {
+    if (receiver->received[slot_of((unsigned char)(receiver->expected + 1 + i))])
+      ack->bits |= (unsigned char)(1 << i);
+  }
+  receiver->ack_due = 0;
+}
@@ -0,0 +1,64 @@
+#ifndef COMMOTALKINO_SRC_WINDOW_H_
+#define COMMOTALKINO_SRC_WINDOW_H_
+
+#include "../lib/CommoTalkie/messageconfig.h"
+
+// Sliding window on top of the CommoTalkie message body. The sender keeps up
+// to `size` frames in flight and flags the last one of every burst so the
+// receiver answers with a cumulative ACK: the next sequence it expects plus a
+// bitmap of the frames it already holds beyond it. Holes below a frame the
+// bitmap confirms are retransmitted straight away, anything else once its
+// retransmission timeout expires. Sequence numbers wrap at 256.
+
+#define WINDOW_MAX 8
+#define WINDOW_HEADER_LENGTH 3
+#define WINDOW_PAYLOAD_LENGTH (MESSAGE_BODY_LENGTH - WINDOW_HEADER_LENGTH)
+
+enum WindowKind { WINDOW_DATA = 1, WINDOW_DATA_LAST, WINDOW_ACK };
+
+typedef struct WindowFrame {
+  unsigned char kind;
+  unsigned char seq;
+  unsigned char bits;
+  unsigned char payload[WINDOW_PAYLOAD_LENGTH];
+} WindowFrame;
+
+typedef struct WindowSender {
+  unsigned char size;
+  unsigned char base;
+  unsigned char next;
+  unsigned char state[WINDOW_MAX];
+  unsigned long sent_ms[WINDOW_MAX];
+  unsigned char payload[WINDOW_MAX][WINDOW_PAYLOAD_LENGTH];
+  unsigned long transmissions;
+  unsigned long retransmissions;
+  unsigned long expirations;
+  unsigned long acked;
+} WindowSender;
+
+typedef struct WindowReceiver {
+  unsigned char size;
+  unsigned char expected;
+  unsigned char ack_due;
+  unsigned char received[WINDOW_MAX];
+  unsigned char payload[WINDOW_MAX][WINDOW_PAYLOAD_LENGTH];
+  unsigned long delivered;
+  unsigned long duplicates;
+} WindowReceiver;
+
+typedef void (*WindowDeliver)(const unsigned char *payload);
+
+void WindowSender_Init(WindowSender *sender, unsigned char size);
+int WindowSender_Queue(WindowSender *sender, const unsigned char *payload);
+int WindowSender_Next(WindowSender *sender, WindowFrame *frame,
+                      unsigned long now_ms, unsigned long rto_ms);
+unsigned char WindowSender_OnAck(WindowSender *sender,
+                                 const WindowFrame *ack);
+unsigned char WindowSender_InFlight(const WindowSender *sender);
+
+void WindowReceiver_Init(WindowReceiver *receiver, unsigned char size);
+int WindowReceiver_Push(WindowReceiver *receiver, const WindowFrame *frame,
+                        WindowDeliver deliver);
+void WindowReceiver_BuildAck(WindowReceiver *receiver, WindowFrame *ack);
+
+#endif // COMMOTALKINO_SRC_WINDOW_H_
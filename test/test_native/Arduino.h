@@ -0,0 +1,55 @@
+#ifndef COMMOTALKINO_TEST_NATIVE_ARDUINO_H_
+#define COMMOTALKINO_TEST_NATIVE_ARDUINO_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// The few Arduino calls of the modules under test, against a board the tests
+// set up and look at. Everything lives in the one test translation unit.
+
+// The host has one address space, a string "in flash" is a plain one.
+class __FlashStringHelper;
+#define F(text) (reinterpret_cast<const __FlashStringHelper *>(text))
+#define pgm_read_byte(address) (*(const unsigned char *)(address))
+#define strlen_P strlen
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define FAKE_PINS 32
+#define FAKE_SERIAL_SIZE 512
+
+typedef struct FakeBoard {
+  unsigned long micros;
+  uint8_t pins[FAKE_PINS];
+  unsigned long pin_writes;
+  int serial_room;
+  unsigned char serial_out[FAKE_SERIAL_SIZE];
+  unsigned int serial_length;
+} FakeBoard;
+
+static FakeBoard board;
+
+static inline unsigned long micros() { return board.micros; }
+
+static inline void digitalWrite(uint8_t pin, uint8_t value) {
+  board.pins[pin] = value;
+  board.pin_writes++;
+}
+
+static inline int digitalRead(uint8_t pin) { return board.pins[pin]; }
+
+class FakeSerial {
+public:
+  int availableForWrite() { return board.serial_room; }
+  size_t write(uint8_t value) {
+    if (board.serial_length < FAKE_SERIAL_SIZE)
+      board.serial_out[board.serial_length++] = value;
+    return 1;
+  }
+};
+
+static FakeSerial Serial;
+
+#endif // COMMOTALKINO_TEST_NATIVE_ARDUINO_H_
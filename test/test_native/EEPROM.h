@@ -0,0 +1,38 @@
+#ifndef COMMOTALKINO_TEST_NATIVE_EEPROM_H_
+#define COMMOTALKINO_TEST_NATIVE_EEPROM_H_
+
+#include "Arduino.h"
+
+// EEPROM of the fake board, the bytes and the writes that changed one of
+// them, as update() on the board.
+
+#define FAKE_EEPROM_SIZE 64
+
+class EEPROMClass {
+public:
+  uint8_t bytes[FAKE_EEPROM_SIZE];
+  unsigned long writes;
+
+  void update(int address, uint8_t value) {
+    if (bytes[address] == value)
+      return;
+    bytes[address] = value;
+    writes++;
+  }
+
+  template <typename T> T &get(int address, T &value) {
+    memcpy(&value, bytes + address, sizeof(T));
+    return value;
+  }
+
+  template <typename T> const T &put(int address, const T &value) {
+    const uint8_t *source = (const uint8_t *)&value;
+    for (size_t i = 0; i < sizeof(T); i++)
+      update(address + (int)i, source[i]);
+    return value;
+  }
+};
+
+static EEPROMClass EEPROM;
+
+#endif // COMMOTALKINO_TEST_NATIVE_EEPROM_H_
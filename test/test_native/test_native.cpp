@@ -0,0 +1,1025 @@
+// Host unit tests for the modules that do not depend on the radio, run with
+// `platformio test -e native`. The Arduino.h next to this file stands in for
+// the board of the few modules that use one.
+
+#include <unity.h>
+
+#include "../../src/batch.cpp"
+#include "../../src/bulk.cpp"
+#include "../../src/channelhop.cpp"
+#include "../../src/codec.cpp"
+#include "../../src/console.cpp"
+#include "../../src/energy.cpp"
+#include "../../src/fec.cpp"
+#include "../../src/framepool.cpp"
+#include "../../src/framereader.cpp"
+#include "../../src/handshake.cpp"
+#include "../../src/linkrate.cpp"
+#include "../../src/modepins.cpp"
+#include "../../src/radioconfig.cpp"
+#include "../../src/relay.cpp"
+#include "../../src/ringbuffer.cpp"
+#include "../../src/rtt.cpp"
+#include "../../src/scheduler.cpp"
+#include "../../src/tdma.cpp"
+#include "../../src/trace.cpp"
+#include "../../src/txqueue.cpp"
+#include "../../src/window.cpp"
+
+static unsigned char ring_storage[8];
+static RingBuffer ring;
+static FrameReader reader;
+static unsigned char delivered[16];
+static unsigned long delivered_count;
+
+static void collect(const unsigned char *payload) {
+  delivered[delivered_count++] = payload[0];
+}
+
+static unsigned char flushed[MESSAGE_BODY_LENGTH];
+
+static void keep_flushed(const unsigned char *body) {
+  memcpy(flushed, body, sizeof(flushed));
+  delivered_count++;
+}
+
+static unsigned char streamed[128];
+static unsigned long streamed_length;
+
+static void read_pattern(unsigned long offset, unsigned char *data,
+                         unsigned char length) {
+  unsigned char i;
+  for (i = 0; i < length; i++)
+    data[i] = (unsigned char)(offset + i) * 7;
+}
+
+static void read_other_pattern(unsigned long offset, unsigned char *data,
+                               unsigned char length) {
+  unsigned char i;
+  for (i = 0; i < length; i++)
+    data[i] = (unsigned char)(0xFF - offset - i);
+}
+
+static void keep_streamed(unsigned long offset, const unsigned char *data,
+                          unsigned char length) {
+  TEST_ASSERT_EQUAL(streamed_length, offset);
+  memcpy(streamed + offset, data, length);
+  streamed_length += length;
+}
+
+#define SENSOR_SCHEMA(FIELD)                                                   \
+  FIELD(DELTA, counter)                                                        \
+  FIELD(SIGNED, temperature)                                                   \
+  FIELD(UNSIGNED, millivolts)                                                  \
+  FIELD(FLAG, alarm)                                                           \
+  FIELD(FLAG, low_battery)
+CODEC_DEFINE(Sensor, SENSOR_SCHEMA)
+
+static unsigned long fake_us;
+static unsigned long sleeper_wakes;
+static unsigned long waiter_wakes;
+static unsigned long poller_done;
+static short poller_flag;
+
+static unsigned long fake_clock() { return fake_us; }
+
+// Takes 100 us of work every 5 ms.
+static void sleeper_task(Task *task) {
+  TASK_BEGIN(task);
+  for (;;) {
+    TASK_SLEEP(task, 5);
+    sleeper_wakes++;
+    fake_us += 100;
+  }
+  TASK_END(task);
+}
+
+static void waiter_task(Task *task) {
+  TASK_BEGIN(task);
+  for (;;) {
+    TASK_WAIT_EVENT(task, 0x01);
+    waiter_wakes++;
+  }
+  TASK_END(task);
+}
+
+static void poller_task(Task *task) {
+  TASK_BEGIN(task);
+  TASK_WAIT_UNTIL(task, poller_flag);
+  poller_done++;
+  TASK_END(task);
+}
+
+// -----------------------------------------------------------------------------
+
+void setUp(void) {
+  RingBuffer_Init(&ring, ring_storage, sizeof(ring_storage));
+  FrameReader_Init(&reader);
+  delivered_count = 0;
+}
+
+void tearDown(void) {}
+
+void test_ring_keeps_order() {
+  unsigned char value = 0;
+  RingBuffer_Push(&ring, 0x10);
+  RingBuffer_Push(&ring, 0x20);
+  TEST_ASSERT_EQUAL(2, RingBuffer_Count(&ring));
+  TEST_ASSERT_TRUE(RingBuffer_Pop(&ring, &value));
+  TEST_ASSERT_EQUAL_HEX8(0x10, value);
+  TEST_ASSERT_TRUE(RingBuffer_Pop(&ring, &value));
+  TEST_ASSERT_EQUAL_HEX8(0x20, value);
+  TEST_ASSERT_FALSE(RingBuffer_Pop(&ring, &value));
+}
+
+void test_ring_counts_overruns_and_high_water() {
+  unsigned char value;
+  int i;
+  for (i = 0; i < 10; i++)
+    RingBuffer_Push(&ring, (unsigned char)i);
+  TEST_ASSERT_EQUAL(7, RingBuffer_Count(&ring));
+  TEST_ASSERT_EQUAL(3, ring.overruns);
+  TEST_ASSERT_EQUAL(7, ring.high_water);
+  RingBuffer_Pop(&ring, &value);
+  TEST_ASSERT_EQUAL(0, value);
+  RingBuffer_Clear(&ring);
+  TEST_ASSERT_EQUAL(0, RingBuffer_Count(&ring));
+  TEST_ASSERT_EQUAL(7, ring.high_water);
+}
+
+void test_ring_wraps_around() {
+  unsigned char value = 0;
+  int i;
+  for (i = 0; i < 20; i++) {
+    TEST_ASSERT_TRUE(RingBuffer_Push(&ring, (unsigned char)i));
+    TEST_ASSERT_TRUE(RingBuffer_Pop(&ring, &value));
+    TEST_ASSERT_EQUAL(i, value);
+  }
+}
+
+void test_frame_completes_on_last_byte() {
+  const unsigned char frame[] = {1, 2, 3, 4};
+  unsigned long i;
+  for (i = 0; i < sizeof(frame) - 1; i++)
+    TEST_ASSERT_FALSE(FrameReader_Push(&reader, frame[i], sizeof(frame), i));
+  TEST_ASSERT_TRUE(FrameReader_Push(&reader, frame[i], sizeof(frame), i));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(frame, reader.buffer, sizeof(frame));
+  TEST_ASSERT_EQUAL(1, reader.frames);
+}
+
+void test_frame_resyncs_after_gap() {
+  const unsigned char frame[] = {5, 6, 7, 8};
+  unsigned long i;
+  FrameReader_Push(&reader, 0xEE, sizeof(frame), 0);
+  FrameReader_Push(&reader, 0xEE, sizeof(frame), 100);
+  for (i = 0; i < sizeof(frame); i++)
+    FrameReader_Push(&reader, frame[i], sizeof(frame), FRAME_GAP_US + 200 + i);
+  TEST_ASSERT_EQUAL(1, reader.frames);
+  TEST_ASSERT_EQUAL(2, reader.dropped);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(frame, reader.buffer, sizeof(frame));
+}
+
+void test_ready_token_round_trip() {
+  unsigned char frame[12];
+  unsigned char id = 0;
+  Handshake_BuildReady(frame, sizeof(frame), 7);
+  TEST_ASSERT_TRUE(Handshake_IsReady(frame, sizeof(frame), &id));
+  TEST_ASSERT_EQUAL_UINT8(7, id);
+  frame[3] ^= 1;
+  TEST_ASSERT_FALSE(Handshake_IsReady(frame, sizeof(frame), &id));
+}
+
+void test_window_retransmits_only_the_hole() {
+  WindowSender sender;
+  WindowReceiver receiver;
+  WindowFrame frame;
+  WindowFrame ack;
+  unsigned char payload[WINDOW_PAYLOAD_LENGTH] = {0};
+  unsigned char i;
+  WindowSender_Init(&sender, 4);
+  WindowReceiver_Init(&receiver, 4);
+  for (i = 0; i < 4; i++) {
+    payload[0] = i;
+    TEST_ASSERT_TRUE(WindowSender_Queue(&sender, payload));
+  }
+  TEST_ASSERT_FALSE(WindowSender_Queue(&sender, payload));
+  for (i = 0; WindowSender_Next(&sender, &frame, 0, 1000); i++) {
+    if (1 != frame.seq)
+      WindowReceiver_Push(&receiver, &frame, collect);
+  }
+  TEST_ASSERT_EQUAL(4, i);
+  TEST_ASSERT_EQUAL(WINDOW_DATA_LAST, frame.kind);
+  WindowReceiver_BuildAck(&receiver, &ack);
+  TEST_ASSERT_EQUAL(1, ack.seq);
+  TEST_ASSERT_EQUAL_HEX8(0x03, ack.bits);
+  TEST_ASSERT_EQUAL(3, WindowSender_OnAck(&sender, &ack));
+  TEST_ASSERT_TRUE(WindowSender_Next(&sender, &frame, 10, 1000));
+  TEST_ASSERT_EQUAL(1, frame.seq);
+  TEST_ASSERT_EQUAL(WINDOW_DATA_LAST, frame.kind);
+  TEST_ASSERT_FALSE(WindowSender_Next(&sender, &frame, 10, 1000));
+  TEST_ASSERT_TRUE(WindowReceiver_Push(&receiver, &frame, collect));
+  WindowReceiver_BuildAck(&receiver, &ack);
+  TEST_ASSERT_EQUAL(1, WindowSender_OnAck(&sender, &ack));
+  TEST_ASSERT_EQUAL(0, WindowSender_InFlight(&sender));
+  TEST_ASSERT_EQUAL(1, sender.retransmissions);
+  TEST_ASSERT_EQUAL(4, delivered_count);
+  for (i = 0; i < 4; i++)
+    TEST_ASSERT_EQUAL(i, delivered[i]);
+}
+
+void test_window_resends_after_timeout() {
+  WindowSender sender;
+  WindowFrame frame;
+  unsigned char payload[WINDOW_PAYLOAD_LENGTH] = {0};
+  WindowSender_Init(&sender, 2);
+  WindowSender_Queue(&sender, payload);
+  TEST_ASSERT_TRUE(WindowSender_Next(&sender, &frame, 0, 1000));
+  TEST_ASSERT_FALSE(WindowSender_Next(&sender, &frame, 999, 1000));
+  TEST_ASSERT_TRUE(WindowSender_Next(&sender, &frame, 1000, 1000));
+  TEST_ASSERT_EQUAL(0, frame.seq);
+  TEST_ASSERT_EQUAL(1, sender.retransmissions);
+}
+
+void test_batch_flushes_on_fill_and_iterates() {
+  Batch batch;
+  BatchIterator iterator;
+  BatchRecord record;
+  const unsigned char sample[2] = {0x12, 0x34};
+  const unsigned char status = 7;
+  Batch_Init(&batch, 6, 100, keep_flushed);
+  TEST_ASSERT_TRUE(Batch_Add(&batch, BATCH_SAMPLE, sample, 2, 0));
+  TEST_ASSERT_TRUE(Batch_Add(&batch, BATCH_STATUS, &status, 1, 0));
+  TEST_ASSERT_EQUAL(0, delivered_count);
+  TEST_ASSERT_TRUE(Batch_Add(&batch, BATCH_STATUS, &status, 1, 0));
+  TEST_ASSERT_EQUAL(1, delivered_count);
+  TEST_ASSERT_EQUAL(2, batch.length);
+  BatchIterator_Init(&iterator, flushed, 6);
+  TEST_ASSERT_TRUE(BatchIterator_Next(&iterator, &record));
+  TEST_ASSERT_EQUAL(BATCH_SAMPLE, record.type);
+  TEST_ASSERT_EQUAL(2, record.length);
+  TEST_ASSERT_EQUAL_PTR(flushed + 1, record.value);
+  TEST_ASSERT_TRUE(BatchIterator_Next(&iterator, &record));
+  TEST_ASSERT_EQUAL(BATCH_STATUS, record.type);
+  TEST_ASSERT_EQUAL(7, record.value[0]);
+  TEST_ASSERT_FALSE(BatchIterator_Next(&iterator, &record));
+}
+
+void test_batch_flushes_on_deadline() {
+  Batch batch;
+  const unsigned char status = 1;
+  Batch_Init(&batch, 6, 100, keep_flushed);
+  TEST_ASSERT_FALSE(Batch_Add(&batch, BATCH_COUNTER, flushed, 6, 0));
+  Batch_Add(&batch, BATCH_STATUS, &status, 1, 50);
+  Batch_Poll(&batch, 149);
+  TEST_ASSERT_EQUAL(0, delivered_count);
+  Batch_Poll(&batch, 150);
+  TEST_ASSERT_EQUAL(1, delivered_count);
+  TEST_ASSERT_EQUAL_HEX8(0, flushed[2]);
+}
+
+void test_fec_rebuilds_one_loss_per_class_without_asking() {
+  FecSender sender;
+  FecReceiver receiver;
+  FecFrame frames[6];
+  unsigned char payload[FEC_PAYLOAD_LENGTH];
+  unsigned char i;
+  FecSender_Init(&sender, 4, 2);
+  FecReceiver_Init(&receiver, 4, 2);
+  for (i = 0; i < 6; i++) {
+    memset(payload, 0x10 + i, sizeof(payload));
+    if (!FecSender_Parity(&sender, &frames[i]))
+      FecSender_Data(&sender, payload, &frames[i]);
+    TEST_ASSERT_EQUAL(i, frames[i].index);
+  }
+  TEST_ASSERT_EQUAL(1, sender.group);
+  TEST_ASSERT_EQUAL_HEX8(0x10 ^ 0x12, frames[4].payload[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x11 ^ 0x13, frames[5].payload[0]);
+  FecReceiver_Push(&receiver, &frames[0], collect);
+  FecReceiver_Push(&receiver, &frames[3], collect);
+  TEST_ASSERT_EQUAL(1, delivered_count);
+  FecReceiver_Push(&receiver, &frames[4], collect);
+  FecReceiver_Push(&receiver, &frames[5], collect);
+  FecReceiver_Close(&receiver, collect);
+  TEST_ASSERT_EQUAL(4, delivered_count);
+  for (i = 0; i < 4; i++)
+    TEST_ASSERT_EQUAL_HEX8(0x10 + i, delivered[i]);
+  TEST_ASSERT_EQUAL(2, receiver.rebuilt);
+  TEST_ASSERT_EQUAL(0, receiver.lost);
+  for (i = 0; i < 6; i++) {
+    memset(payload, 0x20 + i, sizeof(payload));
+    if (!FecSender_Parity(&sender, &frames[i]))
+      FecSender_Data(&sender, payload, &frames[i]);
+  }
+  FecReceiver_Push(&receiver, &frames[1], collect);
+  FecReceiver_Push(&receiver, &frames[3], collect);
+  FecReceiver_Push(&receiver, &frames[4], collect);
+  FecReceiver_Push(&receiver, &frames[5], collect);
+  frames[0].group++;
+  FecReceiver_Push(&receiver, &frames[0], collect);
+  TEST_ASSERT_EQUAL(2, receiver.lost);
+  TEST_ASSERT_EQUAL(7, delivered_count);
+  TEST_ASSERT_EQUAL_HEX8(0x21, delivered[4]);
+  TEST_ASSERT_EQUAL_HEX8(0x20, delivered[6]);
+  FecReceiver_Push(&receiver, &frames[2], collect);
+  TEST_ASSERT_EQUAL(7, delivered_count);
+}
+
+void test_rtt_tracks_the_link_within_bounds() {
+  RttEstimator rtt;
+  int i;
+  Rtt_Init(&rtt, 6000, 100, 6000);
+  TEST_ASSERT_EQUAL(6000, Rtt_Timeout(&rtt));
+  Rtt_Sample(&rtt, 200);
+  TEST_ASSERT_EQUAL(600, Rtt_Timeout(&rtt));
+  for (i = 0; i < 50; i++)
+    Rtt_Sample(&rtt, 200);
+  TEST_ASSERT_EQUAL(200, Rtt_Smoothed(&rtt));
+  TEST_ASSERT_EQUAL(300, Rtt_Timeout(&rtt));
+  Rtt_Backoff(&rtt);
+  TEST_ASSERT_EQUAL(600, Rtt_Timeout(&rtt));
+  for (i = 0; i < 10; i++)
+    Rtt_Backoff(&rtt);
+  TEST_ASSERT_EQUAL(6000, Rtt_Timeout(&rtt));
+}
+
+void test_trace_folds_the_ring_into_log2_buckets() {
+  int i;
+  Trace_Reset();
+  TEST_ASSERT_EQUAL(0, Trace_Bucket(0));
+  TEST_ASSERT_EQUAL(1, Trace_Bucket(1));
+  TEST_ASSERT_EQUAL(11, Trace_Bucket(1024));
+  TEST_ASSERT_EQUAL(11, Trace_Bucket(2047));
+  TEST_ASSERT_EQUAL(TRACE_BUCKETS - 1, Trace_Bucket(0xFFFFFFFFUL));
+  TEST_ASSERT_EQUAL(1024, Trace_BucketFloor(11));
+  for (i = 0; i < TRACE_RING_SIZE + 4; i++)
+    Trace_Record(TRACE_AIR_WAIT, 100, 1600);
+  Trace_Record(TRACE_UART_WRITE, 0UL - 0x100, 0x100);
+  TEST_ASSERT_EQUAL(5, Trace_Histogram(TRACE_AIR_WAIT)->count);
+  Trace_Aggregate();
+  TEST_ASSERT_EQUAL(TRACE_RING_SIZE + 4, Trace_Histogram(TRACE_AIR_WAIT)->count);
+  TEST_ASSERT_EQUAL(TRACE_RING_SIZE + 4,
+                    Trace_Histogram(TRACE_AIR_WAIT)->buckets[11]);
+  TEST_ASSERT_EQUAL(0x200, Trace_Histogram(TRACE_UART_WRITE)->max_us);
+}
+
+void test_link_rate_switches_together_and_falls_back() {
+  LinkRate ping;
+  LinkRate pong;
+  unsigned char command;
+  LinkRate_Init(&ping, 1, 2, 5, 2, 2, 0);
+  LinkRate_Init(&pong, 0, 2, 5, 2, 2, 0);
+  LinkRate_Success(&ping, 9);
+  TEST_ASSERT_EQUAL_HEX8(0, LinkRate_Command(&ping));
+  LinkRate_Success(&ping, 9);
+  command = LinkRate_Command(&ping);
+  TEST_ASSERT_EQUAL_HEX8(LINK_RATE_PROPOSE | 3, command);
+  LinkRate_Handle(&pong, command);
+  command = LinkRate_Command(&pong);
+  TEST_ASSERT_EQUAL_HEX8(LINK_RATE_CONFIRM | 3, command);
+  TEST_ASSERT_EQUAL(3, LinkRate_Take(&pong, 100));
+  LinkRate_Handle(&ping, command);
+  TEST_ASSERT_EQUAL(LINK_RATE_KEEP, LinkRate_Take(&pong, 100));
+  TEST_ASSERT_EQUAL(3, LinkRate_Take(&ping, 100));
+  TEST_ASSERT_EQUAL(100, LinkRate_Elapsed(&ping, 2, 400));
+  TEST_ASSERT_EQUAL(300, LinkRate_Elapsed(&ping, 3, 400));
+  LinkRate_Success(&ping, 9);
+  LinkRate_Success(&ping, 9);
+  TEST_ASSERT_EQUAL_HEX8(LINK_RATE_PROPOSE | 4, LinkRate_Command(&ping));
+  LinkRate_Timeout(&ping);
+  TEST_ASSERT_EQUAL(LINK_RATE_KEEP, LinkRate_Take(&ping, 500));
+  LinkRate_Timeout(&ping);
+  TEST_ASSERT_EQUAL(2, LinkRate_Take(&ping, 600));
+  TEST_ASSERT_EQUAL(3, ping.ceiling);
+  TEST_ASSERT_EQUAL(1, ping.fallbacks);
+  TEST_ASSERT_EQUAL(2, ping.stats[3].hits);
+  TEST_ASSERT_EQUAL(2, ping.stats[3].timeouts);
+}
+
+void test_channel_hop_moves_both_ends_and_searches() {
+  ChannelHop ping;
+  ChannelHop pong;
+  unsigned char command;
+  unsigned char seen = 0;
+  unsigned char index;
+  ChannelHop_Init(&ping, 1, 0x90, 0xB1, 8, 4, 2, 3);
+  ChannelHop_Init(&pong, 0, 0x90, 0xB1, 8, 4, 2, 3);
+  for (index = 0; index < 4; index++)
+    seen |= 1 << (ChannelHop_Channel(&ping, index) - 8);
+  TEST_ASSERT_EQUAL_HEX8(0x0F, seen);
+  TEST_ASSERT_EQUAL(9, ChannelHop_Channel(&pong, 0));
+  ChannelHop_Timeout(&ping);
+  TEST_ASSERT_EQUAL_HEX8(0, ChannelHop_Command(&ping));
+  ChannelHop_Success(&ping);
+  ChannelHop_Timeout(&ping);
+  command = ChannelHop_Command(&ping);
+  TEST_ASSERT_EQUAL_HEX8(CHANNEL_HOP_PROPOSE | 1, command);
+  ChannelHop_Handle(&pong, command);
+  command = ChannelHop_Command(&pong);
+  TEST_ASSERT_EQUAL_HEX8(CHANNEL_HOP_CONFIRM | 1, command);
+  TEST_ASSERT_EQUAL(8, ChannelHop_Take(&pong));
+  ChannelHop_Handle(&ping, command);
+  TEST_ASSERT_EQUAL(8, ChannelHop_Take(&ping));
+  TEST_ASSERT_EQUAL(CHANNEL_HOP_KEEP, ChannelHop_Take(&ping));
+  ChannelHop_Timeout(&ping);
+  ChannelHop_Timeout(&ping);
+  TEST_ASSERT_EQUAL(CHANNEL_HOP_KEEP, ChannelHop_Take(&ping));
+  ChannelHop_Timeout(&ping);
+  TEST_ASSERT_EQUAL(ChannelHop_Channel(&ping, 2), ChannelHop_Take(&ping));
+  TEST_ASSERT_EQUAL(1, ping.searches);
+  TEST_ASSERT_EQUAL(2, ping.hops);
+  ChannelHop_Timeout(&pong);
+  ChannelHop_Timeout(&pong);
+  ChannelHop_Timeout(&pong);
+  TEST_ASSERT_EQUAL(CHANNEL_HOP_KEEP, ChannelHop_Take(&pong));
+}
+
+void test_energy_charges_every_state_its_time() {
+  EnergyMeter meter;
+  Energy_Init(&meter, 1000, 100);
+  Energy_Radio(&meter, ENERGY_RADIO_WOR, 200);
+  Energy_Mcu(&meter, ENERGY_MCU_SLEEP, 300);
+  Energy_Radio(&meter, ENERGY_RADIO_TX, 1000);
+  Energy_Mcu(&meter, ENERGY_MCU_ACTIVE, 1100);
+  Energy_Charge(&meter, 1100);
+  TEST_ASSERT_EQUAL(200, meter.mcu_ms[ENERGY_MCU_ACTIVE]);
+  TEST_ASSERT_EQUAL(800, meter.mcu_ms[ENERGY_MCU_SLEEP]);
+  TEST_ASSERT_EQUAL(100, meter.radio_ms[ENERGY_RADIO_RX]);
+  TEST_ASSERT_EQUAL(800, meter.radio_ms[ENERGY_RADIO_WOR]);
+  TEST_ASSERT_EQUAL(100, meter.radio_ms[ENERGY_RADIO_TX]);
+  TEST_ASSERT_EQUAL(ENERGY_UA_RADIO_RX, Energy_WorMicroamps(2));
+  TEST_ASSERT_EQUAL((ENERGY_UA_RADIO_RX * ENERGY_WOR_LISTEN_MS +
+                     ENERGY_UA_RADIO_SLEEP * (1000 - ENERGY_WOR_LISTEN_MS)) /
+                        1000,
+                    Energy_WorMicroamps(1000));
+  TEST_ASSERT_EQUAL(
+      (200UL * ENERGY_UA_MCU_ACTIVE + 800UL * ENERGY_UA_MCU_SLEEP +
+       100UL * ENERGY_UA_RADIO_RX + 100UL * ENERGY_UA_RADIO_TX +
+       800UL * Energy_WorMicroamps(1000)) /
+          1000,
+      (unsigned long)Energy_AverageMicroamps(&meter));
+}
+
+void test_tdma_grants_slots_and_takes_them_back() {
+  TdmaCoordinator coordinator;
+  TdmaLeaf leaf;
+  TdmaBeacon beacon;
+  unsigned char body[MESSAGE_BODY_LENGTH];
+  unsigned long at = 0;
+  TdmaCoordinator_Init(&coordinator, 70, 2);
+  TdmaLeaf_Init(&leaf, 0x11);
+  TEST_ASSERT_EQUAL(0, TdmaLeaf_Plan(&leaf, 0, &at));
+  TdmaCoordinator_Beacon(&coordinator, 1000, &beacon);
+  Tdma_EncodeBeacon(&beacon, body);
+  TEST_ASSERT_TRUE(Tdma_DecodeBeacon(body, &beacon));
+  TEST_ASSERT_EQUAL(0, beacon.slots);
+  TEST_ASSERT_EQUAL(1000, beacon.time_ms);
+  TdmaLeaf_Beacon(&leaf, &beacon, 1020);
+  TEST_ASSERT_EQUAL(-20, leaf.offset_ms);
+  TEST_ASSERT_EQUAL(0, TdmaLeaf_Plan(&leaf, 1, &at));
+  TEST_ASSERT_EQUAL(TDMA_JOIN, TdmaLeaf_Plan(&leaf, 2, &at));
+  TEST_ASSERT_EQUAL(1020, at);
+  TdmaCoordinator_Receive(&coordinator, TDMA_JOIN, 0x22);
+  TdmaCoordinator_Receive(&coordinator, TDMA_JOIN, 0x11);
+  TdmaCoordinator_Beacon(&coordinator, 1070, &beacon);
+  TEST_ASSERT_EQUAL(2, beacon.slots);
+  TEST_ASSERT_EQUAL_HEX8(0x22, beacon.grant_id);
+  TdmaLeaf_Beacon(&leaf, &beacon, 1090);
+  TEST_ASSERT_EQUAL(TDMA_NO_SLOT, leaf.slot);
+  TEST_ASSERT_EQUAL(2, leaf.backoff);
+  TdmaCoordinator_Beacon(&coordinator, 1280, &beacon);
+  TdmaLeaf_Beacon(&leaf, &beacon, 1300);
+  TEST_ASSERT_EQUAL(2, leaf.slot);
+  TEST_ASSERT_EQUAL(1510, TdmaLeaf_NextBeacon(&leaf));
+  TEST_ASSERT_EQUAL(TDMA_DATA, TdmaLeaf_Plan(&leaf, 0xFF, &at));
+  TEST_ASSERT_EQUAL(1440, at);
+  TdmaCoordinator_Receive(&coordinator, TDMA_DATA, 0x11);
+  TdmaLeaf_Leave(&leaf);
+  TEST_ASSERT_EQUAL(TDMA_LEAVE, TdmaLeaf_Plan(&leaf, 0xFF, &at));
+  TdmaCoordinator_Receive(&coordinator, TDMA_LEAVE, 0x11);
+  TEST_ASSERT_EQUAL(1, TdmaCoordinator_Members(&coordinator));
+  TdmaCoordinator_Beacon(&coordinator, 1490, &beacon);
+  TdmaLeaf_Beacon(&leaf, &beacon, 1511);
+  TEST_ASSERT_EQUAL(TDMA_NO_SLOT, leaf.slot);
+  TEST_ASSERT_EQUAL(1, leaf.sync_error_max_ms);
+  TdmaCoordinator_Beacon(&coordinator, 1640, &beacon);
+  TdmaCoordinator_Beacon(&coordinator, 1780, &beacon);
+  TEST_ASSERT_EQUAL(0, TdmaCoordinator_Members(&coordinator));
+  TEST_ASSERT_EQUAL(1, coordinator.expirations);
+  TEST_ASSERT_EQUAL(0, beacon.slots);
+}
+
+void test_relay_learns_routes_and_forwards_once() {
+  Relay sink;
+  Relay middle;
+  Relay leaf;
+  RelayFrame frame;
+  RelayFrame copy;
+  unsigned char body[MESSAGE_BODY_LENGTH];
+  const unsigned char payload[RELAY_PAYLOAD_LENGTH] = {1, 2, 3, 4};
+  unsigned char next_hop = 0;
+  Relay_Init(&sink, 0xAA, 0);
+  Relay_Init(&middle, 0x21, 1);
+  Relay_Init(&leaf, 0xBB, 2);
+  TEST_ASSERT_EQUAL_HEX8(RELAY_NEIGHBOURS,
+                         Relay_Originate(&sink, &frame, RELAY_BEACON,
+                                         RELAY_EVERYONE, 0, 100));
+  Relay_Encode(&frame, body);
+  Relay_Decode(body, &frame);
+  TEST_ASSERT_EQUAL(RELAY_BEACON, frame.kind);
+  copy = frame;
+  TEST_ASSERT_EQUAL(RELAY_FORWARD,
+                    Relay_Handle(&middle, &frame, &next_hop, 110));
+  TEST_ASSERT_EQUAL_HEX8(RELAY_NEIGHBOURS, next_hop);
+  TEST_ASSERT_EQUAL(1, frame.hops);
+  TEST_ASSERT_EQUAL(1, frame.from);
+  TEST_ASSERT_EQUAL(RELAY_DROP, Relay_Handle(&middle, &copy, &next_hop, 120));
+  TEST_ASSERT_EQUAL(1, middle.duplicates);
+  Relay_Handle(&leaf, &frame, &next_hop, 130);
+  TEST_ASSERT_EQUAL(1, Relay_Route(&leaf, 0xAA, 130)->next_hop);
+  TEST_ASSERT_EQUAL(2, Relay_Route(&leaf, 0xAA, 130)->hops);
+  TEST_ASSERT_EQUAL(1, Relay_Originate(&leaf, &frame, RELAY_DATA, 0xAA,
+                                       payload, 140));
+  TEST_ASSERT_EQUAL(RELAY_FORWARD,
+                    Relay_Handle(&middle, &frame, &next_hop, 150));
+  TEST_ASSERT_EQUAL(0, next_hop);
+  TEST_ASSERT_EQUAL(RELAY_DELIVER, Relay_Handle(&sink, &frame, &next_hop, 160));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(payload, frame.payload, RELAY_PAYLOAD_LENGTH);
+  TEST_ASSERT_EQUAL(2, Relay_Route(&sink, 0xBB, 160)->hops);
+  TEST_ASSERT_NULL(Relay_Route(&sink, 0xBB, 160 + RELAY_ROUTE_MS));
+  Relay_Originate(&leaf, &frame, RELAY_DATA, 0x99, payload, 170);
+  frame.hops = RELAY_MAX_HOPS - 1;
+  TEST_ASSERT_EQUAL(RELAY_DROP, Relay_Handle(&middle, &frame, &next_hop, 180));
+  TEST_ASSERT_EQUAL(1, middle.hop_limited);
+}
+
+void test_bulk_streams_in_order_and_resends_only_the_nacked() {
+  static BulkSender sender;
+  static BulkReceiver receiver;
+  BulkFrame frame;
+  unsigned char expected[100];
+  unsigned int sent = 0;
+  read_pattern(0, expected, sizeof(expected));
+  streamed_length = 0;
+  BulkSender_Init(&sender);
+  BulkReceiver_Init(&receiver, 0, 0, keep_streamed);
+  TEST_ASSERT_TRUE(BulkSender_Start(&sender, sizeof(expected), read_pattern));
+  TEST_ASSERT_FALSE(BulkSender_Start(&sender, 10, read_pattern));
+  TEST_ASSERT_TRUE(BulkSender_Next(&sender, &frame));
+  TEST_ASSERT_TRUE(BulkReceiver_Push(&receiver, &frame));
+  TEST_ASSERT_FALSE(BulkSender_Next(&sender, &frame));
+  BulkReceiver_BuildStatus(&receiver, &frame);
+  TEST_ASSERT_EQUAL(0, BulkSender_OnStatus(&sender, &frame));
+  while (BulkSender_Next(&sender, &frame)) {
+    if (2 != frame.index[0])
+      BulkReceiver_Push(&receiver, &frame);
+    sent++;
+  }
+  TEST_ASSERT_EQUAL(BULK_WINDOW, sent);
+  TEST_ASSERT_EQUAL_HEX8(BULK_DATA_LAST | sender.transfer, frame.kind);
+  TEST_ASSERT_EQUAL(2 * BULK_CHUNK_LENGTH, streamed_length);
+  BulkReceiver_BuildStatus(&receiver, &frame);
+  TEST_ASSERT_EQUAL(2, frame.index[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x1F, frame.data[0]);
+  TEST_ASSERT_EQUAL(2 * BULK_CHUNK_LENGTH,
+                    BulkSender_OnStatus(&sender, &frame));
+  TEST_ASSERT_TRUE(BulkSender_Next(&sender, &frame));
+  TEST_ASSERT_EQUAL(2, frame.index[0]);
+  TEST_ASSERT_EQUAL(1, sender.retransmissions);
+  BulkReceiver_Push(&receiver, &frame);
+  TEST_ASSERT_EQUAL(BULK_WINDOW * BULK_CHUNK_LENGTH, streamed_length);
+  TEST_ASSERT_TRUE(BulkSender_Next(&sender, &frame));
+  TEST_ASSERT_EQUAL(8, frame.index[0]);
+  BulkReceiver_Push(&receiver, &frame);
+  while (BulkSender_Busy(&sender)) {
+    while (BulkSender_Next(&sender, &frame))
+      BulkReceiver_Push(&receiver, &frame);
+    BulkReceiver_BuildStatus(&receiver, &frame);
+    BulkSender_OnStatus(&sender, &frame);
+  }
+  TEST_ASSERT_EQUAL(BULK_COMPLETE, sender.result);
+  TEST_ASSERT_EQUAL(1, sender.retransmissions);
+  TEST_ASSERT_EQUAL(sizeof(expected), streamed_length);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, streamed, sizeof(expected));
+  TEST_ASSERT_EQUAL(0, receiver.duplicates);
+}
+
+void test_bulk_restarts_for_a_sender_that_rebooted() {
+  static BulkSender sender;
+  static BulkReceiver receiver;
+  BulkFrame frame;
+  unsigned char expected[40];
+  read_other_pattern(0, expected, sizeof(expected));
+  streamed_length = 0;
+  BulkSender_Init(&sender);
+  BulkReceiver_Init(&receiver, 0, 0, keep_streamed);
+  BulkSender_Start(&sender, 100, read_pattern);
+  while (BulkSender_Busy(&sender)) {
+    while (BulkSender_Next(&sender, &frame))
+      BulkReceiver_Push(&receiver, &frame);
+    BulkReceiver_BuildStatus(&receiver, &frame);
+    BulkSender_OnStatus(&sender, &frame);
+  }
+  TEST_ASSERT_EQUAL(BULK_COMPLETE, sender.result);
+
+  // Numbered 1 again after the reboot, like the transfer just completed.
+  streamed_length = 0;
+  BulkSender_Init(&sender);
+  BulkSender_Start(&sender, sizeof(expected), read_other_pattern);
+  TEST_ASSERT_EQUAL(receiver.transfer, sender.transfer);
+  TEST_ASSERT_TRUE(BulkSender_Next(&sender, &frame));
+  TEST_ASSERT_TRUE(BulkReceiver_Push(&receiver, &frame));
+  BulkReceiver_BuildStatus(&receiver, &frame);
+  TEST_ASSERT_EQUAL(0, frame.index[0]);
+  TEST_ASSERT_EQUAL(BULK_OPEN, frame.data[1]);
+  BulkSender_OnStatus(&sender, &frame);
+  TEST_ASSERT_TRUE(BulkSender_Next(&sender, &frame));
+  BulkReceiver_Push(&receiver, &frame);
+
+  // A START sent again after a timeout keeps what the receiver holds.
+  BulkSender_Init(&sender);
+  BulkSender_Start(&sender, sizeof(expected), read_other_pattern);
+  BulkSender_Next(&sender, &frame);
+  BulkReceiver_Push(&receiver, &frame);
+  BulkReceiver_BuildStatus(&receiver, &frame);
+  TEST_ASSERT_EQUAL(1, frame.index[0]);
+  BulkSender_OnStatus(&sender, &frame);
+  while (BulkSender_Busy(&sender)) {
+    while (BulkSender_Next(&sender, &frame))
+      BulkReceiver_Push(&receiver, &frame);
+    BulkReceiver_BuildStatus(&receiver, &frame);
+    BulkSender_OnStatus(&sender, &frame);
+  }
+  TEST_ASSERT_EQUAL(BULK_COMPLETE, sender.result);
+  TEST_ASSERT_EQUAL(sizeof(expected), streamed_length);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, streamed, sizeof(expected));
+}
+
+void test_bulk_fills_the_buffer_and_probes_after_timeout() {
+  static BulkSender sender;
+  static BulkReceiver receiver;
+  BulkFrame frame;
+  unsigned char buffer[20];
+  unsigned char expected[20];
+  read_pattern(0, expected, sizeof(expected));
+  BulkSender_Init(&sender);
+  BulkReceiver_Init(&receiver, buffer, 10, 0);
+  BulkSender_Start(&sender, sizeof(buffer), read_pattern);
+  BulkSender_Next(&sender, &frame);
+  BulkReceiver_Push(&receiver, &frame);
+  BulkReceiver_BuildStatus(&receiver, &frame);
+  BulkSender_OnStatus(&sender, &frame);
+  TEST_ASSERT_EQUAL(BULK_REFUSED, sender.result);
+  TEST_ASSERT_FALSE(BulkSender_Busy(&sender));
+  BulkReceiver_Init(&receiver, buffer, sizeof(buffer), 0);
+  BulkSender_Start(&sender, sizeof(buffer), read_pattern);
+  BulkSender_Next(&sender, &frame);
+  BulkSender_Timeout(&sender);
+  TEST_ASSERT_TRUE(BulkSender_Next(&sender, &frame));
+  TEST_ASSERT_EQUAL_HEX8(BULK_START, frame.kind & 0xF0);
+  BulkReceiver_Push(&receiver, &frame);
+  BulkReceiver_BuildStatus(&receiver, &frame);
+  BulkSender_OnStatus(&sender, &frame);
+  while (BulkSender_Next(&sender, &frame)) {
+    if (BULK_DATA == (frame.kind & 0xF0))
+      BulkReceiver_Push(&receiver, &frame);
+  }
+  BulkSender_Timeout(&sender);
+  TEST_ASSERT_TRUE(BulkSender_Next(&sender, &frame));
+  TEST_ASSERT_EQUAL(3, frame.index[0]);
+  TEST_ASSERT_TRUE(BulkReceiver_Push(&receiver, &frame));
+  TEST_ASSERT_FALSE(BulkSender_Next(&sender, &frame));
+  BulkSender_Timeout(&sender);
+  BulkSender_Next(&sender, &frame);
+  TEST_ASSERT_TRUE(BulkReceiver_Push(&receiver, &frame));
+  BulkReceiver_BuildStatus(&receiver, &frame);
+  TEST_ASSERT_EQUAL(sizeof(buffer), BulkSender_OnStatus(&sender, &frame));
+  TEST_ASSERT_EQUAL(BULK_COMPLETE, sender.result);
+  TEST_ASSERT_EQUAL(3, sender.timeouts);
+  TEST_ASSERT_EQUAL(1, receiver.duplicates);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, buffer, sizeof(buffer));
+}
+
+void test_scheduler_wakes_on_time_and_events_and_times_it() {
+  static Scheduler scheduler;
+  fake_us = 0;
+  sleeper_wakes = 0;
+  waiter_wakes = 0;
+  poller_done = 0;
+  poller_flag = 0;
+  Scheduler_Init(&scheduler, fake_clock);
+  Task *sleeper = Scheduler_Add(&scheduler, sleeper_task, "sleeper");
+  Task *waiter = Scheduler_Add(&scheduler, waiter_task, "waiter");
+  Task *poller = Scheduler_Add(&scheduler, poller_task, "poller");
+  TEST_ASSERT_EQUAL(2, Scheduler_RunOnce(&scheduler));
+  Scheduler_Signal(&scheduler, 0x02);
+  fake_us = 4000;
+  TEST_ASSERT_EQUAL(0, Scheduler_RunOnce(&scheduler));
+  Scheduler_Signal(&scheduler, 0x01);
+  fake_us = 4500;
+  TEST_ASSERT_EQUAL(1, Scheduler_RunOnce(&scheduler));
+  TEST_ASSERT_EQUAL(1, waiter_wakes);
+  TEST_ASSERT_EQUAL_HEX8(0x01, waiter->events);
+  TEST_ASSERT_EQUAL(TASK_WAITING, waiter->state);
+  fake_us = 5200;
+  poller_flag = 1;
+  TEST_ASSERT_EQUAL(2, Scheduler_RunOnce(&scheduler));
+  TEST_ASSERT_EQUAL(1, sleeper_wakes);
+  TEST_ASSERT_EQUAL(10200, sleeper->due_us);
+  TEST_ASSERT_EQUAL(TASK_DONE, poller->state);
+  TEST_ASSERT_EQUAL(0, Scheduler_RunOnce(&scheduler));
+  TEST_ASSERT_EQUAL(1, poller_done);
+  TEST_ASSERT_EQUAL(200, sleeper->max_late_us);
+  TEST_ASSERT_EQUAL(100, sleeper->max_run_us);
+  TEST_ASSERT_EQUAL(500, Scheduler_MaxLateUs(&scheduler));
+  TEST_ASSERT_EQUAL_HEX8(0x02, scheduler.events);
+  TEST_ASSERT_EQUAL(100, scheduler.busy_us);
+  TEST_ASSERT_EQUAL(
+      980, (unsigned long)(1000 * Scheduler_IdleShare(&scheduler, 5000) + 0.5));
+  while (scheduler.count < SCHEDULER_TASKS)
+    TEST_ASSERT_NOT_NULL(Scheduler_Add(&scheduler, poller_task, "more"));
+  TEST_ASSERT_NULL(Scheduler_Add(&scheduler, poller_task, "full"));
+}
+
+void test_tx_queue_coalesces_and_sends_the_urgent_first() {
+  static TxQueue queue;
+  TxMessage message;
+  unsigned char body[TX_QUEUE_BODY_LENGTH] = {1, 0, 0};
+  unsigned char i;
+  TxQueue_Init(&queue);
+  TxQueue_Push(&queue, TX_TELEMETRY, 7, body, 0);
+  body[0] = 2;
+  TxQueue_Push(&queue, TX_ACK, TX_NO_KEY, body, 5);
+  body[0] = 3;
+  TxQueue_Push(&queue, TX_TELEMETRY, 7, body, 10);
+  body[0] = 4;
+  TxQueue_Push(&queue, TX_CONTROL, TX_NO_KEY, body, 20);
+  TEST_ASSERT_EQUAL(3, queue.count);
+  TEST_ASSERT_EQUAL(1, queue.coalesced);
+  TEST_ASSERT_TRUE(TxQueue_Pop(&queue, &message, 30));
+  TEST_ASSERT_EQUAL(4, message.body[0]);
+  TEST_ASSERT_TRUE(TxQueue_Pop(&queue, &message, 30));
+  TEST_ASSERT_EQUAL(2, message.body[0]);
+  TEST_ASSERT_TRUE(TxQueue_Pop(&queue, &message, 40));
+  TEST_ASSERT_EQUAL(3, message.body[0]);
+  TEST_ASSERT_EQUAL(30, queue.wait_max_ms[TX_TELEMETRY]);
+  TEST_ASSERT_EQUAL(25, queue.wait_max_ms[TX_ACK]);
+  TEST_ASSERT_FALSE(TxQueue_Pop(&queue, &message, 40));
+
+  for (i = 0; i < TX_QUEUE_SIZE; i++) {
+    body[0] = i;
+    TxQueue_Push(&queue, TX_TELEMETRY, TX_NO_KEY, body, 100);
+  }
+  TEST_ASSERT_TRUE(TxQueue_Push(&queue, TX_CONTROL, TX_NO_KEY, body, 100));
+  TEST_ASSERT_EQUAL(TX_QUEUE_SIZE, queue.count);
+  TEST_ASSERT_EQUAL(1, queue.dropped);
+  TEST_ASSERT_TRUE(TxQueue_Pop(&queue, &message, 100));
+  TEST_ASSERT_EQUAL(TX_CONTROL, message.priority);
+  TEST_ASSERT_TRUE(TxQueue_Pop(&queue, &message, 100));
+  TEST_ASSERT_EQUAL(1, message.body[0]);
+  while (queue.count < TX_QUEUE_SIZE)
+    TxQueue_Push(&queue, TX_CONTROL, TX_NO_KEY, body, 100);
+  while (TX_TELEMETRY == queue.messages[0].priority)
+    TxQueue_Push(&queue, TX_CONTROL, TX_NO_KEY, body, 100);
+  TEST_ASSERT_FALSE(
+      TxQueue_Push(&queue, TX_TELEMETRY, TX_NO_KEY, body, 100));
+  TEST_ASSERT_EQUAL(TX_QUEUE_SIZE, queue.high_water);
+}
+
+void test_frame_pool_hands_frames_over_and_refuses_misuse() {
+  static FramePool pool;
+  Frame *pulled;
+  Frame *served;
+  FramePool_Init(&pool);
+  pulled = FramePool_Take(&pool, FRAME_PULL);
+  TEST_ASSERT_NOT_NULL(pulled);
+  pulled->body[0] = 7;
+  TEST_ASSERT_TRUE(FramePool_Hand(&pool, pulled, FRAME_PULL, FRAME_APP));
+  TEST_ASSERT_FALSE(FramePool_Hand(&pool, pulled, FRAME_PULL, FRAME_PUBLISH));
+  TEST_ASSERT_EQUAL(1, pool.misuse);
+  TEST_ASSERT_EQUAL(FRAME_APP, FramePool_Owner(&pool, pulled));
+  TEST_ASSERT_EQUAL(7, pulled->body[0]);
+
+  served = FramePool_Take(&pool, FRAME_APP);
+  TEST_ASSERT_NOT_NULL(served);
+  TEST_ASSERT_TRUE(pulled != served);
+  TEST_ASSERT_NULL(FramePool_Take(&pool, FRAME_PULL));
+  TEST_ASSERT_EQUAL(1, pool.exhausted);
+  TEST_ASSERT_EQUAL(FRAME_POOL_SIZE, pool.high_water);
+
+  TEST_ASSERT_TRUE(FramePool_Hand(&pool, pulled, FRAME_APP, FRAME_PUBLISH));
+  TEST_ASSERT_TRUE(FramePool_Release(&pool, pulled, FRAME_PUBLISH));
+  TEST_ASSERT_FALSE(FramePool_Release(&pool, pulled, FRAME_PUBLISH));
+  TEST_ASSERT_EQUAL(2, pool.misuse);
+  TEST_ASSERT_EQUAL(1, pool.in_use);
+  pulled = FramePool_Take(&pool, FRAME_PULL);
+  TEST_ASSERT_NOT_NULL(pulled);
+  TEST_ASSERT_EQUAL(0, pulled->body[0]);
+  TEST_ASSERT_EQUAL(3, pool.takes);
+}
+
+void test_console_drops_whole_messages_and_drains_in_order() {
+  char line[101];
+  unsigned char tail[49];
+  ConsoleStats stats;
+  memset(&board, 0, sizeof(board));
+  memset(line, 'x', sizeof(line) - 1);
+  line[sizeof(line) - 1] = '\0';
+  memset(tail, 'y', sizeof(tail));
+  Console_Begin();
+  TEST_ASSERT_TRUE(Console_Print(line));
+  TEST_ASSERT_TRUE(Console_Print(line));
+  TEST_ASSERT_FALSE(Console_Print(line));
+  TEST_ASSERT_TRUE(Console_Write((const unsigned char *)"ab", 2));
+  TEST_ASSERT_EQUAL(206, Console_Pending());
+  TEST_ASSERT_TRUE(Console_Write(tail, sizeof(tail)));
+  TEST_ASSERT_FALSE(Console_Write(tail, 1));
+  stats = Console_Stats();
+  TEST_ASSERT_EQUAL(2, stats.dropped);
+  TEST_ASSERT_EQUAL(CONSOLE_TX_SIZE - 1, stats.high_water);
+  TEST_ASSERT_EQUAL(0, board.serial_length);
+
+  board.serial_room = 64;
+  Console_Drain();
+  TEST_ASSERT_EQUAL(64, board.serial_length);
+  TEST_ASSERT_EQUAL(CONSOLE_TX_SIZE - 1 - 64, Console_Pending());
+  Console_Flush();
+  TEST_ASSERT_EQUAL(CONSOLE_TX_SIZE - 1, board.serial_length);
+  TEST_ASSERT_EQUAL(0, Console_Pending());
+  TEST_ASSERT_EQUAL('x', board.serial_out[99]);
+  TEST_ASSERT_EQUAL('\r', board.serial_out[100]);
+  TEST_ASSERT_EQUAL('\n', board.serial_out[101]);
+  TEST_ASSERT_EQUAL('a', board.serial_out[204]);
+  TEST_ASSERT_EQUAL('y', board.serial_out[206]);
+  TEST_ASSERT_TRUE(Console_Print(line));
+  TEST_ASSERT_EQUAL(2, Console_Stats().dropped);
+
+  Console_Flush();
+  board.serial_length = 0;
+  TEST_ASSERT_TRUE(Console_PrintFlash(F("I am Ping")));
+  Console_Flush();
+  TEST_ASSERT_EQUAL(11, board.serial_length);
+  TEST_ASSERT_EQUAL_MEMORY("I am Ping\r\n", board.serial_out, 11);
+}
+
+void test_mode_pins_switch_once_and_mask_aux_while_settling() {
+  ModePinsStats stats;
+  memset(&board, 0, sizeof(board));
+  ModePins_Begin(7, 6);
+  TEST_ASSERT_TRUE(ModePins_Apply());
+  TEST_ASSERT_EQUAL(0, ModePins_Mode());
+  TEST_ASSERT_EQUAL(2, board.pin_writes);
+  board.micros = MODE_SETTLE_US;
+  TEST_ASSERT_EQUAL(HIGH, ModePins_Aux(HIGH));
+
+  // M0 waits for M1, both go out together, sleep without wake up in between.
+  ModePins_Latch(7, HIGH);
+  TEST_ASSERT_EQUAL(2, board.pin_writes);
+  TEST_ASSERT_EQUAL(LOW, board.pins[7]);
+  ModePins_Latch(6, HIGH);
+  board.micros = 1000;
+  TEST_ASSERT_TRUE(ModePins_Apply());
+  TEST_ASSERT_EQUAL(4, board.pin_writes);
+  TEST_ASSERT_EQUAL(HIGH, board.pins[7]);
+  TEST_ASSERT_EQUAL(HIGH, board.pins[6]);
+  TEST_ASSERT_EQUAL(3, ModePins_Mode());
+  TEST_ASSERT_FALSE(ModePins_Apply());
+  TEST_ASSERT_EQUAL(4, board.pin_writes);
+
+  // AUX still HIGH from before the switch is not the end of it.
+  board.micros = 1000 + MODE_SETTLE_US - 1;
+  TEST_ASSERT_EQUAL(LOW, ModePins_Aux(HIGH));
+  board.micros = 1000 + MODE_SETTLE_US + 200;
+  TEST_ASSERT_EQUAL(LOW, ModePins_Aux(LOW));
+  board.micros = 1000 + MODE_SETTLE_US + 300;
+  TEST_ASSERT_EQUAL(HIGH, ModePins_Aux(HIGH));
+  stats = ModePins_Stats();
+  TEST_ASSERT_EQUAL(2, stats.switches);
+  TEST_ASSERT_EQUAL(MODE_SETTLE_US + 300, stats.latency_max_us);
+
+  // The driver's NORMAL mapped to power saving for listening.
+  ModePins_Latch(7, LOW);
+  ModePins_Latch(6, LOW);
+  ModePins_MapNormal(LOW, HIGH);
+  TEST_ASSERT_TRUE(ModePins_Apply());
+  TEST_ASSERT_EQUAL(2, ModePins_Mode());
+  TEST_ASSERT_EQUAL(LOW, board.pins[7]);
+  TEST_ASSERT_EQUAL(HIGH, board.pins[6]);
+}
+
+void test_radio_config_round_trips_and_rejects_corrupt_records() {
+  const unsigned char check[] = "123456789";
+  const unsigned char stored[RADIO_CONFIG_LENGTH] = {0xC0, 0x70, 0xA1,
+                                                     0x1A, 0x10, 0x44};
+  unsigned char loaded[RADIO_CONFIG_LENGTH];
+  unsigned char i;
+  // CRC-8/SMBUS, polynomial 0x07 from zero.
+  TEST_ASSERT_EQUAL(0xF4, RadioConfig_Crc8(check, sizeof(check) - 1));
+  TEST_ASSERT_EQUAL(0, RadioConfig_Crc8(check, 0));
+
+  memset(EEPROM.bytes, 0xFF, sizeof(EEPROM.bytes));
+  EEPROM.writes = 0;
+  TEST_ASSERT_FALSE(RadioConfig_Load(loaded));
+  RadioConfig_Store(stored);
+  TEST_ASSERT_EQUAL(RADIO_CONFIG_MAGIC, EEPROM.bytes[RADIO_CONFIG_ADDRESS]);
+  memset(loaded, 0, sizeof(loaded));
+  TEST_ASSERT_TRUE(RadioConfig_Load(loaded));
+  TEST_ASSERT_EQUAL_MEMORY(stored, loaded, sizeof(stored));
+  const unsigned long writes = EEPROM.writes;
+  RadioConfig_Store(stored);
+  TEST_ASSERT_EQUAL(writes, EEPROM.writes);
+
+  // Every single bit flipped, in the magic, the block or the CRC, is caught
+  // and leaves the block alone.
+  for (i = 0; i < (RADIO_CONFIG_LENGTH + 2) * 8; i++) {
+    EEPROM.bytes[RADIO_CONFIG_ADDRESS + i / 8] ^= 1 << (i % 8);
+    memset(loaded, 0xAA, sizeof(loaded));
+    TEST_ASSERT_FALSE(RadioConfig_Load(loaded));
+    TEST_ASSERT_EQUAL(0xAA, loaded[0]);
+    EEPROM.bytes[RADIO_CONFIG_ADDRESS + i / 8] ^= 1 << (i % 8);
+  }
+  TEST_ASSERT_TRUE(RadioConfig_Load(loaded));
+
+  // A torn write: the new block in, the old CRC still behind it.
+  EEPROM.bytes[RADIO_CONFIG_ADDRESS + 4] = 0x1C;
+  TEST_ASSERT_FALSE(RadioConfig_Load(loaded));
+}
+
+void test_codec_packs_a_schema_against_its_reference() {
+  SensorRecord reference;
+  SensorRecord record;
+  SensorRecord decoded;
+  unsigned char out[16];
+  uint32_t value;
+  memset(&reference, 0, sizeof(reference));
+  record.counter = 1000;
+  record.temperature = -5;
+  record.millivolts = 3300;
+  record.alarm = 1;
+  record.low_battery = 0;
+  TEST_ASSERT_EQUAL(6, Sensor_Encode(&record, &reference, out, sizeof(out)));
+  TEST_ASSERT_EQUAL_HEX8(0x01, out[0]);
+  TEST_ASSERT_EQUAL(6, Sensor_Decode(out, 6, &reference, &decoded));
+  TEST_ASSERT_EQUAL(1000, decoded.counter);
+  TEST_ASSERT_EQUAL(-5, decoded.temperature);
+  TEST_ASSERT_EQUAL(3300, decoded.millivolts);
+  TEST_ASSERT_EQUAL(1, decoded.alarm);
+  TEST_ASSERT_EQUAL(0, decoded.low_battery);
+  reference = record;
+  record.counter = 1001;
+  record.temperature = -6;
+  record.alarm = 0;
+  record.low_battery = 1;
+  TEST_ASSERT_EQUAL(5, Sensor_Encode(&record, &reference, out, sizeof(out)));
+  TEST_ASSERT_EQUAL(0, Sensor_Encode(&record, &reference, out, 4));
+  TEST_ASSERT_EQUAL(0, Sensor_Decode(out, 4, &reference, &decoded));
+  TEST_ASSERT_EQUAL(5, Sensor_Decode(out, 5, &reference, &decoded));
+  TEST_ASSERT_EQUAL(1001, decoded.counter);
+  TEST_ASSERT_EQUAL(-6, decoded.temperature);
+  TEST_ASSERT_EQUAL(1, decoded.low_battery);
+  reference.counter = 0xFFFFFFFFUL;
+  record.counter = 0;
+  TEST_ASSERT_EQUAL(5, Sensor_Encode(&record, &reference, out, sizeof(out)));
+  TEST_ASSERT_EQUAL(0x02, out[1]);
+  TEST_ASSERT_EQUAL(5, Codec_PutVarint(out, sizeof(out), 0xFFFFFFFFUL));
+  TEST_ASSERT_EQUAL(5, Codec_GetVarint(out, 5, &value));
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFUL, value);
+  TEST_ASSERT_EQUAL(0, Codec_GetVarint(out, 4, &value));
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFUL, Codec_ZigZag(INT32_MIN));
+  TEST_ASSERT_EQUAL(INT32_MIN, Codec_UnZigZag(0xFFFFFFFFUL));
+  TEST_ASSERT_EQUAL(INT32_MAX, Codec_UnZigZag(Codec_ZigZag(INT32_MAX)));
+}
+
+// -----------------------------------------------------------------------------
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_ring_keeps_order);
+  RUN_TEST(test_ring_counts_overruns_and_high_water);
+  RUN_TEST(test_ring_wraps_around);
+  RUN_TEST(test_frame_completes_on_last_byte);
+  RUN_TEST(test_frame_resyncs_after_gap);
+  RUN_TEST(test_ready_token_round_trip);
+  RUN_TEST(test_window_retransmits_only_the_hole);
+  RUN_TEST(test_window_resends_after_timeout);
+  RUN_TEST(test_batch_flushes_on_fill_and_iterates);
+  RUN_TEST(test_batch_flushes_on_deadline);
+  RUN_TEST(test_bulk_streams_in_order_and_resends_only_the_nacked);
+  RUN_TEST(test_bulk_fills_the_buffer_and_probes_after_timeout);
+  RUN_TEST(test_bulk_restarts_for_a_sender_that_rebooted);
+  RUN_TEST(test_rtt_tracks_the_link_within_bounds);
+  RUN_TEST(test_scheduler_wakes_on_time_and_events_and_times_it);
+  RUN_TEST(test_trace_folds_the_ring_into_log2_buckets);
+  RUN_TEST(test_link_rate_switches_together_and_falls_back);
+  RUN_TEST(test_channel_hop_moves_both_ends_and_searches);
+  RUN_TEST(test_codec_packs_a_schema_against_its_reference);
+  RUN_TEST(test_energy_charges_every_state_its_time);
+  RUN_TEST(test_fec_rebuilds_one_loss_per_class_without_asking);
+  RUN_TEST(test_tdma_grants_slots_and_takes_them_back);
+  RUN_TEST(test_relay_learns_routes_and_forwards_once);
+  RUN_TEST(test_tx_queue_coalesces_and_sends_the_urgent_first);
+  RUN_TEST(test_frame_pool_hands_frames_over_and_refuses_misuse);
+  RUN_TEST(test_console_drops_whole_messages_and_drains_in_order);
+  RUN_TEST(test_mode_pins_switch_once_and_mask_aux_while_settling);
+  RUN_TEST(test_radio_config_round_trips_and_rejects_corrupt_records);
+  return UNITY_END();
+}
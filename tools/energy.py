@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""Energy budget of a node for every wake up period of the E32.
+
+Takes the currents of src/energy.h and prints, per WOR_TIMING, the latency of
+a frame and the mAh per day of the node that sends and of the node that
+listens, next to a node that keeps the radio in normal mode and the MCU awake.
+
+A frame to a module in power saving goes out after a preamble as long as the
+wake up period, so the latency and the transmit time grow with the period
+while the listen current drops.
+
+Usage:
+    tools/energy.py [--interval S] [--bps N] [--bytes N]
+"""
+
+import argparse
+import os
+import re
+
+ENERGY_HEADER = os.path.join(os.path.dirname(__file__), "..", "src", "energy.h")
+DAY_S = 86400
+# Active MCU time around a frame besides the air time: UART, mode switches.
+FRAME_OVERHEAD_MS = 10
+
+
+def load_currents(path):
+    with open(path) as header:
+        source = header.read()
+    return {name: int(value) for name, value in
+            re.findall(r"#define ENERGY_(\w+) (\d+)", source)}
+
+
+def wor_microamps(c, period_ms):
+    listen = c["WOR_LISTEN_MS"]
+    if period_ms <= listen:
+        return c["UA_RADIO_RX"]
+    return (c["UA_RADIO_RX"] * listen +
+            c["UA_RADIO_SLEEP"] * (period_ms - listen)) / period_ms
+
+
+def mah_per_day(c, frames, active_ms, tx_ms, rx_ms, idle_radio_ua):
+    """Charge of a day with frames events of the given lengths each."""
+    day_ms = DAY_S * 1000.0
+    busy = frames * (tx_ms + rx_ms)
+    mcu = (frames * active_ms * c["UA_MCU_ACTIVE"] +
+           (day_ms - frames * active_ms) * c["UA_MCU_SLEEP"])
+    radio = (frames * tx_ms * c["UA_RADIO_TX"] +
+             frames * rx_ms * c["UA_RADIO_RX"] +
+             (day_ms - busy) * idle_radio_ua)
+    return (mcu + radio) / day_ms * 24 / 1000
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--interval", type=float, default=600,
+                        help="seconds between two frames, 600 by default")
+    parser.add_argument("--bps", type=int, default=2400,
+                        help="air data rate, 2400 by default")
+    parser.add_argument("--bytes", type=int, default=12,
+                        help="frame length on air, 12 by default")
+    args = parser.parse_args()
+    c = load_currents(ENERGY_HEADER)
+    frames = DAY_S / args.interval
+    air_ms = args.bytes * 8 * 1000.0 / args.bps
+
+    print("| WOR_TIMING | Wake up ms | Latency ms | Sender mAh/day "
+          "| Listener mAh/day |")
+    awake_ms = DAY_S * 1000.0
+    always_on = mah_per_day(c, frames, awake_ms / frames, air_ms, 0,
+                            c["UA_RADIO_RX"])
+    listening = mah_per_day(c, frames, awake_ms / frames, 0, air_ms,
+                            c["UA_RADIO_RX"])
+    print("| %10s | %10s | %10.0f | %14.2f | %16.2f |" %
+          ("always on", "-", air_ms, always_on, listening))
+    for timing in range(8):
+        period = 250 * (timing + 1)
+        tx_ms = period + air_ms
+        idle = wor_microamps(c, period)
+        # The listener hears the preamble from a random point in it.
+        rx_ms = period / 2.0 + air_ms
+        sender = mah_per_day(c, frames, tx_ms + FRAME_OVERHEAD_MS, tx_ms, 0,
+                             idle)
+        listener = mah_per_day(c, frames, rx_ms + FRAME_OVERHEAD_MS, 0, rx_ms,
+                               idle)
+        print("| %10d | %10d | %10.0f | %14.2f | %16.2f |" %
+              (timing, period, tx_ms, sender, listener))
+
+
+if __name__ == "__main__":
+    main()
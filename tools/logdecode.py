@@ -0,0 +1,71 @@
+#!/usr/bin/env python3
+"""Turns the binary log records of a console capture back into text.
+
+The firmware writes every enabled log call as LOG_SYNC, message id, value
+length and the value bytes, see src/log.h. Text printed around the records
+goes through untouched.
+
+Usage:
+    tools/logdecode.py [capture]    reads stdin without a capture file
+"""
+
+import os
+import re
+import sys
+
+LOG_HEADER = os.path.join(os.path.dirname(__file__), "..", "src", "log.h")
+LOG_SYNC = 0xA7
+
+
+def load_messages(path):
+    with open(path) as header:
+        source = header.read()
+    return re.findall(r'X\(\w+,\s*"([^"]*)"\)', source)
+
+
+def format_record(messages, message_id, value):
+    if message_id < len(messages):
+        title = messages[message_id]
+    else:
+        title = "Unknown message %d" % message_id
+    if not value:
+        return title
+    return "%s: |%s|" % (title, "|".join("%X" % byte for byte in value))
+
+
+def decode(data, messages, out):
+    text = bytearray()
+    position = 0
+    while position < len(data):
+        byte = data[position]
+        if LOG_SYNC != byte:
+            text.append(byte)
+            position += 1
+            if ord("\n") == byte:
+                out.write(text.decode("ascii", "replace"))
+                text = bytearray()
+            continue
+        if len(data) < position + 3:
+            break
+        message_id, size = data[position + 1], data[position + 2]
+        value = data[position + 3:position + 3 + size]
+        if len(value) < size:
+            break
+        out.write(format_record(messages, message_id, value) + "\n")
+        position += 3 + size
+    out.write(text.decode("ascii", "replace"))
+
+
+def main(argv):
+    messages = load_messages(LOG_HEADER)
+    if 1 < len(argv):
+        with open(argv[1], "rb") as capture:
+            data = capture.read()
+    else:
+        data = sys.stdin.buffer.read()
+    decode(bytearray(data), messages, sys.stdout)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
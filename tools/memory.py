@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""Static RAM and flash of an AVR build, module by module.
+
+Reads the sizes of the symbols the linker kept in the ELF and gives each one
+to the object file that defines it, a module of src/, a library or the
+Arduino core. On the AVR code lives in flash, .bss in RAM, and .data, with
+the constant tables that are not PROGMEM, in both: RAM at run time and flash
+for its initial values. What is left of the RAM budget is the room of the
+stack; how deep it gets is measured at run time by stack painting, sending
+'m' to the console, see src/memory.h.
+
+As a PlatformIO extra script, extra_scripts = post:tools/memory.py, it
+prints the table after every link of the environment.
+
+Usage:
+    tools/memory.py ELF [BUILD_DIR] [--nm avr-nm]
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+
+FLASH_BYTES = 32256  # 32 KB less the 512 byte bootloader
+RAM_BYTES = 2048
+FLASH_TYPES = "tTwW"
+DATA_TYPES = "dDrR"
+BSS_TYPES = "bB"
+
+
+def read_symbols(nm, path):
+    """(type, name, size) of every defined symbol with a size."""
+    output = subprocess.check_output(
+        [nm, "--defined-only", "--print-size", path],
+        universal_newlines=True, stderr=subprocess.DEVNULL)
+    symbols = []
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) != 4:
+            continue
+        symbols.append((fields[2], fields[3], int(fields[1], 16)))
+    return symbols
+
+
+def module_of(path, build_dir):
+    relative = os.path.relpath(path, build_dir)
+    name = os.path.splitext(os.path.basename(relative))[0]
+    parts = relative.split(os.sep)
+    if "FrameworkArduino" in parts:
+        return "core"
+    if parts[0] == "src":
+        return os.path.splitext(name)[0]
+    if 2 < len(parts) and parts[0].startswith("lib"):
+        return parts[1]
+    return os.path.splitext(name)[0]
+
+
+def index_objects(nm, build_dir):
+    """Maps a symbol, by name and by name and size, to its modules."""
+    by_name = {}
+    by_size = {}
+    for root, _, files in os.walk(build_dir):
+        for file in files:
+            if not file.endswith(".o"):
+                continue
+            path = os.path.join(root, file)
+            module = module_of(path, build_dir)
+            for _, name, size in read_symbols(nm, path):
+                by_name.setdefault(name, set()).add(module)
+                by_size.setdefault((name, size), set()).add(module)
+    return by_name, by_size
+
+
+def attribute(name, size, by_name, by_size):
+    """A static of the same name in two modules goes by its size as well."""
+    for modules in (by_size.get((name, size)), by_name.get(name)):
+        if modules and len(modules) == 1:
+            return next(iter(modules))
+    return "other"
+
+
+def budget(nm, elf, build_dir):
+    by_name, by_size = (index_objects(nm, build_dir) if build_dir
+                        else ({}, {}))
+    modules = {}
+    for kind, name, size in read_symbols(nm, elf):
+        module = attribute(name, size, by_name, by_size)
+        flash, ram = modules.get(module, (0, 0))
+        if kind in FLASH_TYPES:
+            flash += size
+        elif kind in DATA_TYPES:
+            flash += size
+            ram += size
+        elif kind in BSS_TYPES:
+            ram += size
+        modules[module] = (flash, ram)
+    return modules
+
+
+def print_budget(modules, out):
+    out.write("%-22s %8s %8s\n" % ("Module", "Flash", "RAM"))
+    flash_total = ram_total = 0
+    for module, (flash, ram) in sorted(modules.items(),
+                                       key=lambda item: -item[1][1]):
+        if not flash and not ram:
+            continue
+        out.write("%-22s %8d %8d\n" % (module, flash, ram))
+        flash_total += flash
+        ram_total += ram
+    out.write("%-22s %8d %8d\n" % ("Total", flash_total, ram_total))
+    out.write("%-22s %7.1f%% %7.1f%%\n" % (
+        "Of the budget", 100.0 * flash_total / FLASH_BYTES,
+        100.0 * ram_total / RAM_BYTES))
+    out.write("Left for the stack: %d bytes, measure its peak with 'm'\n" %
+              (RAM_BYTES - ram_total))
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("elf")
+    parser.add_argument("build_dir", nargs="?",
+                        help="where the object files are, default next to "
+                        "the ELF")
+    parser.add_argument("--nm", default="avr-nm")
+    args = parser.parse_args()
+    build_dir = args.build_dir or os.path.dirname(os.path.abspath(args.elf))
+    print_budget(budget(args.nm, args.elf, build_dir), sys.stdout)
+
+
+def post_link(target, source, env):
+    elf = str(target[0])
+    nm = env.WhereIs("avr-nm") or "avr-nm"
+    print_budget(budget(nm, elf, env.subst("$BUILD_DIR")), sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
+else:
+    try:
+        Import("env")  # noqa: F821, PlatformIO's SCons defines both
+    except NameError:
+        env = None
+    if env is not None:
+        env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", post_link)
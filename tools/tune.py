@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""Sweeps the timing constants of the ping pong against a lossy channel.
+
+Builds the host simulator once per combination of the swept constants, runs
+the real ping pong of src/main.cpp on a simulated E32 with the given air time
+per byte, loss, burst loss and turnaround delay, for every seed, and prints
+the hits per minute against the failure rate, the share of pulls that timed
+out. Combinations no other one beats on both are marked with a star.
+
+The best one, the most hits per minute of the starred ones under
+--max-failure, is written with --export as a header to build with:
+
+    tools/tune.py --loss 5 --burst 2:4 --export src/tuned.h
+    PLATFORMIO_BUILD_FLAGS="-D TUNED=1" pio run
+
+The sweep runs with the defaults of the build, without the readiness
+handshake and the adaptive rate, where the fixed delays are used. --flags
+adds build flags to every run.
+
+Usage:
+    tools/tune.py [--sweep NAME=V1,V2,...]... [--seconds S] [--seeds N]
+                  [--loss PERCENT] [--burst PERCENT:LENGTH]
+                  [--air-byte-us N] [--turnaround MS] [--flags FLAGS]
+                  [--max-failure R] [--export PATH] [--jobs N]
+"""
+
+import argparse
+import concurrent.futures
+import itertools
+import os
+import re
+import shutil
+import subprocess
+import tempfile
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+BUILD = "pio run -e native"
+PROGRAM = os.path.join(".pio", "build", "native", "program")
+FLAGS = ""
+# The defaults of src/main.h and src/config.h, swept or not, all go into the
+# exported header.
+DEFAULTS = [
+    ("PULL_TIMEOUT", [1500, 3000, 6000]),
+    ("LET_HER_PREPARE_DELAY", [10, 30, 100]),
+    ("PING_PONG_INTERVAL", [500, 2000]),
+    ("MODE_TIMEOUT", [2000]),
+    ("SERIAL_TIMEOUT", [5000]),
+    ("RETRY_INTERVAL", [30000]),
+]
+REPORT = re.compile(r"\[node\d+\] Pulls: (\d+) Received: (\d+) Timeouts: (\d+)")
+
+
+def parse_sweep(items):
+    sweep = [(name, list(values)) for name, values in DEFAULTS]
+    for item in items:
+        name, _, values = item.partition("=")
+        parsed = [int(value) for value in values.split(",") if value]
+        if not parsed:
+            raise SystemExit("Invalid sweep: %s" % item)
+        for entry in sweep:
+            if entry[0] == name:
+                entry[1][:] = parsed
+                break
+        else:
+            sweep.append((name, parsed))
+    return sweep
+
+
+def build(config, flags, command, program, directory, index):
+    defines = " ".join("-D %s=%d" % item for item in config)
+    env = dict(os.environ, PLATFORMIO_BUILD_FLAGS="%s %s" % (flags, defines))
+    subprocess.run(command, shell=True, cwd=ROOT, env=env, check=True,
+                   stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    copy = os.path.join(directory, "program%d" % index)
+    shutil.copy(os.path.join(ROOT, program), copy)
+    return copy
+
+
+def simulate(program, seed, args):
+    command = [program, "--seconds", str(args.seconds), "--seed", str(seed),
+               "--loss", str(args.loss)]
+    if args.burst:
+        command += ["--burst", args.burst]
+    if args.air_byte_us:
+        command += ["--air-byte-us", str(args.air_byte_us)]
+    if args.turnaround:
+        command += ["--turnaround", str(args.turnaround)]
+    output = subprocess.run(command, cwd=ROOT, stdout=subprocess.PIPE,
+                            stderr=subprocess.DEVNULL, check=False,
+                            universal_newlines=True).stdout
+    pulls = received = timeouts = 0
+    for match in REPORT.finditer(output):
+        pulls += int(match.group(1))
+        received += int(match.group(2))
+        timeouts += int(match.group(3))
+    return pulls, received, timeouts
+
+
+def pareto(results):
+    """Marks every result no other one beats on both hits and failures."""
+    for result in results:
+        result["front"] = not any(
+            other["hits"] >= result["hits"] and
+            other["failure"] <= result["failure"] and
+            (other["hits"] > result["hits"] or
+             other["failure"] < result["failure"])
+            for other in results)
+
+
+def export(path, best, args):
+    with open(path, "w") as header:
+        header.write("// Written by tools/tune.py, build with -D TUNED=1.\n")
+        header.write("// Tuned with %s, loss %s%%, burst %s, air byte us %s, "
+                     "turnaround ms %s:\n" %
+                     (args.flags or "no flags", args.loss, args.burst or "0",
+                      args.air_byte_us or "rate", args.turnaround))
+        header.write("// %.1f hits/min, failure rate %.4f.\n\n" %
+                     (best["hits"], best["failure"]))
+        header.write("#ifndef COMMOTALKINO_SRC_TUNED_H_\n")
+        header.write("#define COMMOTALKINO_SRC_TUNED_H_\n\n")
+        for name, value in best["config"]:
+            header.write("#define %s %d\n" % (name, value))
+        header.write("\n#endif // COMMOTALKINO_SRC_TUNED_H_\n")
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--sweep", action="append", default=[],
+                        help="values of a constant, NAME=V1,V2,...")
+    parser.add_argument("--seconds", type=int, default=120,
+                        help="simulated seconds per run, 120 by default")
+    parser.add_argument("--seeds", type=int, default=3,
+                        help="runs per combination, 3 by default")
+    parser.add_argument("--loss", type=float, default=0,
+                        help="percent of packets lost one by one")
+    parser.add_argument("--burst", default="",
+                        help="burst loss, PERCENT:LENGTH in packets")
+    parser.add_argument("--air-byte-us", type=int, default=0,
+                        help="air time per byte, the air data rate's if 0")
+    parser.add_argument("--turnaround", type=int, default=0,
+                        help="ms a module is deaf after its own packet")
+    parser.add_argument("--flags", default=FLAGS,
+                        help="build flags of every run, none by default")
+    parser.add_argument("--max-failure", type=float, default=0.05,
+                        help="highest failure rate to export, 0.05 default")
+    parser.add_argument("--export", help="header to write the best one to")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count() or 1,
+                        help="simulations at once")
+    parser.add_argument("--build", default=BUILD,
+                        help="build command, '%s' by default" % BUILD)
+    parser.add_argument("--program", default=PROGRAM,
+                        help="what the build command makes, from the root")
+    args = parser.parse_args()
+    sweep = parse_sweep(args.sweep)
+    names = [name for name, _ in sweep]
+    configs = [list(zip(names, values)) for values in
+               itertools.product(*[values for _, values in sweep])]
+    swept = [name for name, values in sweep if 1 < len(values)]
+
+    directory = tempfile.mkdtemp(prefix="tune")
+    try:
+        programs = [build(config, args.flags, args.build, args.program,
+                          directory, index)
+                    for index, config in enumerate(configs)]
+        with concurrent.futures.ThreadPoolExecutor(args.jobs) as pool:
+            runs = [[pool.submit(simulate, program, seed, args)
+                     for seed in range(1, args.seeds + 1)]
+                    for program in programs]
+            results = []
+            for config, futures in zip(configs, runs):
+                totals = [sum(values) for values in
+                          zip(*[future.result() for future in futures])]
+                pulls, received, timeouts = totals
+                minutes = args.seeds * args.seconds / 60.0
+                results.append({
+                    "config": config,
+                    "hits": received / minutes,
+                    "failure": float(timeouts) / pulls if pulls else 1.0,
+                })
+    finally:
+        shutil.rmtree(directory)
+
+    pareto(results)
+    results.sort(key=lambda result: (-result["hits"], result["failure"]))
+    print("| " + " | ".join("%21s" % name for name in swept) +
+          " | Hits/min | Failure rate | Pareto |")
+    for result in results:
+        values = dict(result["config"])
+        print("| " + " | ".join("%21d" % values[name] for name in swept) +
+              " | %8.1f | %12.4f | %6s |" %
+              (result["hits"], result["failure"],
+               "*" if result["front"] else ""))
+
+    front = [result for result in results if result["front"]]
+    fitting = [result for result in front
+               if result["failure"] <= args.max_failure]
+    best = (fitting[0] if fitting else
+            min(front, key=lambda result: result["failure"]))
+    print("Best: " + " ".join("%s=%d" % item for item in best["config"]))
+    if args.export:
+        export(args.export, best, args)
+        print("Written to %s" % args.export)
+
+
+if __name__ == "__main__":
+    main()